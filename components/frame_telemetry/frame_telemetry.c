@@ -0,0 +1,187 @@
+#include "frame_telemetry.h"
+
+#if LED_TELEMETRY_ENABLED
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <esp_timer.h>
+#include <esp_log.h>
+
+_Static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0, "ring size must be a power of two");
+#define RING_MASK (TELEMETRY_RING_SIZE - 1)
+
+static const char *TAG = "TELEMETRY";
+
+// Single-producer ring: only one task writes each metric, readers copy a window
+// and drop whatever the writer may have overwritten while they were copying
+typedef struct {
+    uint32_t samples[TELEMETRY_RING_SIZE];
+    atomic_uint head;       // Samples ever written
+} TelemetryRing;
+
+static TelemetryRing rings[TELEMETRY_METRIC_COUNT];
+static uint32_t frame_period_us;
+static int64_t last_render_start_us;
+static bool have_last_render;
+static atomic_uint frames_rendered;
+static atomic_uint deadline_misses;
+static _Atomic int64_t notify_sent_us;
+
+static const char* metric_names[TELEMETRY_METRIC_COUNT] = {
+    "render", "frame_interval", "wake_latency", "notify_latency", "pack", "transmit",
+};
+
+static void ring_push(TelemetryRing* ring, uint32_t value) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->samples[head & RING_MASK] = value;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Copy the newest samples; returns how many are valid
+static uint32_t ring_snapshot(TelemetryRing* ring, uint32_t* out) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t count = head < TELEMETRY_RING_SIZE ? head : TELEMETRY_RING_SIZE;
+    uint32_t first = head - count;
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = ring->samples[(first + i) & RING_MASK];
+    }
+
+    // Entries the writer lapped during the copy are stale
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t head_after = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t written = head_after - head;
+    uint32_t overwritten = written > TELEMETRY_RING_SIZE - count ? written - (TELEMETRY_RING_SIZE - count) : 0;
+    if (overwritten >= count) return 0;
+    if (overwritten > 0) {
+        memmove(out, out + overwritten, (count - overwritten) * sizeof(uint32_t));
+    }
+    return count - overwritten;
+}
+
+static inline uint32_t clamp_us(int64_t delta_us) {
+    if (delta_us < 0) return 0;
+    return delta_us > UINT32_MAX ? UINT32_MAX : (uint32_t)delta_us;
+}
+
+void frame_telemetry_init(uint32_t period_us) {
+    frame_period_us = period_us;
+    frame_telemetry_reset();
+}
+
+void frame_telemetry_reset(void) {
+    for (int m = 0; m < TELEMETRY_METRIC_COUNT; m++) {
+        atomic_store(&rings[m].head, 0);
+    }
+    have_last_render = false;
+    atomic_store(&frames_rendered, 0);
+    atomic_store(&deadline_misses, 0);
+    atomic_store(&notify_sent_us, 0);
+}
+
+int64_t frame_telemetry_now(void) {
+    return esp_timer_get_time();
+}
+
+void frame_telemetry_render_done(int64_t scheduled_us, int64_t start_us, int64_t end_us) {
+    uint32_t render_us = clamp_us(end_us - start_us);
+    ring_push(&rings[TELEMETRY_RENDER], render_us);
+
+    // A pass misses its deadline when it overruns the frame period or starts more
+    // than half a period after it was due (the task was starved)
+    bool missed = render_us > frame_period_us;
+    if (scheduled_us != 0) {
+        uint32_t late_us = clamp_us(start_us - scheduled_us);
+        ring_push(&rings[TELEMETRY_WAKE_LATENCY], late_us);
+        if (late_us > frame_period_us / 2) missed = true;
+    }
+    if (have_last_render) {
+        ring_push(&rings[TELEMETRY_FRAME_INTERVAL], clamp_us(start_us - last_render_start_us));
+    }
+    last_render_start_us = start_us;
+    have_last_render = true;
+
+    atomic_fetch_add_explicit(&frames_rendered, 1, memory_order_relaxed);
+    if (missed) atomic_fetch_add_explicit(&deadline_misses, 1, memory_order_relaxed);
+}
+
+void frame_telemetry_notify_sent(void) {
+    atomic_store_explicit(&notify_sent_us, esp_timer_get_time(), memory_order_release);
+}
+
+void frame_telemetry_notify_received(void) {
+    int64_t sent_us = atomic_exchange_explicit(&notify_sent_us, 0, memory_order_acq_rel);
+    if (sent_us == 0) return;
+    ring_push(&rings[TELEMETRY_NOTIFY_LATENCY], clamp_us(esp_timer_get_time() - sent_us));
+}
+
+void frame_telemetry_record(TelemetryMetric metric, int64_t start_us) {
+    if (metric >= TELEMETRY_METRIC_COUNT) return;
+    ring_push(&rings[metric], clamp_us(esp_timer_get_time() - start_us));
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t histogram_bin(uint32_t value_us) {
+    uint32_t bin = 0;
+    while (value_us > 1 && bin < TELEMETRY_HISTOGRAM_BINS - 1) {
+        value_us >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+void frame_telemetry_get_summary(TelemetryMetric metric, TelemetrySummary* summary) {
+    if (!summary) return;
+    memset(summary, 0, sizeof(*summary));
+    if (metric >= TELEMETRY_METRIC_COUNT) return;
+
+    uint32_t samples[TELEMETRY_RING_SIZE];
+    uint32_t count = ring_snapshot(&rings[metric], samples);
+    if (count == 0) return;
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += samples[i];
+        summary->histogram[histogram_bin(samples[i])]++;
+    }
+    qsort(samples, count, sizeof(uint32_t), compare_u32);
+
+    summary->count = count;
+    summary->min_us = samples[0];
+    summary->max_us = samples[count - 1];
+    summary->avg_us = (uint32_t)(sum / count);
+    summary->p99_us = samples[(count * 99 + 99) / 100 - 1];
+}
+
+void frame_telemetry_get_report(TelemetryReport* report) {
+    if (!report) return;
+    report->frames_rendered = atomic_load_explicit(&frames_rendered, memory_order_relaxed);
+    report->deadline_misses = atomic_load_explicit(&deadline_misses, memory_order_relaxed);
+    for (int m = 0; m < TELEMETRY_METRIC_COUNT; m++) {
+        frame_telemetry_get_summary((TelemetryMetric)m, &report->metrics[m]);
+    }
+}
+
+const char* frame_telemetry_metric_name(TelemetryMetric metric) {
+    return metric < TELEMETRY_METRIC_COUNT ? metric_names[metric] : "unknown";
+}
+
+void frame_telemetry_log_report(void) {
+    TelemetryReport report;
+    frame_telemetry_get_report(&report);
+
+    ESP_LOGI(TAG, "frames=%u deadline_misses=%u",
+             (unsigned)report.frames_rendered, (unsigned)report.deadline_misses);
+    for (int m = 0; m < TELEMETRY_METRIC_COUNT; m++) {
+        const TelemetrySummary* s = &report.metrics[m];
+        ESP_LOGI(TAG, "%-15s n=%3u min=%6u avg=%6u p99=%6u max=%6u us",
+                 metric_names[m], (unsigned)s->count, (unsigned)s->min_us,
+                 (unsigned)s->avg_us, (unsigned)s->p99_us, (unsigned)s->max_us);
+    }
+}
+
+#endif // LED_TELEMETRY_ENABLED
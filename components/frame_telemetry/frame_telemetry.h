@@ -0,0 +1,101 @@
+#ifndef FRAME_TELEMETRY_H
+#define FRAME_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-frame timing of the render and display tasks. Set to 0 to compile every
+// recording call down to nothing.
+#ifndef LED_TELEMETRY_ENABLED
+#define LED_TELEMETRY_ENABLED 1
+#endif
+
+// Samples kept per metric (power of two); summaries cover this window
+#ifndef TELEMETRY_RING_SIZE
+#define TELEMETRY_RING_SIZE 128
+#endif
+
+// Histogram bin i counts samples in [2^i, 2^(i+1)) microseconds; bin 0 also holds 0
+#define TELEMETRY_HISTOGRAM_BINS 16
+
+typedef enum {
+    TELEMETRY_RENDER,           // led_controller_update, render task
+    TELEMETRY_FRAME_INTERVAL,   // Render start to render start, render task
+    TELEMETRY_WAKE_LATENCY,     // Scheduled render time to actual render start
+    TELEMETRY_NOTIFY_LATENCY,   // xTaskNotify to display task wakeup
+    TELEMETRY_PACK,             // Wait for the previous transmission + pack
+    TELEMETRY_TRANSMIT,         // Starting transmission on every output channel
+    TELEMETRY_METRIC_COUNT
+} TelemetryMetric;
+
+typedef struct {
+    uint32_t count;             // Samples in the window
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t histogram[TELEMETRY_HISTOGRAM_BINS];
+} TelemetrySummary;
+
+typedef struct {
+    uint32_t frames_rendered;   // Render passes since init/reset
+    uint32_t deadline_misses;   // Render passes that started late or overran the frame period
+    TelemetrySummary metrics[TELEMETRY_METRIC_COUNT];
+} TelemetryReport;
+
+#if LED_TELEMETRY_ENABLED
+
+// frame_period_us is the shortest render period; a pass must fit in it and may
+// start at most half of it late
+void frame_telemetry_init(uint32_t frame_period_us);
+void frame_telemetry_reset(void);
+
+// Microsecond timestamp for the begin/end pairs below
+int64_t frame_telemetry_now(void);
+
+// Render task: one call per pass. scheduled_us is when the pass was due, 0 if it
+// was not scheduled (woken by a pattern change).
+void frame_telemetry_render_done(int64_t scheduled_us, int64_t start_us, int64_t end_us);
+// Render task, right before notifying the display task
+void frame_telemetry_notify_sent(void);
+// Display task, right after its notification wait returns
+void frame_telemetry_notify_received(void);
+// Any single task per metric: record a duration that started at start_us
+void frame_telemetry_record(TelemetryMetric metric, int64_t start_us);
+
+// Safe from any task while recording continues
+void frame_telemetry_get_report(TelemetryReport* report);
+void frame_telemetry_get_summary(TelemetryMetric metric, TelemetrySummary* summary);
+void frame_telemetry_log_report(void);
+const char* frame_telemetry_metric_name(TelemetryMetric metric);
+
+#else
+
+static inline void frame_telemetry_init(uint32_t frame_period_us) { (void)frame_period_us; }
+static inline void frame_telemetry_reset(void) {}
+static inline int64_t frame_telemetry_now(void) { return 0; }
+static inline void frame_telemetry_render_done(int64_t scheduled_us, int64_t start_us, int64_t end_us) {
+    (void)scheduled_us; (void)start_us; (void)end_us;
+}
+static inline void frame_telemetry_notify_sent(void) {}
+static inline void frame_telemetry_notify_received(void) {}
+static inline void frame_telemetry_record(TelemetryMetric metric, int64_t start_us) { (void)metric; (void)start_us; }
+static inline void frame_telemetry_get_report(TelemetryReport* report) { if (report) *report = (TelemetryReport){0}; }
+static inline void frame_telemetry_get_summary(TelemetryMetric metric, TelemetrySummary* summary) {
+    (void)metric;
+    if (summary) *summary = (TelemetrySummary){0};
+}
+static inline void frame_telemetry_log_report(void) {}
+static inline const char* frame_telemetry_metric_name(TelemetryMetric metric) { (void)metric; return ""; }
+
+#endif // LED_TELEMETRY_ENABLED
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_TELEMETRY_H
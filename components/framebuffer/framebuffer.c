@@ -1,128 +1,516 @@
 #include "framebuffer.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 
 // Global frame buffers
 LedEdgeConfigState_t *currentLedConfigState = NULL;
 LedEdgeConfigState_t *nextLedConfigState = NULL;
 
+#if !FRAMEBUFFER_TRIPLE_BUFFER
 // Synchronization
 SemaphoreHandle_t framebuffer_mutex = NULL;
+#endif
 
-// Initialize framebuffer system
-BaseType_t framebuffer_init(uint8_t num_edges, uint32_t *num_led_per_edge)
+#if FRAMEBUFFER_TRIPLE_BUFFER
+#define FRAMEBUFFER_COUNT 3
+#else
+#define FRAMEBUFFER_COUNT 2
+#endif
+
+// All buffers; current/next always point at two of them
+static LedEdgeConfigState_t *framebuffers[FRAMEBUFFER_COUNT];
+
+#if FRAMEBUFFER_TRIPLE_BUFFER
+// ready_index holds the buffer of the last published frame; FRAME_FRESH is set
+// until the display task exchanges it for the buffer it just finished with. The
+// bits from FRAME_EDGES_SHIFT up are the edges changed since the display's last
+// frame, carried over from frames it never picked up.
+#define FRAME_INDEX_MASK 0x03u
+#define FRAME_FRESH      0x04u
+#define FRAME_EDGES_SHIFT 8
+#define FRAME_EDGES_MASK (UINT32_MAX >> FRAME_EDGES_SHIFT)
+
+static atomic_uint ready_index;
+static uint32_t back_index;     // Owned by the render task
+static uint32_t front_index;    // Owned by the display task
+#else
+static atomic_uint published_seq;
+static uint32_t acquired_seq;   // Owned by the display task
+static uint32_t pending_edges;  // Changed since the display's last frame, under the mutex
+#endif
+static LedEdgeConfigState_t *published_state;  // Owned by the render task
+
+static atomic_uint stat_published;
+static atomic_uint stat_shown;
+static atomic_uint stat_dropped;
+static atomic_uint stat_repeated;
+static atomic_uint stat_palette_overflows;
+
+#if FRAMEBUFFER_INDEXED
+static void palette_lookups_forget(void);
+#endif
+
+#define ALIGN_UP(value, align) (((value) + (align) - 1) & ~((size_t)(align) - 1))
+
+#if FRAMEBUFFER_FLAT_LAYOUT
+// One block per buffer: [state][num_led_per_edge][edge_offset][data][pad][pixels][palette]
+static LedEdgeConfigState_t *framebuffer_alloc_state(uint8_t num_edges, uint32_t *num_led_per_edge)
 {
-    // Create mutex for synchronization
-    framebuffer_mutex = xSemaphoreCreateMutex();
-    if (framebuffer_mutex == NULL) {
-        return pdFAIL;
+    uint32_t total_leds = 0;
+    for (int i = 0; i < num_edges; i++) {
+        total_leds += num_led_per_edge[i];
     }
 
-    // Allocate memory for both frame buffers
-    currentLedConfigState = (LedEdgeConfigState_t *)pvPortMalloc(sizeof(LedEdgeConfigState_t));
-    nextLedConfigState = (LedEdgeConfigState_t *)pvPortMalloc(sizeof(LedEdgeConfigState_t));
+    size_t counts_offset = ALIGN_UP(sizeof(LedEdgeConfigState_t), sizeof(uint32_t));
+    size_t offsets_offset = counts_offset + sizeof(uint32_t) * num_edges;
+    size_t data_offset = ALIGN_UP(offsets_offset + sizeof(uint32_t) * num_edges, sizeof(LedPixel_t *));
+    size_t pixels_offset = data_offset + sizeof(LedPixel_t *) * num_edges;
+    size_t block_size = pixels_offset + FRAMEBUFFER_PIXEL_ALIGN - 1 + sizeof(LedPixel_t) * total_leds;
+#if FRAMEBUFFER_INDEXED
+    block_size = ALIGN_UP(block_size, sizeof(LedState_t)) + sizeof(LedState_t) * FRAMEBUFFER_PALETTE_SIZE;
+#endif
 
-    if (currentLedConfigState == NULL || nextLedConfigState == NULL) {
-        return pdFAIL;
+    uint8_t *block = (uint8_t *)pvPortMalloc(block_size);
+    if (block == NULL) {
+        return NULL;
     }
 
-    // Initialize structure members
-    currentLedConfigState->num_edges = num_edges;
-    nextLedConfigState->num_edges = num_edges;
+    LedEdgeConfigState_t *state = (LedEdgeConfigState_t *)block;
+    state->num_edges = num_edges;
+    state->total_leds = total_leds;
+    state->num_led_per_edge = (uint32_t *)(block + counts_offset);
+    state->edge_offset = (uint32_t *)(block + offsets_offset);
+    state->data = (LedPixel_t **)(block + data_offset);
+    state->pixels = (LedPixel_t *)ALIGN_UP((uintptr_t)(block + pixels_offset), FRAMEBUFFER_PIXEL_ALIGN);
+#if FRAMEBUFFER_INDEXED
+    state->palette = (LedState_t *)ALIGN_UP((uintptr_t)(state->pixels + total_leds), sizeof(LedState_t));
+    framebuffer_palette_reset(state);
+#endif
 
-    // Allocate memory for num_led_per_edge arrays
-    currentLedConfigState->num_led_per_edge = (uint32_t *)pvPortMalloc(sizeof(uint32_t) * num_edges);
-    nextLedConfigState->num_led_per_edge = (uint32_t *)pvPortMalloc(sizeof(uint32_t) * num_edges);
+    uint32_t offset = 0;
+    for (int i = 0; i < num_edges; i++) {
+        state->num_led_per_edge[i] = num_led_per_edge[i];
+        state->edge_offset[i] = offset;
+        state->data[i] = state->pixels + offset;
+        offset += num_led_per_edge[i];
+    }
 
-    if (!currentLedConfigState->num_led_per_edge || !nextLedConfigState->num_led_per_edge) {
-        return pdFAIL;
+    // Initialize with zeros (all LEDs off)
+    memset(state->pixels, 0, sizeof(LedPixel_t) * total_leds);
+    return state;
+}
+
+static void framebuffer_free_state(LedEdgeConfigState_t *state)
+{
+    vPortFree(state);
+}
+#else
+static void framebuffer_free_state(LedEdgeConfigState_t *state)
+{
+    if (state->data != NULL) {
+        for (int i = 0; i < state->num_edges; i++) {
+            if (state->data[i] != NULL) {
+                vPortFree(state->data[i]);
+            }
+        }
+        vPortFree(state->data);
     }
 
-    // Copy LED counts per edge
-    for (int i = 0; i < num_edges; i++) {
-        currentLedConfigState->num_led_per_edge[i] = num_led_per_edge[i];
-        nextLedConfigState->num_led_per_edge[i] = num_led_per_edge[i];
+    // Free the num_led_per_edge array
+    if (state->num_led_per_edge != NULL) {
+        vPortFree(state->num_led_per_edge);
+    }
+#if FRAMEBUFFER_INDEXED
+    if (state->palette != NULL) {
+        vPortFree(state->palette);
     }
+#endif
 
-    // Allocate memory for LED data arrays
-    currentLedConfigState->data = (LedState_t **)pvPortMalloc(sizeof(LedState_t *) * num_edges);
-    nextLedConfigState->data = (LedState_t **)pvPortMalloc(sizeof(LedState_t *) * num_edges);
-    
-    if (!currentLedConfigState->data || !nextLedConfigState->data) {
-        return pdFAIL;
+    vPortFree(state);
+}
+
+static LedEdgeConfigState_t *framebuffer_alloc_state(uint8_t num_edges, uint32_t *num_led_per_edge)
+{
+    LedEdgeConfigState_t *state = (LedEdgeConfigState_t *)pvPortMalloc(sizeof(LedEdgeConfigState_t));
+    if (state == NULL) {
+        return NULL;
     }
+    memset(state, 0, sizeof(LedEdgeConfigState_t));
+
+    // Initialize structure members
+    state->num_edges = num_edges;
+
+    // Allocate memory for num_led_per_edge array and LED data array
+    state->num_led_per_edge = (uint32_t *)pvPortMalloc(sizeof(uint32_t) * num_edges);
+    state->data = (LedPixel_t **)pvPortMalloc(sizeof(LedPixel_t *) * num_edges);
+    if (!state->num_led_per_edge || !state->data) {
+        framebuffer_free_state(state);
+        return NULL;
+    }
+    memset(state->data, 0, sizeof(LedPixel_t *) * num_edges);
+#if FRAMEBUFFER_INDEXED
+    state->palette = (LedState_t *)pvPortMalloc(sizeof(LedState_t) * FRAMEBUFFER_PALETTE_SIZE);
+    if (!state->palette) {
+        framebuffer_free_state(state);
+        return NULL;
+    }
+    framebuffer_palette_reset(state);
+#endif
 
     // Allocate memory for each edge's LED array
     for (int i = 0; i < num_edges; i++) {
-        currentLedConfigState->data[i] = (LedState_t *)pvPortMalloc(sizeof(LedState_t) * num_led_per_edge[i]);
-        nextLedConfigState->data[i] = (LedState_t *)pvPortMalloc(sizeof(LedState_t) * num_led_per_edge[i]);
-        
-        if (!currentLedConfigState->data[i] || !nextLedConfigState->data[i]) {
-            return pdFAIL;
+        state->num_led_per_edge[i] = num_led_per_edge[i];
+        state->total_leds += num_led_per_edge[i];
+        state->data[i] = (LedPixel_t *)pvPortMalloc(sizeof(LedPixel_t) * num_led_per_edge[i]);
+        if (!state->data[i]) {
+            framebuffer_free_state(state);
+            return NULL;
         }
 
         // Initialize with zeros (all LEDs off)
-        memset(currentLedConfigState->data[i], 0, num_led_per_edge[i] * sizeof(LedState_t));
-        memset(nextLedConfigState->data[i], 0, num_led_per_edge[i] * sizeof(LedState_t));
+        memset(state->data[i], 0, num_led_per_edge[i] * sizeof(LedPixel_t));
     }
 
+    return state;
+}
+#endif
+
+// Initialize framebuffer system
+BaseType_t framebuffer_init(uint8_t num_edges, uint32_t *num_led_per_edge)
+{
+#if !FRAMEBUFFER_TRIPLE_BUFFER
+    // Create mutex for synchronization; triple buffering hands frames over without one
+    framebuffer_mutex = xSemaphoreCreateMutex();
+    if (framebuffer_mutex == NULL) {
+        return pdFAIL;
+    }
+#endif
+
+    // Allocate memory for all frame buffers
+    for (int i = 0; i < FRAMEBUFFER_COUNT; i++) {
+        framebuffers[i] = framebuffer_alloc_state(num_edges, num_led_per_edge);
+        if (framebuffers[i] == NULL) {
+            framebuffer_cleanup();
+            return pdFAIL;
+        }
+    }
+
+    currentLedConfigState = framebuffers[0];
+    nextLedConfigState = framebuffers[1];
+    published_state = NULL;
+#if FRAMEBUFFER_TRIPLE_BUFFER
+    front_index = 0;
+    back_index = 1;
+    atomic_store(&ready_index, 2);
+#else
+    atomic_store(&published_seq, 0);
+    acquired_seq = 0;
+    pending_edges = 0;
+#endif
+    atomic_store(&stat_published, 0);
+    atomic_store(&stat_shown, 0);
+    atomic_store(&stat_dropped, 0);
+    atomic_store(&stat_repeated, 0);
+    atomic_store(&stat_palette_overflows, 0);
+
     return pdPASS;
 }
 
 // Clean up framebuffer system
-BaseType_t framebuffer_cleanup(void) 
+BaseType_t framebuffer_cleanup(void)
 {
+#if !FRAMEBUFFER_TRIPLE_BUFFER
     if (framebuffer_mutex) {
         vSemaphoreDelete(framebuffer_mutex);
         framebuffer_mutex = NULL;
     }
+#endif
 
-    LedEdgeConfigState_t* states[] = {currentLedConfigState, nextLedConfigState};
-    LedEdgeConfigState_t** statePointers[] = {&currentLedConfigState, &nextLedConfigState};
-    
-    for (int s = 0; s < 2; s++) {
-        if (states[s] != NULL) {
-            if (states[s]->data != NULL) {
-                for (int i = 0; i < states[s]->num_edges; i++) {
-                    if (states[s]->data[i] != NULL) {
-                        vPortFree(states[s]->data[i]);
-                    }
-                }
-                vPortFree(states[s]->data);
-            }
-            
-            // Free the num_led_per_edge array
-            if (states[s]->num_led_per_edge != NULL) {
-                vPortFree(states[s]->num_led_per_edge);
-            }
-            
-            vPortFree(states[s]);
-            *(statePointers[s]) = NULL;
+    for (int i = 0; i < FRAMEBUFFER_COUNT; i++) {
+        if (framebuffers[i] != NULL) {
+            framebuffer_free_state(framebuffers[i]);
+            framebuffers[i] = NULL;
         }
     }
-    
+    currentLedConfigState = NULL;
+    nextLedConfigState = NULL;
+    published_state = NULL;
+#if FRAMEBUFFER_INDEXED
+    palette_lookups_forget();
+#endif
+
     return pdPASS;
 }
 
-// Swap current and next frame buffers 
-void framebuffer_swap(void)
+#if FRAMEBUFFER_TRIPLE_BUFFER
+// Publish the finished next frame and take over the buffer it replaces (never blocks)
+void framebuffer_publish(uint32_t changed_edges)
+{
+    uint32_t previous = atomic_load_explicit(&ready_index, memory_order_relaxed);
+    uint32_t ready;
+    do {
+        // A frame the display never picked up hands its changes on to this one
+        uint32_t edges = changed_edges & FRAME_EDGES_MASK;
+        if (previous & FRAME_FRESH) edges |= previous >> FRAME_EDGES_SHIFT;
+        ready = back_index | FRAME_FRESH | (edges << FRAME_EDGES_SHIFT);
+    } while (!atomic_compare_exchange_weak_explicit(&ready_index, &previous, ready,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+    if (previous & FRAME_FRESH) {
+        atomic_fetch_add_explicit(&stat_dropped, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&stat_published, 1, memory_order_relaxed);
+
+    published_state = framebuffers[back_index];
+    back_index = previous & FRAME_INDEX_MASK;
+    nextLedConfigState = framebuffers[back_index];
+}
+
+// Pick up the newest published frame, if any (never blocks)
+LedEdgeConfigState_t *framebuffer_acquire_changes(bool *is_new, uint32_t *changed_edges)
+{
+    bool fresh = (atomic_load_explicit(&ready_index, memory_order_acquire) & FRAME_FRESH) != 0;
+    uint32_t edges = 0;
+
+    if (fresh) {
+        uint32_t previous = atomic_exchange_explicit(&ready_index, front_index, memory_order_acq_rel);
+        front_index = previous & FRAME_INDEX_MASK;
+        edges = previous >> FRAME_EDGES_SHIFT;
+        currentLedConfigState = framebuffers[front_index];
+        atomic_fetch_add_explicit(&stat_shown, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&stat_repeated, 1, memory_order_relaxed);
+    }
+
+    if (is_new) *is_new = fresh;
+    if (changed_edges) *changed_edges = edges;
+    return currentLedConfigState;
+}
+#else
+// Swap current and next frame buffers
+void framebuffer_publish(uint32_t changed_edges)
 {
     if (xSemaphoreTake(framebuffer_mutex, portMAX_DELAY) == pdTRUE) {
         LedEdgeConfigState_t *temp = currentLedConfigState;
         currentLedConfigState = nextLedConfigState;
         nextLedConfigState = temp;
+        pending_edges |= changed_edges;
+        atomic_fetch_add_explicit(&published_seq, 1, memory_order_release);
+        atomic_fetch_add_explicit(&stat_published, 1, memory_order_relaxed);
         xSemaphoreGive(framebuffer_mutex);
-        
+
+        published_state = currentLedConfigState;
     }
 }
 
+// Double buffering: the current frame is whatever the last swap left there, read
+// under the lock so the sequence number, the pointer and the changed edges all
+// come from the same swap
+LedEdgeConfigState_t *framebuffer_acquire_changes(bool *is_new, uint32_t *changed_edges)
+{
+    uint32_t seq = acquired_seq;
+    uint32_t edges = 0;
+    LedEdgeConfigState_t *current = NULL;
+    if (xSemaphoreTake(framebuffer_mutex, portMAX_DELAY) == pdTRUE) {
+        seq = atomic_load_explicit(&published_seq, memory_order_acquire);
+        current = currentLedConfigState;
+        edges = pending_edges;
+        pending_edges = 0;
+        xSemaphoreGive(framebuffer_mutex);
+    }
+    bool fresh = (seq != acquired_seq);
+    if (changed_edges) *changed_edges = fresh ? edges : 0;
+
+    if (fresh) {
+        atomic_fetch_add_explicit(&stat_dropped, seq - acquired_seq - 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stat_shown, 1, memory_order_relaxed);
+        acquired_seq = seq;
+    } else {
+        atomic_fetch_add_explicit(&stat_repeated, 1, memory_order_relaxed);
+    }
+
+    if (is_new) *is_new = fresh;
+    return current;
+}
+#endif
+
+void framebuffer_swap(void)
+{
+    framebuffer_publish(UINT32_MAX);
+}
+
+const LedEdgeConfigState_t *framebuffer_last_published(void)
+{
+    return published_state;
+}
+
+LedEdgeConfigState_t *framebuffer_acquire(bool *is_new)
+{
+    return framebuffer_acquire_changes(is_new, NULL);
+}
+
+void framebuffer_get_stats(FramebufferStats_t *stats)
+{
+    if (!stats) return;
+    stats->frames_published = atomic_load_explicit(&stat_published, memory_order_relaxed);
+    stats->frames_shown = atomic_load_explicit(&stat_shown, memory_order_relaxed);
+    stats->frames_dropped = atomic_load_explicit(&stat_dropped, memory_order_relaxed);
+    stats->frames_repeated = atomic_load_explicit(&stat_repeated, memory_order_relaxed);
+    stats->palette_overflows = atomic_load_explicit(&stat_palette_overflows, memory_order_relaxed);
+}
+
 // Clear the next frame buffer
 void framebuffer_clear_next(void)
 {
     if (!nextLedConfigState) return;
-    
+
+    framebuffer_palette_reset(nextLedConfigState);
+    if (nextLedConfigState->pixels) {
+        memset(nextLedConfigState->pixels, 0, nextLedConfigState->total_leds * sizeof(LedPixel_t));
+        return;
+    }
+
     for (int i = 0; i < nextLedConfigState->num_edges; i++) {
-        memset(nextLedConfigState->data[i], 0, 
-               nextLedConfigState->num_led_per_edge[i] * sizeof(LedState_t));
+        memset(nextLedConfigState->data[i], 0,
+               nextLedConfigState->num_led_per_edge[i] * sizeof(LedPixel_t));
+    }
+}
+
+#if FRAMEBUFFER_INDEXED
+// Color -> palette entry lookup for a frame being built: open addressing over
+// twice the palette size, a slot holding entry + 1 (0 when empty). There are two,
+// following the last two frames written (the next frame and the render engine's
+// scratch frame), so going back and forth between them costs no rebuild; one is
+// rebuilt from the palette only when the writer moves on to a third.
+#define PALETTE_LOOKUPS     2
+#define PALETTE_HASH_SIZE   (2 * FRAMEBUFFER_PALETTE_SIZE)
+#define PALETTE_HASH_SHIFT  (32 - 9)
+
+// Once the palette is full, colors are approximated per cell of a 3:3:3 grid over
+// the displayed color: the nearest entry is searched once per cell and frame
+// rather than once per LED, which keeps an overflowing frame's cost bounded
+#define PALETTE_CELL_BITS   3
+#define PALETTE_CELL_COUNT  (1 << (3 * PALETTE_CELL_BITS))
+
+typedef struct {
+    const LedEdgeConfigState_t *owner;      // Frame this lookup follows, NULL if none
+    uint16_t hash[PALETTE_HASH_SIZE];
+    uint16_t cell[PALETTE_CELL_COUNT];      // Entry + 1, 0 until searched
+} PaletteLookup;
+
+static PaletteLookup palette_lookups[PALETTE_LOOKUPS];
+static PaletteLookup *palette_recent = &palette_lookups[0];    // Used last
+
+static inline uint32_t color_key(LedState_t color)
+{
+    return (uint32_t)color.r | ((uint32_t)color.g << 8) | ((uint32_t)color.b << 16) |
+           ((uint32_t)color.intensity << 24);
+}
+
+static inline uint32_t palette_slot(LedState_t color)
+{
+    return (color_key(color) * 0x9E3779B1u) >> PALETTE_HASH_SHIFT;
+}
+
+static void palette_lookup_rebuild(PaletteLookup *lookup, const LedEdgeConfigState_t *state)
+{
+    memset(lookup->hash, 0, sizeof(lookup->hash));
+    memset(lookup->cell, 0, sizeof(lookup->cell));
+    for (uint32_t entry = 0; entry < state->palette_used; entry++) {
+        uint32_t slot = palette_slot(state->palette[entry]);
+        while (lookup->hash[slot] != 0) {
+            slot = (slot + 1) & (PALETTE_HASH_SIZE - 1);
+        }
+        lookup->hash[slot] = (uint16_t)(entry + 1);
+    }
+    lookup->owner = state;
+}
+
+static void palette_lookups_forget(void)
+{
+    for (int i = 0; i < PALETTE_LOOKUPS; i++) {
+        palette_lookups[i].owner = NULL;
+    }
+}
+
+// The lookup following state, taking over the least recently used one if none does
+static PaletteLookup *palette_lookup(const LedEdgeConfigState_t *state)
+{
+    if (palette_recent->owner == state) return palette_recent;
+    PaletteLookup *other = palette_recent == &palette_lookups[0] ? &palette_lookups[1] : &palette_lookups[0];
+    if (other->owner != state) {
+        palette_lookup_rebuild(other, state);
+    }
+    palette_recent = other;
+    return other;
+}
+
+// Closest entry as displayed (intensity applied)
+static uint32_t palette_nearest(const LedEdgeConfigState_t *state, LedState_t color)
+{
+    int32_t r = color.r * color.intensity;
+    int32_t g = color.g * color.intensity;
+    int32_t b = color.b * color.intensity;
+    uint32_t best = 0;
+    uint64_t best_distance = UINT64_MAX;
+    for (uint32_t entry = 0; entry < state->palette_used; entry++) {
+        LedState_t c = state->palette[entry];
+        int64_t dr = c.r * c.intensity - r;
+        int64_t dg = c.g * c.intensity - g;
+        int64_t db = c.b * c.intensity - b;
+        uint64_t distance = (uint64_t)(dr * dr + dg * dg + db * db);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = entry;
+        }
     }
-}
\ No newline at end of file
+    return best;
+}
+
+static inline uint32_t palette_cell_index(LedState_t color)
+{
+    const int shift = 16 - PALETTE_CELL_BITS;
+    uint32_t r = (uint32_t)(color.r * color.intensity) >> shift;
+    uint32_t g = (uint32_t)(color.g * color.intensity) >> shift;
+    uint32_t b = (uint32_t)(color.b * color.intensity) >> shift;
+    return (r << (2 * PALETTE_CELL_BITS)) | (g << PALETTE_CELL_BITS) | b;
+}
+
+void framebuffer_palette_reset(LedEdgeConfigState_t *state)
+{
+    if (!state) return;
+    state->palette[0] = (LedState_t){0, 0, 0, 0};
+    state->palette_used = 1;
+    for (int i = 0; i < PALETTE_LOOKUPS; i++) {
+        if (palette_lookups[i].owner == state) {
+            palette_lookup_rebuild(&palette_lookups[i], state);
+        }
+    }
+}
+
+LedPixel_t framebuffer_pixel(LedEdgeConfigState_t *state, LedState_t color)
+{
+    PaletteLookup *lookup = palette_lookup(state);
+    uint32_t key = color_key(color);
+    uint32_t slot = palette_slot(color);
+    while (lookup->hash[slot] != 0) {
+        uint32_t entry = lookup->hash[slot] - 1u;
+        if (color_key(state->palette[entry]) == key) return (LedPixel_t)entry;
+        slot = (slot + 1) & (PALETTE_HASH_SIZE - 1);
+    }
+
+    if (state->palette_used == FRAMEBUFFER_PALETTE_SIZE) {
+        atomic_fetch_add_explicit(&stat_palette_overflows, 1, memory_order_relaxed);
+        uint32_t cell = palette_cell_index(color);
+        if (lookup->cell[cell] == 0) {
+            lookup->cell[cell] = (uint16_t)(palette_nearest(state, color) + 1);
+        }
+        return (LedPixel_t)(lookup->cell[cell] - 1);
+    }
+
+    uint32_t entry = state->palette_used++;
+    state->palette[entry] = color;
+    lookup->hash[slot] = (uint16_t)(entry + 1);
+    return (LedPixel_t)entry;
+}
+#endif
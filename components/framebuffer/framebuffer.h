@@ -2,9 +2,38 @@
 #define FRAMEBUFFER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
+// Flat layout: each buffer is one allocation and every edge lives back to back in
+// `pixels`, so whole-frame passes are a single linear sweep. data[edge] still points
+// into the block, so per-edge access keeps working. Set to 0 for per-edge arrays.
+#ifndef FRAMEBUFFER_FLAT_LAYOUT
+#define FRAMEBUFFER_FLAT_LAYOUT 1
+#endif
+
+// Alignment of the pixel block in the flat layout (bytes)
+#define FRAMEBUFFER_PIXEL_ALIGN 16
+
+// Triple buffering: the render task publishes finished frames with an atomic index
+// exchange and the display task always picks up the newest one, so neither side ever
+// blocks. Set to 0 for the mutex-guarded double buffer.
+#ifndef FRAMEBUFFER_TRIPLE_BUFFER
+#define FRAMEBUFFER_TRIPLE_BUFFER 1
+#endif
+
+// Indexed mode: every LED is one byte naming an entry of its frame's 256-color
+// palette, so each buffer takes a quarter of the pixel memory (plus 1 KB of
+// palette) and whole-frame passes touch a quarter of the bytes. Colors are
+// expanded to RGB only when the display task packs the frame. A frame needing
+// more than 256 distinct colors gets the nearest palette entry for the rest.
+#ifndef FRAMEBUFFER_INDEXED
+#define FRAMEBUFFER_INDEXED 0
+#endif
+
+#define FRAMEBUFFER_PALETTE_SIZE 256
+
 // LED state structure
 typedef struct {
     uint8_t r;
@@ -13,19 +42,46 @@ typedef struct {
     uint8_t intensity;
 } LedState_t;
 
+// What the framebuffer stores per LED: the color itself, or its palette index.
+// Read and write pixels through framebuffer_color / framebuffer_pixel to work in
+// either mode.
+#if FRAMEBUFFER_INDEXED
+typedef uint8_t LedPixel_t;
+#else
+typedef LedState_t LedPixel_t;
+#endif
+
 // Configuration for LED edges
 typedef struct {
     uint8_t num_edges;
     uint32_t* num_led_per_edge;  // Support max 8 edges
-    LedState_t **data;  // 2D array: data[edge][led_index]
+    LedPixel_t **data;  // 2D array: data[edge][led_index]
+    LedPixel_t *pixels;         // Flat layout only: all LEDs of all edges, NULL otherwise
+    uint32_t *edge_offset;      // Flat layout only: index of each edge's first LED in pixels
+    uint32_t total_leds;        // Sum of num_led_per_edge
+#if FRAMEBUFFER_INDEXED
+    LedState_t *palette;        // FRAMEBUFFER_PALETTE_SIZE colors; entry 0 is always off
+    uint16_t palette_used;      // Entries [0, palette_used) are valid
+#endif
 } LedEdgeConfigState_t;
 
+// Frame hand-off counters
+typedef struct {
+    uint32_t frames_published;  // Frames completed by the render task
+    uint32_t frames_shown;      // Frames picked up by the display task
+    uint32_t frames_dropped;    // Published frames replaced before the display saw them
+    uint32_t frames_repeated;   // Display requests that found no new frame (shown twice)
+    uint32_t palette_overflows; // Indexed mode: colors approximated because a frame's palette was full
+} FramebufferStats_t;
+
 // Global frame buffers
 extern LedEdgeConfigState_t *currentLedConfigState;
 extern LedEdgeConfigState_t *nextLedConfigState;
 
-// Synchronization
+#if !FRAMEBUFFER_TRIPLE_BUFFER
+// Guards the current/next exchange of the double-buffer fallback
 extern SemaphoreHandle_t framebuffer_mutex;
+#endif
 
 // Function prototypes
 BaseType_t framebuffer_init(uint8_t num_edges, uint32_t *num_led_per_edge);
@@ -33,4 +89,47 @@ BaseType_t framebuffer_cleanup(void);
 void framebuffer_swap(void);
 void framebuffer_clear_next(void);
 
+// Render side: publish the next frame like framebuffer_swap, naming the edges (bit
+// per edge) that may differ from the previously published frame; the rest must be
+// copies of it
+void framebuffer_publish(uint32_t changed_edges);
+// Render side: the last frame published, NULL before the first. It stays intact
+// until the next publish, so the next frame can copy unchanged edges from it.
+const LedEdgeConfigState_t *framebuffer_last_published(void);
+
+// Display side: make the newest published frame current and return it.
+// is_new (optional) reports whether it differs from the previously acquired frame.
+LedEdgeConfigState_t *framebuffer_acquire(bool *is_new);
+// framebuffer_acquire that also reports, in changed_edges, the edges that may
+// differ from the previously acquired frame, including changes of frames dropped
+// in between (0 when the frame is not new)
+LedEdgeConfigState_t *framebuffer_acquire_changes(bool *is_new, uint32_t *changed_edges);
+void framebuffer_get_stats(FramebufferStats_t *stats);
+
+// Color of a stored pixel
+static inline LedState_t framebuffer_color(const LedEdgeConfigState_t *state, LedPixel_t pixel)
+{
+#if FRAMEBUFFER_INDEXED
+    return state->palette[pixel];
+#else
+    (void)state;
+    return pixel;
+#endif
+}
+
+#if FRAMEBUFFER_INDEXED
+// Pixel value for a color in a frame being built, adding it to the frame's palette
+// if it is new. One writer at a time (the render task).
+LedPixel_t framebuffer_pixel(LedEdgeConfigState_t *state, LedState_t color);
+// Forget every palette entry but 0 (off); done whenever the frame is cleared
+void framebuffer_palette_reset(LedEdgeConfigState_t *state);
+#else
+static inline LedPixel_t framebuffer_pixel(LedEdgeConfigState_t *state, LedState_t color)
+{
+    (void)state;
+    return color;
+}
+static inline void framebuffer_palette_reset(LedEdgeConfigState_t *state) { (void)state; }
+#endif
+
 #endif // FRAMEBUFFER_H
\ No newline at end of file
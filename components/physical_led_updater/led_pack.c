@@ -0,0 +1,148 @@
+#include "led_pack.h"
+#include "led_swar.h"
+
+typedef struct {
+    uint8_t bytes_per_pixel;
+    uint8_t r, g, b;        // Byte offsets within a wire pixel
+    int8_t w;               // White byte offset, -1 when the model has none
+} LedWireLayout;
+
+static const LedWireLayout wire_layouts[] = {
+    [LED_WIRE_GRB]  = { 3, 1, 0, 2, -1 },
+    [LED_WIRE_RGB]  = { 3, 0, 1, 2, -1 },
+    [LED_WIRE_GRBW] = { 4, 1, 0, 2, 3 },
+};
+
+uint8_t led_pack_bytes_per_pixel(LedWireFormat format) {
+    return wire_layouts[format].bytes_per_pixel;
+}
+
+// Write one pixel; intensity is folded into all channels of the word at once
+// (exactly c * i / 255)
+static inline void pack_pixel(LedState_t color, const LedWireLayout* layout, const uint8_t* lut, uint8_t* out) {
+    LedState_t scaled = led_swar_store(led_swar_apply_intensity(led_swar_load(color)));
+    uint8_t r = scaled.r;
+    uint8_t g = scaled.g;
+    uint8_t b = scaled.b;
+    if (lut) {
+        r = lut[r];
+        g = lut[g];
+        b = lut[b];
+    }
+    out[layout->r] = r;
+    out[layout->g] = g;
+    out[layout->b] = b;
+    if (layout->w >= 0) out[layout->w] = 0;
+}
+
+#if FRAMEBUFFER_INDEXED
+// Wire bytes of each palette entry in use, packed once per call so every LED only
+// copies its entry's bytes. Packing runs in the display task alone.
+#define WIRE_PALETTE_STRIDE 4
+static uint8_t wire_palette[FRAMEBUFFER_PALETTE_SIZE * WIRE_PALETTE_STRIDE];
+
+static void pack_palette(const LedEdgeConfigState_t* frame, const LedWireLayout* layout, const uint8_t* lut) {
+    const LedState_t* palette = frame->palette;
+    uint32_t used = frame->palette_used;
+    for (uint32_t entry = 0; entry < used; entry++) {
+        pack_pixel(palette[entry], layout, lut, &wire_palette[entry * WIRE_PALETTE_STRIDE]);
+    }
+}
+
+static inline void pack_index(LedPixel_t pixel, uint8_t bytes_per_pixel, uint8_t* out) {
+    const uint8_t* wire = &wire_palette[pixel * WIRE_PALETTE_STRIDE];
+    out[0] = wire[0];
+    out[1] = wire[1];
+    out[2] = wire[2];
+    if (bytes_per_pixel == 4) out[3] = wire[3];
+}
+#endif
+
+// Pack a run of LEDs
+static uint8_t* pack_span(const LedPixel_t* src, uint32_t count, const LedWireLayout* layout,
+                          const uint8_t* lut, uint8_t* out) {
+#if FRAMEBUFFER_INDEXED
+    uint8_t bytes_per_pixel = layout->bytes_per_pixel;
+    for (uint32_t i = 0; i < count; i++) {
+        pack_index(src[i], bytes_per_pixel, out);
+        out += bytes_per_pixel;
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        pack_pixel(src[i], layout, lut, out);
+        out += layout->bytes_per_pixel;
+    }
+#endif
+    return out;
+}
+
+size_t led_pack_edges(const LedEdgeConfigState_t* frame, int first_edge, int edge_count,
+                      const LedPackConfig* config, uint8_t* out, size_t out_size) {
+    if (!frame || !config || !out || first_edge < 0) return 0;
+    if (first_edge + edge_count > frame->num_edges) edge_count = frame->num_edges - first_edge;
+    if (edge_count <= 0) return 0;
+
+    const LedWireLayout* layout = &wire_layouts[config->format];
+    uint32_t capacity = out_size / layout->bytes_per_pixel;
+    uint8_t* cursor = out;
+#if FRAMEBUFFER_INDEXED
+    pack_palette(frame, layout, config->channel_lut);
+#endif
+
+    // Flat layout: consecutive edges are one contiguous run
+    if (frame->pixels) {
+        int last_edge = first_edge + edge_count - 1;
+        uint32_t start = frame->edge_offset[first_edge];
+        uint32_t count = frame->edge_offset[last_edge] + frame->num_led_per_edge[last_edge] - start;
+        if (count > capacity) count = capacity;
+        cursor = pack_span(frame->pixels + start, count, layout, config->channel_lut, cursor);
+        return (size_t)(cursor - out);
+    }
+
+    for (int edge = first_edge; edge < first_edge + edge_count && capacity > 0; edge++) {
+        uint32_t count = frame->num_led_per_edge[edge];
+        if (count > capacity) count = capacity;
+        cursor = pack_span(frame->data[edge], count, layout, config->channel_lut, cursor);
+        capacity -= count;
+    }
+    return (size_t)(cursor - out);
+}
+
+size_t led_pack_frame(const LedEdgeConfigState_t* frame, const LedPackConfig* config,
+                      uint8_t* out, size_t out_size) {
+    if (!frame) return 0;
+    return led_pack_edges(frame, 0, frame->num_edges, config, out, out_size);
+}
+
+size_t led_pack_gather(const LedEdgeConfigState_t* frame, const uint16_t* source, uint32_t count,
+                       const LedPackConfig* config, uint8_t* out, size_t out_size) {
+    if (!frame || !source || !config || !out) return 0;
+
+    const LedWireLayout* layout = &wire_layouts[config->format];
+    uint32_t capacity = out_size / layout->bytes_per_pixel;
+    if (count > capacity) count = capacity;
+
+    LedPixel_t* const* edges = frame->data;
+    uint8_t* cursor = out;
+#if FRAMEBUFFER_INDEXED
+    // Palette entry 0 is always off
+    pack_palette(frame, layout, config->channel_lut);
+    for (uint32_t p = 0; p < count; p++) {
+        uint16_t entry = source[p];
+        LedPixel_t pixel = (entry == LED_PACK_SOURCE_NONE) ? 0
+                         : edges[entry >> LED_PACK_SOURCE_EDGE_SHIFT][entry & LED_PACK_SOURCE_INDEX_MASK];
+        pack_index(pixel, layout->bytes_per_pixel, cursor);
+        cursor += layout->bytes_per_pixel;
+    }
+#else
+    static const LedState_t dark = {0, 0, 0, 0};
+    for (uint32_t p = 0; p < count; p++) {
+        uint16_t entry = source[p];
+        LedState_t color = (entry == LED_PACK_SOURCE_NONE) ? dark
+                         : edges[entry >> LED_PACK_SOURCE_EDGE_SHIFT][entry & LED_PACK_SOURCE_INDEX_MASK];
+        pack_pixel(color, layout, config->channel_lut, cursor);
+        cursor += layout->bytes_per_pixel;
+    }
+#endif
+    return (size_t)(cursor - out);
+}
@@ -0,0 +1,53 @@
+#ifndef LED_PACK_H
+#define LED_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "framebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Byte order of a pixel on the wire, per LED model
+typedef enum {
+    LED_WIRE_GRB,       // WS2812 / WS2812B / SK6812 RGB
+    LED_WIRE_RGB,       // WS2811
+    LED_WIRE_GRBW       // SK6812 RGBW (white channel sent as 0)
+} LedWireFormat;
+
+typedef struct {
+    LedWireFormat format;
+    const uint8_t* channel_lut;     // Optional 256-entry gamma/brightness table, NULL for none
+} LedPackConfig;
+
+// Bytes one pixel occupies on the wire
+uint8_t led_pack_bytes_per_pixel(LedWireFormat format);
+
+// Pack a frame into wire-order bytes in one pass: intensity is folded into r/g/b
+// (exactly c * intensity / 255), the channel LUT is applied, and channels are laid
+// out in model order. Edges are packed back to back. Returns bytes written.
+// An indexed frame (FRAMEBUFFER_INDEXED) has its palette packed once per call,
+// after which each LED is a copy of its entry's wire bytes.
+size_t led_pack_frame(const LedEdgeConfigState_t* frame, const LedPackConfig* config,
+                      uint8_t* out, size_t out_size);
+
+// Same as led_pack_frame for edges [first_edge, first_edge + edge_count) only,
+// e.g. the edges wired to one output channel
+size_t led_pack_edges(const LedEdgeConfigState_t* frame, int first_edge, int edge_count,
+                      const LedPackConfig* config, uint8_t* out, size_t out_size);
+
+// Gather-pack: output pixel p comes from the LED named by source[p], encoded as
+// (edge << LED_PACK_SOURCE_EDGE_SHIFT) | index, or LED_PACK_SOURCE_NONE for a dark
+// pixel. This is the form a compiled LED topology map takes.
+#define LED_PACK_SOURCE_EDGE_SHIFT 8
+#define LED_PACK_SOURCE_INDEX_MASK ((1u << LED_PACK_SOURCE_EDGE_SHIFT) - 1)
+#define LED_PACK_SOURCE_NONE 0xFFFFu
+size_t led_pack_gather(const LedEdgeConfigState_t* frame, const uint16_t* source, uint32_t count,
+                       const LedPackConfig* config, uint8_t* out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_PACK_H
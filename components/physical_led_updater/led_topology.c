@@ -0,0 +1,71 @@
+#include "led_topology.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(MAX_LEDS_PER_EDGE <= (1 << LED_TOPOLOGY_INDEX_BITS), "LED index does not fit the map entry");
+_Static_assert(MAX_EDGES <= (0xFFFF >> LED_TOPOLOGY_INDEX_BITS), "edge does not fit the map entry");
+
+static bool edge_is_reversed(const LedTopology* topology, int edge) {
+    bool reversed = topology->edges[edge].reversed;
+    if (topology->serpentine && (edge & 1)) reversed = !reversed;
+    return reversed;
+}
+
+bool led_topology_build_map(const LedTopology* topology, LedTopologyMap* map) {
+    if (!topology || !map || topology->num_edges == 0 || topology->num_edges > MAX_EDGES) return false;
+    memset(map, 0, sizeof(*map));
+
+    // Each channel's chain is as long as its furthest edge
+    for (int e = 0; e < topology->num_edges; e++) {
+        const LedEdgeTopology* edge = &topology->edges[e];
+        if (edge->channel >= LED_TOPOLOGY_MAX_CHANNELS || edge->length > MAX_LEDS_PER_EDGE) return false;
+
+        uint32_t end = (uint32_t)edge->start_offset + edge->length;
+        if (end > map->channel_length[edge->channel]) map->channel_length[edge->channel] = end;
+        if (edge->channel + 1 > map->channel_count) map->channel_count = edge->channel + 1;
+        map->channel_edges[edge->channel] |= 1u << e;
+    }
+
+    // Channels are laid out back to back in the packed buffer
+    for (int c = 0; c < map->channel_count; c++) {
+        map->channel_offset[c] = map->physical_count;
+        map->physical_count += map->channel_length[c];
+    }
+
+    map->source = malloc(sizeof(uint16_t) * (map->physical_count ? map->physical_count : 1));
+    if (!map->source) return false;
+    for (uint32_t p = 0; p < map->physical_count; p++) {
+        map->source[p] = LED_TOPOLOGY_UNMAPPED;
+    }
+
+    for (int e = 0; e < topology->num_edges; e++) {
+        const LedEdgeTopology* edge = &topology->edges[e];
+        bool reversed = edge_is_reversed(topology, e);
+        uint32_t base = map->channel_offset[edge->channel] + edge->start_offset;
+
+        for (int i = 0; i < edge->length; i++) {
+            uint32_t physical = base + (reversed ? edge->length - 1 - i : i);
+            if (map->source[physical] != LED_TOPOLOGY_UNMAPPED) {
+                // Two edges claim the same physical LED
+                led_topology_free_map(map);
+                return false;
+            }
+            map->source[physical] = (uint16_t)((e << LED_TOPOLOGY_INDEX_BITS) | i);
+        }
+    }
+
+    return true;
+}
+
+void led_topology_free_map(LedTopologyMap* map) {
+    if (!map) return;
+    free(map->source);
+    map->source = NULL;
+    map->physical_count = 0;
+}
+
+void led_topology_edge_lengths(const LedTopology* topology, int* leds_per_edge) {
+    for (int e = 0; e < topology->num_edges; e++) {
+        leds_per_edge[e] = topology->edges[e].length;
+    }
+}
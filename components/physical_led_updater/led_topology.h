@@ -0,0 +1,56 @@
+#ifndef LED_TOPOLOGY_H
+#define LED_TOPOLOGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "render_engine.h"
+#include "led_pack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_TOPOLOGY_MAX_CHANNELS 4
+#define LED_TOPOLOGY_UNMAPPED LED_PACK_SOURCE_NONE    // Physical slot with no logical LED (sent dark)
+
+// Where one logical edge sits on the hardware
+typedef struct {
+    uint16_t length;            // LEDs on this edge
+    uint16_t start_offset;      // Position of the edge's first physical LED on its channel's chain
+    uint8_t channel;            // Output channel (data line) the edge is wired to
+    bool reversed;              // Logical LED 0 is at the far end of the physical run
+} LedEdgeTopology;
+
+// Fixture description; logical edge order is the order of `edges`
+typedef struct {
+    uint8_t num_edges;
+    bool serpentine;            // Additionally reverse every odd edge (zig-zag wiring)
+    LedEdgeTopology edges[MAX_EDGES];
+} LedTopology;
+
+// Compiled form: the logical<->physical mapping as one entry per physical pixel naming
+// the logical LED that feeds it (led_pack_gather encoding), so packing is one pass
+#define LED_TOPOLOGY_INDEX_BITS LED_PACK_SOURCE_EDGE_SHIFT
+
+typedef struct {
+    uint16_t* source;                                   // physical pixel -> logical LED
+    uint32_t physical_count;                            // Pixels across all channels
+    uint8_t channel_count;                              // Highest used channel + 1
+    uint32_t channel_offset[LED_TOPOLOGY_MAX_CHANNELS]; // First physical pixel of each channel
+    uint32_t channel_length[LED_TOPOLOGY_MAX_CHANNELS]; // Pixels on each channel's chain
+    uint32_t channel_edges[LED_TOPOLOGY_MAX_CHANNELS];  // Bit per logical edge wired to each channel
+} LedTopologyMap;
+
+// Validate a topology and compile its lookup table. Returns false on overlapping
+// edges, out-of-range channels/lengths or allocation failure.
+bool led_topology_build_map(const LedTopology* topology, LedTopologyMap* map);
+void led_topology_free_map(LedTopologyMap* map);
+
+// Per-edge LED counts in logical order, as expected by led_controller_create
+void led_topology_edge_lengths(const LedTopology* topology, int* leds_per_edge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_TOPOLOGY_H
@@ -1,7 +1,13 @@
 #include "physical_led_updater.h"
 #include "render_engine.h"
-#include "led_strip.h"
-#include "led_strip_types.h"
+#include "led_pack.h"
+#include "led_topology.h"
+#include "frame_telemetry.h"
+#include "ws2812_encoder.h"
+#include "ws2812_spi_encoder.h"
+#include "driver/rmt_tx.h"
+#include "driver/spi_master.h"
+#include "esp_heap_caps.h"
 #include <string.h>
 #include <math.h>
 #include <freertos/FreeRTOS.h>
@@ -11,16 +17,91 @@
 #include "main.h"
 
 #define LED_STRIP_GPIO 17
-#define LED_STRIP_LENGTH 60
-#define NUM_EDGES 4
-#define LEDS_PER_EDGE (LED_STRIP_LENGTH / NUM_EDGES)  // 15 LEDs per edge
+#define LED_STRIP_WIRE_FORMAT LED_WIRE_GRB       // WS2812
+#define LED_RMT_RESOLUTION_HZ (10 * 1000 * 1000)
+#define LED_OUTPUT_MAX_CHANNELS 4                // RMT TX channels on the ESP32-S3
+#define LED_RMT_MEM_BLOCK_SYMBOLS 64
+#define LED_RMT_SHARED_MEM_BLOCK_SYMBOLS 48      // Minimum block, so four channels fit
+#define LED_RMT_DMA_MEM_BLOCK_SYMBOLS 1024        // 4 KB DMA buffer, refilled in halves
+#define DEFAULT_NUM_EDGES 4
+#define DEFAULT_LEDS_PER_EDGE 15
 
 static const char *TAG = "LED_HANDLER";
 
-// LED strip handle
-static led_strip_handle_t strip = NULL;
+// How a data line is driven
+typedef enum {
+    LED_OUTPUT_RMT,         // RMT with ping-pong refills of channel memory from the ISR
+    LED_OUTPUT_RMT_DMA,     // RMT fed by DMA from a buffer holding the whole encoded frame
+    LED_OUTPUT_SPI_DMA,     // SPI MOSI clocking a pre-encoded WS2812 bitstream over DMA
+} led_output_backend_t;
+
+// One data line; entry N drives topology channel N
+typedef struct {
+    int gpio;
+    led_output_backend_t backend;
+} led_output_channel_config_t;
+
+// Output wiring. Which edges sit on which line, and where, comes from the topology.
+// Giving each edge (or group of edges) its own line makes a frame take as long as
+// the longest chain instead of the sum, e.g.:
+//     { 17, LED_OUTPUT_RMT }, { 18, LED_OUTPUT_RMT },
+//     { 8, LED_OUTPUT_RMT },  { 3, LED_OUTPUT_RMT_DMA }
+// Long chains should use a DMA backend: the ESP32-S3 has one DMA-capable RMT TX
+// channel and two SPI hosts (SPI2/SPI3) for LED_OUTPUT_SPI_DMA.
+static const led_output_channel_config_t output_channel_configs[] = {
+    { .gpio = LED_STRIP_GPIO, .backend = LED_OUTPUT_RMT },
+};
+#define LED_OUTPUT_CHANNELS (sizeof(output_channel_configs) / sizeof(output_channel_configs[0]))
+_Static_assert(LED_OUTPUT_CHANNELS <= LED_OUTPUT_MAX_CHANNELS, "too many LED output channels");
+
+typedef struct {
+    led_output_backend_t backend;
+    uint8_t *wire;          // This channel's segment of wire_buffer
+    size_t wire_size;
+    size_t wire_length;
+    // RMT backends
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    // SPI backend: DMA-capable bitstream encoded from wire before each transfer
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi;
+    uint8_t *spi_bits;
+    spi_transaction_t spi_transaction;
+    bool spi_in_flight;
+} led_output_channel_t;
+
+// Default fixture: four 15-LED edges chained in order on channel 0
+static const LedTopology default_topology = {
+    .num_edges = DEFAULT_NUM_EDGES,
+    .serpentine = false,
+    .edges = {
+        { .length = DEFAULT_LEDS_PER_EDGE, .start_offset = 0 * DEFAULT_LEDS_PER_EDGE, .channel = 0 },
+        { .length = DEFAULT_LEDS_PER_EDGE, .start_offset = 1 * DEFAULT_LEDS_PER_EDGE, .channel = 0 },
+        { .length = DEFAULT_LEDS_PER_EDGE, .start_offset = 2 * DEFAULT_LEDS_PER_EDGE, .channel = 0 },
+        { .length = DEFAULT_LEDS_PER_EDGE, .start_offset = 3 * DEFAULT_LEDS_PER_EDGE, .channel = 0 },
+    },
+};
+
+// Active fixture and its compiled physical -> logical map
+static LedTopology topology;
+static LedTopologyMap topology_map;
+
+// Output channels
+static led_output_channel_t output_channels[LED_OUTPUT_CHANNELS];
+static rmt_sync_manager_handle_t output_sync = NULL;    // Starts all RMT channels together
+static bool output_ready = false;                        // Output channels initialized
 static bool led_task_running = false;
 
+// Packed wire-order frame, one contiguous segment per channel
+static uint8_t *wire_buffer = NULL;
+static size_t wire_buffer_size = 0;
+static size_t wire_length = 0;
+static bool wire_current = false;   // wire_buffer holds the last frame acquired
+static const LedPackConfig pack_config = {
+    .format = LED_STRIP_WIRE_FORMAT,
+    .channel_lut = NULL,
+};
+
 
 
 
@@ -34,7 +115,14 @@ typedef struct {
     int visual_pattern_id;  // ID from visual_LED library
 } edge_state_t;
 
-static edge_state_t edge_states[NUM_EDGES] = {0};
+static edge_state_t edge_states[MAX_EDGES] = {0};
+
+// Edge changes made inside the handler's batch are staged here and copied into
+// edge_states only when its outermost commit has published them, so a dropped
+// batch leaves every edge with the pattern (and handle) it really has
+static edge_state_t staged_states[MAX_EDGES];
+static uint32_t staged_edges;           // Bit per edge with a staged change
+static int edge_batch_depth;
 
 // Pattern names for easy reference
 static const char* pattern_names[] = {
@@ -50,36 +138,222 @@ static const char* pattern_names[] = {
 
 
 
-// Get LED index range for an edge
-static void get_edge_range(uint8_t edge_id, int* start_idx, int* end_idx) {
-    *start_idx = edge_id * LEDS_PER_EDGE;
-    *end_idx = *start_idx + LEDS_PER_EDGE - 1;
-    if (*end_idx >= LED_STRIP_LENGTH) {
-        *end_idx = LED_STRIP_LENGTH - 1;
+// Wait until every channel has finished sending out of its buffers
+static void wait_output_idle(void) {
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        led_output_channel_t* out = &output_channels[c];
+        if (out->wire_size == 0) continue;     // No LEDs on this line, never brought up
+        if (out->backend == LED_OUTPUT_SPI_DMA) {
+            if (out->spi_in_flight) {
+                spi_transaction_t* done;
+                spi_device_get_trans_result(out->spi, &done, portMAX_DELAY);
+                out->spi_in_flight = false;
+            }
+        } else {
+            rmt_tx_wait_all_done(out->channel, portMAX_DELAY);
+        }
     }
 }
 
-// Convert visual LED matrix to physical LED strip
-static void update_physical_strip(void) {
-    if (!led_controller || !strip) return;
+// Send every channel's packed segment; with a sync manager the RMT channels start on the same clock edge
+static void transmit_wire_buffer(void) {
+    if (!output_ready) return;
     
-    for (int edge = 0; edge < NUM_EDGES; edge++) {
-        int start_idx, end_idx;
-        get_edge_range(edge, &start_idx, &end_idx);
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0,
+    };
+    if (output_sync) {
+        ESP_ERROR_CHECK(rmt_sync_reset(output_sync));
+    }
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        led_output_channel_t* out = &output_channels[c];
+        if (out->wire_length == 0) continue;
         
-        for (int i = start_idx; i <= end_idx; i++) {
-            int led_idx = i - start_idx;
-            LedState_t color = led_matrix_get_led(currentLedConfigState, edge, led_idx);
-            
-            // Apply intensity scaling
-            uint8_t r = (color.r * color.intensity) / 255;
-            uint8_t g = (color.g * color.intensity) / 255;
-            uint8_t b = (color.b * color.intensity) / 255;
-            
-            led_strip_set_pixel(strip, i, r, g, b);
+        if (out->backend == LED_OUTPUT_SPI_DMA) {
+            // Whole frame is encoded up front; the transfer itself runs without the CPU
+            size_t bits_len = ws2812_spi_encode(out->wire, out->wire_length, out->spi_bits);
+            memset(&out->spi_transaction, 0, sizeof(out->spi_transaction));
+            out->spi_transaction.length = bits_len * 8;
+            out->spi_transaction.tx_buffer = out->spi_bits;
+            ESP_ERROR_CHECK(spi_device_queue_trans(out->spi, &out->spi_transaction, portMAX_DELAY));
+            out->spi_in_flight = true;
+        } else {
+            ESP_ERROR_CHECK(rmt_transmit(out->channel, out->encoder, out->wire, out->wire_length, &tx_config));
         }
     }
 }
+
+// Bring up one output channel on its backend
+static esp_err_t output_channel_init(int index, int spi_host_index) {
+    const led_output_channel_config_t* config = &output_channel_configs[index];
+    led_output_channel_t* out = &output_channels[index];
+    out->backend = config->backend;
+    
+    if (config->backend == LED_OUTPUT_SPI_DMA) {
+        static const spi_host_device_t spi_hosts[] = { SPI2_HOST, SPI3_HOST };
+        if (spi_host_index >= (int)(sizeof(spi_hosts) / sizeof(spi_hosts[0]))) {
+            ESP_LOGE(TAG, "No SPI host left for output channel %d", index);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        
+        size_t bits_size = ws2812_spi_encoded_size(out->wire_size);
+        out->spi_bits = heap_caps_malloc(bits_size, MALLOC_CAP_DMA);
+        if (!out->spi_bits) return ESP_ERR_NO_MEM;
+        out->spi_host = spi_hosts[spi_host_index];
+        
+        spi_bus_config_t bus_config = {
+            .mosi_io_num = config->gpio,
+            .miso_io_num = -1,
+            .sclk_io_num = -1,
+            .quadwp_io_num = -1,
+            .quadhd_io_num = -1,
+            .max_transfer_sz = bits_size,
+        };
+        esp_err_t err = spi_bus_initialize(out->spi_host, &bus_config, SPI_DMA_CH_AUTO);
+        if (err != ESP_OK) {
+            heap_caps_free(out->spi_bits);
+            out->spi_bits = NULL;
+            return err;
+        }
+        
+        spi_device_interface_config_t device_config = {
+            .clock_speed_hz = WS2812_SPI_CLOCK_HZ,
+            .mode = 0,
+            .spics_io_num = -1,
+            .queue_size = 1,
+        };
+        err = spi_bus_add_device(out->spi_host, &device_config, &out->spi);
+        if (err != ESP_OK) {
+            spi_bus_free(out->spi_host);
+            heap_caps_free(out->spi_bits);
+            out->spi_bits = NULL;
+        }
+        return err;
+    }
+    
+    // RMT: in DMA mode every wire bit takes a 4-byte symbol, so a whole frame would
+    // cost 32 bytes of DMA RAM per LED. The buffer is capped instead and the driver
+    // refills each half from the encoder as the other half goes out; short chains
+    // still fit in one go (bits + reset, rounded to even).
+    bool with_dma = (config->backend == LED_OUTPUT_RMT_DMA);
+    size_t mem_block_symbols = LED_OUTPUT_CHANNELS > 1 ? LED_RMT_SHARED_MEM_BLOCK_SYMBOLS : LED_RMT_MEM_BLOCK_SYMBOLS;
+    if (with_dma) {
+        mem_block_symbols = (out->wire_size * 8 + 2) & ~(size_t)1;
+        if (mem_block_symbols > LED_RMT_DMA_MEM_BLOCK_SYMBOLS) mem_block_symbols = LED_RMT_DMA_MEM_BLOCK_SYMBOLS;
+    }
+    rmt_tx_channel_config_t tx_config = {
+        .gpio_num = config->gpio,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = LED_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = mem_block_symbols,
+        .trans_queue_depth = 4,
+        .flags = {
+            .invert_out = false,
+            .with_dma = with_dma
+        }
+    };
+    esp_err_t err = rmt_new_tx_channel(&tx_config, &out->channel);
+    if (err != ESP_OK) return err;
+    
+    ws2812_encoder_config_t encoder_config = {
+        .resolution_hz = LED_RMT_RESOLUTION_HZ,
+    };
+    err = ws2812_encoder_new(&encoder_config, &out->encoder);
+    if (err == ESP_OK) err = rmt_enable(out->channel);
+    if (err != ESP_OK) {
+        if (out->encoder) rmt_del_encoder(out->encoder);
+        rmt_del_channel(out->channel);
+        out->encoder = NULL;
+        out->channel = NULL;
+    }
+    return err;
+}
+
+// Undo output init: sync manager, every channel brought up, wire buffer and map.
+// Safe on a partial init; channels left without a handle are skipped.
+static void output_deinit(void) {
+    if (output_ready) wait_output_idle();
+    output_ready = false;
+    if (output_sync) {
+        rmt_del_sync_manager(output_sync);
+        output_sync = NULL;
+    }
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        led_output_channel_t* out = &output_channels[c];
+        if (out->channel) {
+            rmt_disable(out->channel);
+            rmt_del_channel(out->channel);
+        }
+        if (out->encoder) rmt_del_encoder(out->encoder);
+        if (out->spi) {
+            spi_bus_remove_device(out->spi);
+            spi_bus_free(out->spi_host);
+        }
+        if (out->spi_bits) heap_caps_free(out->spi_bits);
+        memset(out, 0, sizeof(*out));
+    }
+    free(wire_buffer);
+    wire_buffer = NULL;
+    wire_buffer_size = 0;
+    wire_length = 0;
+    wire_current = false;
+    led_topology_free_map(&topology_map);
+}
+
+// Convert visual LED matrix to physical LED strip, repacking only the channels
+// with an edge in changed_edges. Returns whether any channel has to be sent.
+static bool update_physical_strip(LedEdgeConfigState_t* frame, uint32_t changed_edges) {
+    if (!led_controller || !output_ready || !frame) return false;
+    
+    // The previous frame may still be going out of the buffer we are about to overwrite
+    wait_output_idle();
+    
+    bool any = false;
+    bool any_rmt = false;
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        led_output_channel_t* out = &output_channels[c];
+        out->wire_length = 0;
+        if (out->wire_size == 0) continue;
+        if (wire_current && !(topology_map.channel_edges[c] & changed_edges)) continue;
+        
+        led_pack_gather(frame, topology_map.source + topology_map.channel_offset[c],
+                        topology_map.channel_length[c], &pack_config, out->wire, out->wire_size);
+        out->wire_length = out->wire_size;
+        any = true;
+        if (out->backend != LED_OUTPUT_SPI_DMA) any_rmt = true;
+    }
+    wire_length = wire_buffer_size;
+    wire_current = true;
+    
+    // The sync manager only starts once every channel in it has been given data:
+    // unchanged RMT channels go out again alongside a changed one
+    if (output_sync && any_rmt) {
+        for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+            led_output_channel_t* out = &output_channels[c];
+            if (out->backend != LED_OUTPUT_SPI_DMA) out->wire_length = out->wire_size;
+        }
+    }
+    return any;
+}
+
+// Send an all-off frame on every channel
+static void clear_output(void) {
+    wait_output_idle();
+    memset(wire_buffer, 0, wire_buffer_size);
+    wire_length = wire_buffer_size;
+    wire_current = false;   // The next frame is packed in full
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        output_channels[c].wire_length = output_channels[c].wire_size;
+    }
+    transmit_wire_buffer();
+}
+
+// Packed bytes of the last frame sent to the strip
+const uint8_t* led_handler_get_packed_buffer(size_t* length) {
+    if (length) *length = wire_length;
+    return wire_buffer;
+}
+
 // LED update task
  void led_update_task(void *param) {
     uint32_t notification_value;
@@ -87,60 +361,129 @@ static void update_physical_strip(void) {
     while (led_task_running) {
         // Wait for notification from render task
         if (xTaskNotifyWait(0, ULONG_MAX, &notification_value, pdMS_TO_TICKS(100)) == pdTRUE) {
-            // New frame is ready, update physical strip
-            update_physical_strip();
+            frame_telemetry_notify_received();
+            
+            // New frame is ready, take the newest one without waiting on the renderer
+            bool is_new = false;
+            uint32_t changed_edges = 0;
+            LedEdgeConfigState_t* frame = framebuffer_acquire_changes(&is_new, &changed_edges);
+            
+            // Identical frame: skip both the pixel upload and the RMT transmission
+            if (!is_new) continue;
+            
+            // Only channels with a changed edge are packed and sent again
+            int64_t pack_start = frame_telemetry_now();
+            bool changed = update_physical_strip(frame, changed_edges);
+            frame_telemetry_record(TELEMETRY_PACK, pack_start);
+            if (!changed) continue;
             
             // Refresh strip
-            if (strip) {
-                led_strip_refresh(strip);
-            }
+            int64_t transmit_start = frame_telemetry_now();
+            transmit_wire_buffer();
+            frame_telemetry_record(TELEMETRY_TRANSMIT, transmit_start);
         }
         // If timeout occurs, continue loop
     }
     
     vTaskDelete(NULL);
 }
-// Initialize LED handler
+// Initialize LED handler with the default fixture
 void led_handler_init(void) {
+    led_handler_init_with_topology(&default_topology);
+}
+
+// Initialize LED handler for an arbitrary fixture
+void led_handler_init_with_topology(const LedTopology* fixture) {
     ESP_LOGI(TAG, "Initializing LED handler with Visual LED library...");
     
-    // Initialize LED strip
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = LED_STRIP_GPIO,
-        .max_leds = LED_STRIP_LENGTH,
-        .led_model = LED_MODEL_WS2812,
-        .color_component_format = LED_STRIP_COLOR_COMPONENT_FMT_GRB,
-        .flags = {
-            .invert_out = false
+    topology = *fixture;
+    if (!led_topology_build_map(&topology, &topology_map)) {
+        ESP_LOGE(TAG, "Invalid LED topology");
+        return;
+    }
+    if (topology_map.channel_count > LED_OUTPUT_CHANNELS) {
+        ESP_LOGE(TAG, "Topology uses %d channels, %d configured",
+                 topology_map.channel_count, (int)LED_OUTPUT_CHANNELS);
+        led_topology_free_map(&topology_map);
+        return;
+    }
+    
+    // Size each channel's segment of the wire buffer from its physical chain length
+    uint8_t bytes_per_pixel = led_pack_bytes_per_pixel(LED_STRIP_WIRE_FORMAT);
+    wire_buffer_size = 0;
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        output_channels[c].wire_size = topology_map.channel_length[c] * bytes_per_pixel;
+        wire_buffer_size += output_channels[c].wire_size;
+    }
+    if (wire_buffer_size == 0) {
+        ESP_LOGE(TAG, "LED topology has no LEDs");
+        output_deinit();
+        return;
+    }
+    wire_buffer = calloc(1, wire_buffer_size);
+    if (!wire_buffer) {
+        ESP_LOGE(TAG, "Failed to allocate wire buffer");
+        output_deinit();
+        return;
+    }
+    
+    // Initialize one output channel per data line with LEDs on it. Lines the
+    // topology leaves empty are never sent to, so they stay down and out of the
+    // sync group, which would otherwise wait on them forever.
+    rmt_channel_handle_t rmt_channels[LED_OUTPUT_CHANNELS];
+    int rmt_channel_count = 0;
+    int spi_host_index = 0;
+    uint8_t* segment = wire_buffer;
+    for (int c = 0; c < LED_OUTPUT_CHANNELS; c++) {
+        led_output_channel_t* out = &output_channels[c];
+        out->wire = segment;
+        segment += out->wire_size;
+        if (out->wire_size == 0) continue;
+        
+        esp_err_t err = output_channel_init(c, spi_host_index);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize output channel %d (error 0x%x)", c, err);
+            output_deinit();
+            return;
         }
-    };
-
-    led_strip_rmt_config_t rmt_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = 10 * 1000 * 1000,
-        .mem_block_symbols = 64,
-        .flags = {
-            .with_dma = false
+        if (out->backend == LED_OUTPUT_SPI_DMA) {
+            spi_host_index++;
+        } else {
+            rmt_channels[rmt_channel_count++] = out->channel;
         }
-    };
-
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &strip));
-    ESP_ERROR_CHECK(led_strip_clear(strip));
+    }
     
-    // Initialize visual LED controller
-    int leds_per_edge[NUM_EDGES];
-    for (int i = 0; i < NUM_EDGES; i++) {
-        leds_per_edge[i] = LEDS_PER_EDGE;
+    // Start all RMT channels together so the frame lands on every edge at once
+    if (rmt_channel_count > 1) {
+        rmt_sync_manager_config_t sync_config = {
+            .tx_channel_array = rmt_channels,
+            .array_size = rmt_channel_count,
+        };
+        esp_err_t err = rmt_new_sync_manager(&sync_config, &output_sync);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create RMT sync manager (error 0x%x)", err);
+            output_deinit();
+            return;
+        }
     }
+    output_ready = true;
+    
+    // Start with the strip dark
+    clear_output();
     
-    led_controller = led_controller_create(NUM_EDGES, leds_per_edge);
+    // Initialize visual LED controller with the fixture's logical edges
+    int leds_per_edge[MAX_EDGES];
+    led_topology_edge_lengths(&topology, leds_per_edge);
+    
+    led_controller = led_controller_create(topology.num_edges, leds_per_edge);
     if (!led_controller) {
         ESP_LOGE(TAG, "Failed to create LED controller");
+        output_deinit();
         return;
     }
     
     // Initialize edge states
-    for (int i = 0; i < NUM_EDGES; i++) {
+    for (int i = 0; i < topology.num_edges; i++) {
         edge_states[i].pattern = LED_PATTERN_OFF;
         edge_states[i].active = false;
         edge_states[i].visual_pattern_id = -1;
@@ -150,7 +493,7 @@ void led_handler_init(void) {
     led_task_running = true;
     
     // ESP_LOGI(TAG, "LED handler initialized with Visual LED library - %" PRIu32 "edges, %"PRIu32" LEDs per edge", 
-            //  NUM_EDGES, LEDS_PER_EDGE);
+            //  topology.num_edges, topology_map.physical_count);
 }
 
 // Deinitialize LED handler
@@ -176,10 +519,10 @@ void led_tasks_cleanup(void) {
 static int create_visual_pattern(uint8_t edge_id, uint8_t pattern, 
                                 uint8_t r, uint8_t g, uint8_t b, 
                                 uint8_t intensity, uint32_t speed_ms) {
-    if (!led_controller || edge_id >= NUM_EDGES) return -1;
+    if (!led_controller || edge_id >= topology.num_edges) return -1;
     
     int start_idx = 0;
-    int end_idx = LEDS_PER_EDGE - 1;
+    int end_idx = topology.edges[edge_id].length - 1;
     LedState_t color = led_color_create(r, g, b, intensity);
     
     switch (pattern) {
@@ -230,29 +573,53 @@ static int create_visual_pattern(uint8_t edge_id, uint8_t pattern,
 
 
 
-// Set pattern for specific edge - MAIN FUNCTION
-void led_set_edge_pattern(uint8_t edge_id, uint8_t pattern, 
-                         uint8_t r, uint8_t g, uint8_t b, 
-                         uint8_t intensity, uint32_t speed_ms) {
-    if (edge_id >= NUM_EDGES) {
-        ESP_LOGE(TAG, "Invalid edge_id: %d", edge_id);
-        return;
-    }
+static void edge_batch_begin(void) {
+    if (edge_batch_depth++ == 0) staged_edges = 0;
+    led_batch_begin(led_controller);
+}
+
+// Commit the handler's batch; the outermost commit adopts the staged edge states
+// if the batch was published and discards them if it was dropped
+static BaseType_t edge_batch_commit(void) {
+    BaseType_t result = led_batch_commit(led_controller);
+    if (--edge_batch_depth > 0) return result;
     
-    if (pattern > LED_PATTERN_TWINKLE) {
-        ESP_LOGE(TAG, "Invalid pattern: %d", pattern);
-        return;
+    if (result == pdPASS) {
+        for (int i = 0; i < topology.num_edges; i++) {
+            if (staged_edges & (1u << i)) edge_states[i] = staged_states[i];
+        }
     }
-    
-    edge_state_t* state = &edge_states[edge_id];
+    staged_edges = 0;
+    return result;
+}
+
+// State of an edge as the open batch leaves it
+static edge_state_t* edge_staged_state(uint8_t edge_id) {
+    if (!(staged_edges & (1u << edge_id))) {
+        staged_states[edge_id] = edge_states[edge_id];
+        staged_edges |= 1u << edge_id;
+    }
+    return &staged_states[edge_id];
+}
+
+// Queue the swap of an edge's pattern into the open batch and stage its new state
+static void queue_edge_pattern(uint8_t edge_id, uint8_t pattern,
+                               uint8_t r, uint8_t g, uint8_t b,
+                               uint8_t intensity, uint32_t speed_ms) {
+    edge_state_t* state = edge_staged_state(edge_id);
     
     // Remove existing pattern if active
     if (state->visual_pattern_id >= 0) {
         led_pattern_remove(led_controller, state->visual_pattern_id);
-        state->visual_pattern_id = -1;
+    }
+    
+    int visual_pattern_id = -1;
+    if (pattern != LED_PATTERN_OFF) {
+        visual_pattern_id = create_visual_pattern(edge_id, pattern, r, g, b, intensity, speed_ms);
     }
     
     // Set new pattern parameters
+    state->visual_pattern_id = visual_pattern_id;
     state->pattern = pattern;
     state->r = r;
     state->g = g;
@@ -260,15 +627,28 @@ void led_set_edge_pattern(uint8_t edge_id, uint8_t pattern,
     state->intensity = intensity;
     state->speed_ms = speed_ms < 1000 ? 1000 : speed_ms;
     state->active = (pattern != LED_PATTERN_OFF);
+}
+
+// Set pattern for specific edge - MAIN FUNCTION
+void led_set_edge_pattern(uint8_t edge_id, uint8_t pattern, 
+                         uint8_t r, uint8_t g, uint8_t b, 
+                         uint8_t intensity, uint32_t speed_ms) {
+    if (edge_id >= topology.num_edges) {
+        ESP_LOGE(TAG, "Invalid edge_id: %d", edge_id);
+        return;
+    }
     
-    // Create visual pattern
-    if (state->active) {
-        state->visual_pattern_id = create_visual_pattern(edge_id, pattern, r, g, b, 
-                                                       intensity, speed_ms);
-        if (state->visual_pattern_id < 0) {
-            // ESP_LOGE(TAG, "Failed to create visual pattern for edge %d", edge_id);
-            state->active = false;
-        }
+    if (pattern > LED_PATTERN_TWINKLE) {
+        ESP_LOGE(TAG, "Invalid pattern: %d", pattern);
+        return;
+    }
+    
+    // Old pattern out and new one in on the same frame
+    edge_batch_begin();
+    queue_edge_pattern(edge_id, pattern, r, g, b, intensity, speed_ms);
+    if (edge_batch_commit() != pdPASS) {
+        // Nothing was applied; the edge keeps its current pattern
+        ESP_LOGE(TAG, "Failed to queue pattern change for edge %d", edge_id);
     }
     
     // ESP_LOGI(TAG, "Edge %"PRIu32": Pattern %s, RGB(%"PRIu32",%"PRIu32",%"PRIu32"), Intensity=%"PRIu32", Speed=%" PRIu32 "ms", 
@@ -282,8 +662,12 @@ void led_turn_off_edge(uint8_t edge_id) {
 
 // Turn off all edges
 void led_turn_off_all(void) {
-    for (int i = 0; i < NUM_EDGES; i++) {
-        led_turn_off_edge(i);
+    edge_batch_begin();
+    for (int i = 0; i < topology.num_edges; i++) {
+        queue_edge_pattern(i, LED_PATTERN_OFF, 0, 0, 0, 0, 1000);
+    }
+    if (edge_batch_commit() != pdPASS) {
+        ESP_LOGE(TAG, "Failed to queue turning off all edges");
     }
 }
 
@@ -297,12 +681,12 @@ void led_show_all_patterns(void) {
 
 // Demo function - cycles through all patterns on a specific edge
 void led_demo_edge_patterns(uint8_t edge_id) {
-    if (edge_id >= NUM_EDGES) return;
+    if (edge_id >= topology.num_edges) return;
     
     // ESP_LOGI(TAG, "Starting pattern demo on edge %"PRIu32"", edge_id);
     
     // Turn off all other edges
-    for (int i = 0; i < NUM_EDGES; i++) {
+    for (int i = 0; i < topology.num_edges; i++) {
         if (i != edge_id) {
             led_turn_off_edge(i);
         }
@@ -334,18 +718,32 @@ void led_demo_edge_patterns(uint8_t edge_id) {
 void led_test_all_edges(void) {
     ESP_LOGI(TAG, "Testing different patterns on all edges");
     
-    // Set different patterns on each edge
-    led_set_edge_pattern(0, LED_PATTERN_STATIC, 255, 0, 0, 200, 1000);     // Red static
-    led_set_edge_pattern(1, LED_PATTERN_BLINK, 0, 255, 0, 200, 1000);      // Green blink
-    led_set_edge_pattern(2, LED_PATTERN_BREATH, 0, 0, 255, 200, 3000);     // Blue breath
-    led_set_edge_pattern(3, LED_PATTERN_RAINBOW, 255, 255, 255, 200, 5000); // Rainbow
+    // Set different patterns on each edge, all starting on the same frame
+    static const struct {
+        uint8_t pattern;
+        uint8_t r, g, b;
+        uint32_t speed_ms;
+    } tests[] = {
+        { LED_PATTERN_STATIC, 255, 0, 0, 1000 },        // Red static
+        { LED_PATTERN_BLINK, 0, 255, 0, 1000 },         // Green blink
+        { LED_PATTERN_BREATH, 0, 0, 255, 3000 },        // Blue breath
+        { LED_PATTERN_RAINBOW, 255, 255, 255, 5000 },   // Rainbow
+    };
+    edge_batch_begin();
+    for (int i = 0; i < topology.num_edges && i < (int)(sizeof(tests) / sizeof(tests[0])); i++) {
+        queue_edge_pattern(i, tests[i].pattern, tests[i].r, tests[i].g, tests[i].b, 200, tests[i].speed_ms);
+    }
+    if (edge_batch_commit() != pdPASS) {
+        ESP_LOGE(TAG, "Failed to queue the edge test patterns");
+        return;
+    }
     
     ESP_LOGI(TAG, "All edges running different patterns");
 }
 
 // Get edge status
 void led_get_edge_status(uint8_t edge_id) {
-    if (edge_id >= NUM_EDGES) return;
+    if (edge_id >= topology.num_edges) return;
     
     edge_state_t* state = &edge_states[edge_id];
     // ESP_LOGI(TAG, "Edge %"PRIu32": Pattern=%s, RGB(%"PRIu32",%"PRIu32",%"PRIu32"), Intensity=%"PRIu32", Speed=%"PRIu32"ms, Active=%s",
@@ -357,29 +755,35 @@ void led_get_edge_status(uint8_t edge_id) {
 // Get all edges status
 void led_get_all_status(void) {
     ESP_LOGI(TAG, "=== LED Status ===");
-    for (int i = 0; i < NUM_EDGES; i++) {
+    for (int i = 0; i < topology.num_edges; i++) {
         led_get_edge_status((uint8_t)i);
     }
 }
 
 // Clear all patterns and turn off LEDs
 void led_clear_all(void) {
-    for (int i = 0; i < NUM_EDGES; i++) {
-        if (edge_states[i].visual_pattern_id >= 0) {
-            led_pattern_remove(led_controller, edge_states[i].visual_pattern_id);
-            edge_states[i].visual_pattern_id = -1;
+    edge_batch_begin();
+    for (int i = 0; i < topology.num_edges; i++) {
+        edge_state_t* state = edge_staged_state(i);
+        if (state->visual_pattern_id >= 0) {
+            led_pattern_remove(led_controller, state->visual_pattern_id);
+            state->visual_pattern_id = -1;
         }
-        edge_states[i].pattern = LED_PATTERN_OFF;
-        edge_states[i].active = false;
+        state->pattern = LED_PATTERN_OFF;
+        state->active = false;
+    }
+    if (edge_batch_commit() != pdPASS) {
+        // The patterns are all still running and edge_states still holds their handles
+        ESP_LOGE(TAG, "Failed to queue clearing all edges");
+        return;
     }
     
     if (led_controller) {
         led_controller_clear(led_controller);
     }
     
-    if (strip) {
-        led_strip_clear(strip);
-        led_strip_refresh(strip);
+    if (output_ready) {
+        clear_output();
     }
     
     ESP_LOGI(TAG, "All LEDs cleared");
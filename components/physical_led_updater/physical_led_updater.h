@@ -88,6 +88,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "led_topology.h"
 
 // Available LED patterns
 typedef enum {
@@ -104,6 +106,10 @@ typedef enum {
 // Initialize LED handler
 void led_handler_init(void);
 
+// Initialize LED handler for a fixture with its own edge lengths, channels,
+// start offsets and reversed/serpentine wiring
+void led_handler_init_with_topology(const LedTopology* fixture);
+
 // Deinitialize LED handler
 void led_handler_deinit(void);
 
@@ -117,6 +123,8 @@ void led_handler_deinit(void);
 // r, g, b: RGB color values (0-255)
 // intensity: brightness (0-255)
 // speed_ms: animation speed in milliseconds (minimum 1000ms)
+// Each call is its own batch and the edge state only changes once it is queued;
+// call from the handler's task, not inside a caller's led_batch_begin
 void led_set_edge_pattern(uint8_t edge_id, uint8_t pattern, 
                          uint8_t r, uint8_t g, uint8_t b, 
                          uint8_t intensity, uint32_t speed_ms);
@@ -145,4 +153,7 @@ void led_get_all_status(void);
 // Clear all patterns and turn off LEDs
 void led_clear_all(void);
 
+// Wire-order bytes of the last frame packed for the strip (length in bytes)
+const uint8_t* led_handler_get_packed_buffer(size_t* length);
+
 #endif // LED_HANDLER_H
\ No newline at end of file
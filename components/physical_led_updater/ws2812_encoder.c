@@ -0,0 +1,128 @@
+#include "ws2812_encoder.h"
+#include "ws2812_timing.h"
+#include <stdlib.h>
+#include "esp_check.h"
+
+static const char *TAG = "WS2812_ENCODER";
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+} ws2812_encoder_t;
+
+static size_t ws2812_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                            const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    ws2812_encoder_t *ws_encoder = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+    int state = RMT_ENCODING_RESET;
+    size_t encoded_symbols = 0;
+
+    switch (ws_encoder->state) {
+    case 0: // Pixel bytes
+        encoded_symbols += ws_encoder->bytes_encoder->encode(ws_encoder->bytes_encoder, channel,
+                                                             primary_data, data_size, &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            ws_encoder->state = 1;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // Yield until the channel has room again
+        }
+    // fall-through
+    case 1: // Reset code latches the frame
+        encoded_symbols += ws_encoder->copy_encoder->encode(ws_encoder->copy_encoder, channel,
+                                                            &ws_encoder->reset_code,
+                                                            sizeof(ws_encoder->reset_code), &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            ws_encoder->state = RMT_ENCODING_RESET;
+            state |= RMT_ENCODING_COMPLETE;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out;
+        }
+    }
+out:
+    *ret_state = (rmt_encode_state_t)state;
+    return encoded_symbols;
+}
+
+static esp_err_t ws2812_encoder_del(rmt_encoder_t *encoder)
+{
+    ws2812_encoder_t *ws_encoder = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_del_encoder(ws_encoder->bytes_encoder);
+    rmt_del_encoder(ws_encoder->copy_encoder);
+    free(ws_encoder);
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_encoder_reset(rmt_encoder_t *encoder)
+{
+    ws2812_encoder_t *ws_encoder = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encoder_reset(ws_encoder->bytes_encoder);
+    rmt_encoder_reset(ws_encoder->copy_encoder);
+    ws_encoder->state = RMT_ENCODING_RESET;
+    return ESP_OK;
+}
+
+esp_err_t ws2812_encoder_new(const ws2812_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    ws2812_encoder_t *ws_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+
+    ws_encoder = calloc(1, sizeof(ws2812_encoder_t));
+    ESP_GOTO_ON_FALSE(ws_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for ws2812 encoder");
+    ws_encoder->base.encode = ws2812_encode;
+    ws_encoder->base.del = ws2812_encoder_del;
+    ws_encoder->base.reset = ws2812_encoder_reset;
+
+    ws2812_rmt_ticks_t ticks = ws2812_rmt_ticks(config->resolution_hz);
+    rmt_bytes_encoder_config_t bytes_encoder_config = {
+        .bit0 = {
+            .level0 = 1,
+            .duration0 = ticks.t0h,
+            .level1 = 0,
+            .duration1 = ticks.t0l,
+        },
+        .bit1 = {
+            .level0 = 1,
+            .duration0 = ticks.t1h,
+            .level1 = 0,
+            .duration1 = ticks.t1l,
+        },
+        .flags.msb_first = 1,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &ws_encoder->bytes_encoder), err, TAG,
+                      "create bytes encoder failed");
+
+    rmt_copy_encoder_config_t copy_encoder_config = {};
+    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &ws_encoder->copy_encoder), err, TAG,
+                      "create copy encoder failed");
+
+    ws_encoder->reset_code = (rmt_symbol_word_t) {
+        .level0 = 0,
+        .duration0 = ticks.reset_half,
+        .level1 = 0,
+        .duration1 = ticks.reset_half,
+    };
+
+    *ret_encoder = &ws_encoder->base;
+    return ESP_OK;
+
+err:
+    if (ws_encoder) {
+        if (ws_encoder->bytes_encoder) {
+            rmt_del_encoder(ws_encoder->bytes_encoder);
+        }
+        if (ws_encoder->copy_encoder) {
+            rmt_del_encoder(ws_encoder->copy_encoder);
+        }
+        free(ws_encoder);
+    }
+    return ret;
+}
@@ -0,0 +1,24 @@
+#ifndef WS2812_ENCODER_H
+#define WS2812_ENCODER_H
+
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t resolution_hz;     // RMT channel tick rate
+} ws2812_encoder_config_t;
+
+// RMT encoder that streams pre-packed wire bytes as WS2812 bits followed by a reset
+// code, so a whole frame goes out with a single rmt_transmit() call
+esp_err_t ws2812_encoder_new(const ws2812_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WS2812_ENCODER_H
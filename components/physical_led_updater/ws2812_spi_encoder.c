@@ -0,0 +1,84 @@
+#include "ws2812_spi_encoder.h"
+#include <string.h>
+#include <stdbool.h>
+
+// 12-bit SPI pattern for each 4-bit nibble (three SPI bits per data bit, MSB first)
+static const uint16_t nibble_codes[16] = {
+    0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+    0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6,
+};
+
+// Derived SPI timings must sit inside the WS2812 windows
+#define SPI_BIT_NS (1000000000u / WS2812_SPI_CLOCK_HZ)
+_Static_assert(1 * SPI_BIT_NS >= WS2812_T0H_MIN_NS && 1 * SPI_BIT_NS <= WS2812_T0H_MAX_NS, "T0H out of spec");
+_Static_assert(2 * SPI_BIT_NS >= WS2812_T1H_MIN_NS && 2 * SPI_BIT_NS <= WS2812_T1H_MAX_NS, "T1H out of spec");
+_Static_assert(2 * SPI_BIT_NS >= WS2812_T0L_MIN_NS && 2 * SPI_BIT_NS <= WS2812_T0L_MAX_NS, "T0L out of spec");
+_Static_assert(1 * SPI_BIT_NS >= WS2812_T1L_MIN_NS && 1 * SPI_BIT_NS <= WS2812_T1L_MAX_NS, "T1L out of spec");
+_Static_assert(WS2812_SPI_RESET_BYTES * 8 * SPI_BIT_NS >= WS2812_RESET_MIN_NS, "reset gap too short");
+
+size_t ws2812_spi_encode(const uint8_t* wire, size_t wire_len, uint8_t* out) {
+    uint8_t* cursor = out;
+    for (size_t i = 0; i < wire_len; i++) {
+        uint32_t code = ((uint32_t)nibble_codes[wire[i] >> 4] << 12) | nibble_codes[wire[i] & 0x0F];
+        cursor[0] = (uint8_t)(code >> 16);
+        cursor[1] = (uint8_t)(code >> 8);
+        cursor[2] = (uint8_t)code;
+        cursor += WS2812_SPI_BYTES_PER_BYTE;
+    }
+    memset(cursor, 0, WS2812_SPI_RESET_BYTES);
+    cursor += WS2812_SPI_RESET_BYTES;
+    return (size_t)(cursor - out);
+}
+
+static inline int bitstream_bit(const uint8_t* bitstream, size_t bit) {
+    return (bitstream[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+size_t ws2812_spi_check_timing(const uint8_t* bitstream, size_t len, uint32_t spi_hz,
+                               uint8_t* decoded, size_t wire_len) {
+    size_t violations = 0;
+    size_t total_bits = len * 8;
+    size_t bit = 0;
+    size_t data_bits = 0;
+    uint64_t bit_ns = 1000000000ull / spi_hz;
+
+    while (bit < total_bits) {
+        // High pulse, then the low gap that follows it
+        size_t high = 0, low = 0;
+        while (bit < total_bits && bitstream_bit(bitstream, bit)) { high++; bit++; }
+        while (bit < total_bits && !bitstream_bit(bitstream, bit)) { low++; bit++; }
+        if (high == 0) break;       // Leading/trailing low only
+
+        uint64_t high_ns = high * bit_ns;
+        uint64_t low_ns = low * bit_ns;
+        bool is_last = (bit >= total_bits);
+        int value;
+
+        if (high_ns >= WS2812_T0H_MIN_NS && high_ns <= WS2812_T0H_MAX_NS) {
+            value = 0;
+            if (!is_last && (low_ns < WS2812_T0L_MIN_NS || low_ns > WS2812_T0L_MAX_NS)) violations++;
+        } else if (high_ns >= WS2812_T1H_MIN_NS && high_ns <= WS2812_T1H_MAX_NS) {
+            value = 1;
+            if (!is_last && (low_ns < WS2812_T1L_MIN_NS || low_ns > WS2812_T1L_MAX_NS)) violations++;
+        } else {
+            violations++;
+            continue;
+        }
+
+        // The last bit's low time runs into the reset gap
+        if (is_last) {
+            uint64_t data_low_ns = value ? WS2812_T1L_MIN_NS : WS2812_T0L_MIN_NS;
+            if (low_ns < data_low_ns + WS2812_RESET_MIN_NS) violations++;
+        }
+
+        if (decoded && (data_bits >> 3) < wire_len) {
+            uint8_t* byte = &decoded[data_bits >> 3];
+            if ((data_bits & 7) == 0) *byte = 0;
+            *byte |= (uint8_t)(value << (7 - (data_bits & 7)));
+        }
+        data_bits++;
+    }
+
+    if (decoded && data_bits != wire_len * 8) violations++;
+    return violations;
+}
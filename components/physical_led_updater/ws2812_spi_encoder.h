@@ -0,0 +1,38 @@
+#ifndef WS2812_SPI_ENCODER_H
+#define WS2812_SPI_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ws2812_timing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Each WS2812 bit is sent as three SPI bits at 2.5 MHz (400 ns each):
+// 0 -> 100 (400 ns high, 800 ns low), 1 -> 110 (800 ns high, 400 ns low)
+#define WS2812_SPI_CLOCK_HZ         2500000
+#define WS2812_SPI_BITS_PER_BIT     3
+#define WS2812_SPI_BYTES_PER_BYTE   WS2812_SPI_BITS_PER_BIT
+#define WS2812_SPI_RESET_BYTES      100     // 320 us low latches the frame (>= 280 us for WS2812B)
+
+// Size of the SPI bitstream for a packed wire buffer of wire_len bytes
+static inline size_t ws2812_spi_encoded_size(size_t wire_len) {
+    return wire_len * WS2812_SPI_BYTES_PER_BYTE + WS2812_SPI_RESET_BYTES;
+}
+
+// Encode packed wire bytes into an SPI bitstream (MSB first) followed by the reset
+// gap. out must hold ws2812_spi_encoded_size(wire_len) bytes. Returns bytes written.
+size_t ws2812_spi_encode(const uint8_t* wire, size_t wire_len, uint8_t* out);
+
+// Walk an encoded bitstream clocked at spi_hz and check every high/low pulse against
+// the WS2812 windows above and that it ends with a valid reset. Returns the number of
+// violations; decoded (optional, wire_len bytes) receives the recovered data bytes.
+size_t ws2812_spi_check_timing(const uint8_t* bitstream, size_t len, uint32_t spi_hz,
+                               uint8_t* decoded, size_t wire_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WS2812_SPI_ENCODER_H
@@ -0,0 +1,52 @@
+#ifndef WS2812_TIMING_H
+#define WS2812_TIMING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// WS2812 datasheet windows in nanoseconds (nominal +/- 150 ns)
+#define WS2812_T0H_MIN_NS   250
+#define WS2812_T0H_MAX_NS   550
+#define WS2812_T1H_MIN_NS   650
+#define WS2812_T1H_MAX_NS   950
+#define WS2812_T0L_MIN_NS   700
+#define WS2812_T0L_MAX_NS   1000
+#define WS2812_T1L_MIN_NS   300
+#define WS2812_T1L_MAX_NS   600
+#define WS2812_RESET_MIN_NS 50000
+
+// Pulse widths the RMT encoder sends
+#define WS2812_T0H_NS   300
+#define WS2812_T0L_NS   900
+#define WS2812_T1H_NS   900
+#define WS2812_T1L_NS   300
+#define WS2812_RESET_US 50
+
+// RMT symbol durations at a channel tick rate; the reset code is two symbol
+// halves of reset_half ticks each
+typedef struct {
+    uint16_t t0h, t0l;
+    uint16_t t1h, t1l;
+    uint16_t reset_half;
+} ws2812_rmt_ticks_t;
+
+static inline ws2812_rmt_ticks_t ws2812_rmt_ticks(uint32_t resolution_hz) {
+    uint32_t ticks_per_us = resolution_hz / 1000000;
+    ws2812_rmt_ticks_t ticks = {
+        .t0h = (uint16_t)(WS2812_T0H_NS * ticks_per_us / 1000),
+        .t0l = (uint16_t)(WS2812_T0L_NS * ticks_per_us / 1000),
+        .t1h = (uint16_t)(WS2812_T1H_NS * ticks_per_us / 1000),
+        .t1l = (uint16_t)(WS2812_T1L_NS * ticks_per_us / 1000),
+        .reset_half = (uint16_t)(ticks_per_us * WS2812_RESET_US / 2),
+    };
+    return ticks;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WS2812_TIMING_H
@@ -0,0 +1,169 @@
+#include "led_animation.h"
+#include <string.h>
+#include "esp_log.h"
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#endif
+
+static const char *TAG = "LED_ANIMATION";
+
+// Header layout
+#define HEADER_MAGIC            0
+#define HEADER_VERSION          4
+#define HEADER_SIZE_FIELD       6
+#define HEADER_LED_COUNT        8
+#define HEADER_FLAGS            10
+#define HEADER_FRAME_COUNT      12
+#define HEADER_FRAME_PERIOD     16
+#define HEADER_KEYFRAME_INTERVAL 20
+#define HEADER_FRAMES_SIZE      24
+#define HEADER_RESERVED         28
+
+// Byte-wise so neither alignment nor host endianness matter
+static inline uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void write_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+BaseType_t led_animation_open(LedAnimation* animation, const void* data, size_t size) {
+    if (!animation || !data) return pdFAIL;
+    memset(animation, 0, sizeof(*animation));
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    if (size < LED_ANIMATION_HEADER_SIZE || read_u32(&bytes[HEADER_MAGIC]) != LED_ANIMATION_MAGIC) {
+        ESP_LOGE(TAG, "Not an animation");
+        return pdFAIL;
+    }
+
+    uint16_t header_size = read_u16(&bytes[HEADER_SIZE_FIELD]);
+    uint32_t frame_count = read_u32(&bytes[HEADER_FRAME_COUNT]);
+    uint32_t frames_size = read_u32(&bytes[HEADER_FRAMES_SIZE]);
+    uint32_t keyframe_interval = read_u32(&bytes[HEADER_KEYFRAME_INTERVAL]);
+    if (read_u16(&bytes[HEADER_VERSION]) != LED_ANIMATION_VERSION || header_size < LED_ANIMATION_HEADER_SIZE ||
+        frame_count == 0 || keyframe_interval == 0 || read_u16(&bytes[HEADER_LED_COUNT]) == 0 ||
+        read_u32(&bytes[HEADER_FRAME_PERIOD]) == 0) {
+        ESP_LOGE(TAG, "Unsupported animation header");
+        return pdFAIL;
+    }
+
+    // Index and frames must fit in what was mapped
+    uint64_t index_size = (uint64_t)frame_count * sizeof(uint32_t);
+    if ((uint64_t)header_size + index_size + frames_size > size) {
+        ESP_LOGE(TAG, "Animation truncated");
+        return pdFAIL;
+    }
+
+    const uint8_t* index = bytes + header_size;
+    uint32_t previous_offset = 0;
+    for (uint32_t f = 0; f < frame_count; f++) {
+        uint32_t entry = read_u32(&index[f * sizeof(uint32_t)]);
+        uint32_t offset = entry & LED_ANIMATION_OFFSET_MASK;
+        bool keyframe = (entry & LED_ANIMATION_KEYFRAME) != 0;
+        if (offset < previous_offset || offset > frames_size || (f % keyframe_interval == 0 && !keyframe)) {
+            ESP_LOGE(TAG, "Bad index entry for frame %u", (unsigned)f);
+            return pdFAIL;
+        }
+        previous_offset = offset;
+    }
+
+    animation->data = bytes;
+    animation->index = index;
+    animation->frames = index + index_size;
+    animation->frames_size = frames_size;
+    animation->led_count = read_u16(&bytes[HEADER_LED_COUNT]);
+    animation->flags = read_u16(&bytes[HEADER_FLAGS]);
+    animation->frame_count = frame_count;
+    animation->frame_period_ms = read_u32(&bytes[HEADER_FRAME_PERIOD]);
+    animation->keyframe_interval = keyframe_interval;
+    return pdPASS;
+}
+
+#ifdef ESP_PLATFORM
+BaseType_t led_animation_open_partition(LedAnimation* animation, const char* label) {
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!partition) {
+        ESP_LOGE(TAG, "No partition \"%s\"", label);
+        return pdFAIL;
+    }
+
+    // Read through the cache from flash; nothing is copied into RAM
+    const void* data;
+    esp_partition_mmap_handle_t handle;
+    if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &data, &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition \"%s\"", label);
+        return pdFAIL;
+    }
+
+    if (led_animation_open(animation, data, partition->size) != pdPASS) {
+        esp_partition_munmap(handle);
+        return pdFAIL;
+    }
+    animation->mmap_handle = (uint32_t)handle;
+    return pdPASS;
+}
+#else
+BaseType_t led_animation_open_partition(LedAnimation* animation, const char* label) {
+    ESP_LOGE(TAG, "No partitions on this platform");
+    return pdFAIL;
+}
+#endif
+
+void led_animation_close(LedAnimation* animation) {
+    if (!animation) return;
+#ifdef ESP_PLATFORM
+    if (animation->mmap_handle) {
+        esp_partition_munmap((esp_partition_mmap_handle_t)animation->mmap_handle);
+    }
+#endif
+    memset(animation, 0, sizeof(*animation));
+}
+
+bool led_animation_frame(const LedAnimation* animation, uint32_t frame,
+                         const uint8_t** data, size_t* size, bool* keyframe) {
+    if (!animation || !animation->data || frame >= animation->frame_count) return false;
+
+    uint32_t entry = read_u32(&animation->index[frame * sizeof(uint32_t)]);
+    uint32_t offset = entry & LED_ANIMATION_OFFSET_MASK;
+    uint32_t end = frame + 1 < animation->frame_count
+        ? read_u32(&animation->index[(frame + 1) * sizeof(uint32_t)]) & LED_ANIMATION_OFFSET_MASK
+        : animation->frames_size;
+
+    *data = animation->frames + offset;
+    *size = end - offset;
+    *keyframe = (entry & LED_ANIMATION_KEYFRAME) != 0;
+    return true;
+}
+
+void led_animation_write_header(uint8_t* out, uint16_t led_count, uint16_t flags, uint32_t frame_count,
+                                uint32_t frame_period_ms, uint32_t keyframe_interval, uint32_t frames_size) {
+    memset(out, 0, LED_ANIMATION_HEADER_SIZE);
+    write_u32(&out[HEADER_MAGIC], LED_ANIMATION_MAGIC);
+    write_u16(&out[HEADER_VERSION], LED_ANIMATION_VERSION);
+    write_u16(&out[HEADER_SIZE_FIELD], LED_ANIMATION_HEADER_SIZE);
+    write_u16(&out[HEADER_LED_COUNT], led_count);
+    write_u16(&out[HEADER_FLAGS], flags);
+    write_u32(&out[HEADER_FRAME_COUNT], frame_count);
+    write_u32(&out[HEADER_FRAME_PERIOD], frame_period_ms);
+    write_u32(&out[HEADER_KEYFRAME_INTERVAL], keyframe_interval);
+    write_u32(&out[HEADER_FRAMES_SIZE], frames_size);
+    write_u32(&out[HEADER_RESERVED], 0);
+}
+
+void led_animation_write_index(uint8_t* out, uint32_t offset, bool keyframe) {
+    write_u32(out, (offset & LED_ANIMATION_OFFSET_MASK) | (keyframe ? LED_ANIMATION_KEYFRAME : 0));
+}
@@ -0,0 +1,65 @@
+#ifndef LED_ANIMATION_H
+#define LED_ANIMATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Precomputed animation, played back by PATTERN_ANIMATION straight from flash.
+// All fields little-endian:
+//   header   LED_ANIMATION_HEADER_SIZE bytes, see led_animation_write_header
+//   index    frame_count u32: offset into the frame data, LED_ANIMATION_KEYFRAME set on keyframes
+//   frames   led_frame_codec frames; keyframes stand alone, the rest are deltas
+// Every keyframe_interval-th frame (and frame 0) is a keyframe, so any frame is
+// at most keyframe_interval - 1 deltas away from one.
+#define LED_ANIMATION_MAGIC         0x4144454Cu    // "LEDA"
+#define LED_ANIMATION_VERSION       1
+#define LED_ANIMATION_HEADER_SIZE   32
+#define LED_ANIMATION_KEYFRAME      0x80000000u
+#define LED_ANIMATION_OFFSET_MASK   0x7FFFFFFFu
+
+// Flags
+#define LED_ANIMATION_FLAG_LOOP     0x0001         // Authored to loop seamlessly
+
+// Data partition holding an animation, written with
+//     parttool.py write_partition --partition-name anim --input anim.leda
+#define LED_ANIMATION_PARTITION_LABEL "anim"
+
+typedef struct {
+    const uint8_t* data;        // Whole file: mapped flash or any memory that outlives playback
+    const uint8_t* index;
+    const uint8_t* frames;
+    uint32_t frames_size;
+    uint16_t led_count;         // LEDs per frame
+    uint16_t flags;
+    uint32_t frame_count;
+    uint32_t frame_period_ms;
+    uint32_t keyframe_interval;
+    uint32_t mmap_handle;       // Partition mapping, 0 when opened from memory
+} LedAnimation;
+
+// Check the header and index of an animation image in memory; data is used in place
+BaseType_t led_animation_open(LedAnimation* animation, const void* data, size_t size);
+// Map a data partition read-only and open the animation in it (no copy to RAM)
+BaseType_t led_animation_open_partition(LedAnimation* animation, const char* label);
+void led_animation_close(LedAnimation* animation);
+
+// Encoded data of one frame; false if frame is out of range
+bool led_animation_frame(const LedAnimation* animation, uint32_t frame,
+                         const uint8_t** data, size_t* size, bool* keyframe);
+
+// Writers for encoders
+void led_animation_write_header(uint8_t* out, uint16_t led_count, uint16_t flags, uint32_t frame_count,
+                                uint32_t frame_period_ms, uint32_t keyframe_interval, uint32_t frames_size);
+void led_animation_write_index(uint8_t* out, uint32_t offset, bool keyframe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_ANIMATION_H
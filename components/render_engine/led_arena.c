@@ -0,0 +1,71 @@
+#include "led_arena.h"
+
+static inline uint32_t arena_chunks(size_t size) {
+    return size ? (uint32_t)((size + LED_ARENA_CHUNK_SIZE - 1) / LED_ARENA_CHUNK_SIZE) : 1;
+}
+
+static inline uint32_t arena_run_mask(uint32_t chunks) {
+    return chunks >= LED_ARENA_GROUP_CHUNKS ? 0xFFFFFFFFu : (1u << chunks) - 1;
+}
+
+void led_arena_init(LedArena* arena, uint8_t* memory, atomic_uint* used, uint32_t groups) {
+    arena->memory = memory;
+    arena->used = used;
+    arena->groups = groups;
+    for (uint32_t g = 0; g < groups; g++) {
+        atomic_store_explicit(&used[g], 0u, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+void* led_arena_alloc(LedArena* arena, size_t size) {
+    if (size > LED_ARENA_MAX_ALLOC) return NULL;
+    uint32_t chunks = arena_chunks(size);
+    uint32_t run = arena_run_mask(chunks);
+
+    for (uint32_t g = 0; g < arena->groups; g++) {
+        uint32_t used = atomic_load_explicit(&arena->used[g], memory_order_acquire);
+        for (;;) {
+            // Lowest free run in this group's current bitmap
+            uint32_t first = LED_ARENA_GROUP_CHUNKS;
+            for (uint32_t bit = 0; bit + chunks <= LED_ARENA_GROUP_CHUNKS; bit++) {
+                if ((used & (run << bit)) == 0) {
+                    first = bit;
+                    break;
+                }
+            }
+            if (first == LED_ARENA_GROUP_CHUNKS) break;
+
+            // A failed CAS reloads used, and the scan starts over on the new bitmap
+            if (atomic_compare_exchange_weak_explicit(&arena->used[g], &used, used | (run << first),
+                                                      memory_order_acq_rel, memory_order_acquire)) {
+                return &arena->memory[((size_t)g * LED_ARENA_GROUP_CHUNKS + first) * LED_ARENA_CHUNK_SIZE];
+            }
+        }
+    }
+    return NULL;
+}
+
+void led_arena_free(LedArena* arena, void* memory, size_t size) {
+    if (!memory) return;
+    size_t chunk = (size_t)((uint8_t*)memory - arena->memory) / LED_ARENA_CHUNK_SIZE;
+    uint32_t group = (uint32_t)(chunk / LED_ARENA_GROUP_CHUNKS);
+    uint32_t first = (uint32_t)(chunk % LED_ARENA_GROUP_CHUNKS);
+
+    // Release: whatever the owner wrote is done before the next owner gets the run
+    atomic_fetch_and_explicit(&arena->used[group], ~(arena_run_mask(arena_chunks(size)) << first),
+                              memory_order_release);
+}
+
+bool led_arena_contains(const LedArena* arena, const void* memory) {
+    const uint8_t* byte = (const uint8_t*)memory;
+    return byte >= arena->memory && byte < arena->memory + (size_t)arena->groups * LED_ARENA_MAX_ALLOC;
+}
+
+uint32_t led_arena_chunks_used(const LedArena* arena) {
+    uint32_t chunks = 0;
+    for (uint32_t g = 0; g < arena->groups; g++) {
+        chunks += (uint32_t)__builtin_popcount(atomic_load_explicit(&arena->used[g], memory_order_relaxed));
+    }
+    return chunks;
+}
@@ -0,0 +1,47 @@
+#ifndef LED_ARENA_H
+#define LED_ARENA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free arena handing out contiguous runs of LED_ARENA_CHUNK_SIZE byte chunks
+// from memory its owner sizes. Each group of 32 chunks has a bitmap of the chunks
+// in use and a run is claimed with one CAS on it, so runs never span groups: at
+// most LED_ARENA_MAX_ALLOC bytes each. Nothing here blocks or allocates.
+#define LED_ARENA_CHUNK_SIZE 64
+#define LED_ARENA_GROUP_CHUNKS 32
+#define LED_ARENA_MAX_ALLOC (LED_ARENA_CHUNK_SIZE * LED_ARENA_GROUP_CHUNKS)
+// Bytes a run of `size` bytes takes up
+#define LED_ARENA_RUN_SIZE(size) \
+    ((((size) + LED_ARENA_CHUNK_SIZE - 1) / LED_ARENA_CHUNK_SIZE) * LED_ARENA_CHUNK_SIZE)
+// Groups that hold `size` bytes of runs packed together
+#define LED_ARENA_GROUPS_FOR(size) (((size) + LED_ARENA_MAX_ALLOC - 1) / LED_ARENA_MAX_ALLOC)
+
+typedef struct {
+    uint8_t* memory;        // groups * LED_ARENA_MAX_ALLOC bytes, 8-byte aligned
+    atomic_uint* used;      // Chunk bitmap per group
+    uint32_t groups;
+} LedArena;
+
+// Hand the arena its memory and bitmaps, all free
+void led_arena_init(LedArena* arena, uint8_t* memory, atomic_uint* used, uint32_t groups);
+// First free run that holds size bytes (any task); NULL when none does
+void* led_arena_alloc(LedArena* arena, size_t size);
+// Give back a run from led_arena_alloc, with the size it was allocated with
+void led_arena_free(LedArena* arena, void* memory, size_t size);
+// Whether memory points into this arena (else its owner got it elsewhere)
+bool led_arena_contains(const LedArena* arena, const void* memory);
+// Chunks currently claimed, for diagnostics
+uint32_t led_arena_chunks_used(const LedArena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_ARENA_H
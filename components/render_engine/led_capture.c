@@ -0,0 +1,400 @@
+#include "led_capture.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "led_frame_codec.h"
+#ifdef ESP_PLATFORM
+#include "driver/uart.h"
+#endif
+
+static const char *TAG = "LED_CAPTURE";
+
+// Header layout
+#define HEADER_MAGIC            0
+#define HEADER_VERSION          4
+#define HEADER_SIZE_FIELD       6
+#define HEADER_NUM_EDGES        8
+#define HEADER_KEYFRAME_INTERVAL 10
+#define HEADER_EDGE_LENGTHS     12
+
+// Byte-wise so neither alignment nor host endianness matter
+static inline uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void write_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+//----------------------------------------------------------------------------//
+// Recording
+//----------------------------------------------------------------------------//
+
+#if LED_CAPTURE_ENABLED
+
+// Checked by the render task without the lock so an idle capture costs one load
+static atomic_bool capture_running;
+static SemaphoreHandle_t capture_mutex;
+
+// Owned by whoever holds capture_mutex
+static LedCaptureSink capture_sink;
+static uint8_t capture_num_edges;
+static uint32_t capture_edge_length[MAX_EDGES];
+static uint32_t capture_total_leds;
+static LedState_t* capture_previous;    // Last frame written
+static LedState_t* capture_gather;      // Per-edge and indexed layouts are expanded here to encode
+static uint8_t* capture_record;         // Record header + encoded frame
+static size_t capture_record_size;
+static uint32_t capture_frame_count;
+
+static void capture_release(void) {
+    atomic_store(&capture_running, false);
+    free(capture_previous);
+    free(capture_gather);
+    free(capture_record);
+    capture_previous = NULL;
+    capture_gather = NULL;
+    capture_record = NULL;
+}
+
+BaseType_t led_capture_start(const LedEdgeConfigState_t* layout, const LedCaptureSink* sink) {
+    if (!layout || !sink || !sink->write) return pdFAIL;
+    // Read once: the compiler cannot tell that the calls below leave the layout
+    // alone, and the header writes are bounded by this check
+    uint8_t num_edges = layout->num_edges;
+    if (num_edges == 0 || num_edges > MAX_EDGES) return pdFAIL;
+    if (!capture_mutex) {
+        capture_mutex = xSemaphoreCreateMutex();
+        if (!capture_mutex) return pdFAIL;
+    }
+
+    led_capture_stop();
+    xSemaphoreTake(capture_mutex, portMAX_DELAY);
+
+    uint8_t header[LED_CAPTURE_HEADER_SIZE(MAX_EDGES)];
+    size_t header_size = LED_CAPTURE_HEADER_SIZE(num_edges);
+    write_u32(&header[HEADER_MAGIC], LED_CAPTURE_MAGIC);
+    write_u16(&header[HEADER_VERSION], LED_CAPTURE_VERSION);
+    write_u16(&header[HEADER_SIZE_FIELD], (uint16_t)header_size);
+    header[HEADER_NUM_EDGES] = num_edges;
+    header[HEADER_NUM_EDGES + 1] = 0;
+    write_u16(&header[HEADER_KEYFRAME_INTERVAL], LED_CAPTURE_KEYFRAME_INTERVAL);
+
+    uint32_t total_leds = 0;
+    for (int e = 0; e < num_edges; e++) {
+        capture_edge_length[e] = layout->num_led_per_edge[e];
+        write_u16(&header[HEADER_EDGE_LENGTHS + 2 * e], (uint16_t)layout->num_led_per_edge[e]);
+        total_leds += layout->num_led_per_edge[e];
+    }
+
+    capture_sink = *sink;
+    capture_num_edges = num_edges;
+    capture_total_leds = total_leds;
+    capture_frame_count = 0;
+    capture_record_size = LED_CAPTURE_RECORD_HEADER_SIZE + LED_CODEC_MAX_ENCODED_SIZE(total_leds);
+    capture_previous = malloc(total_leds * sizeof(LedState_t));
+    capture_gather = malloc(total_leds * sizeof(LedState_t));
+    capture_record = malloc(capture_record_size);
+
+    BaseType_t result = pdFAIL;
+    if (!capture_previous || !capture_gather || !capture_record) {
+        ESP_LOGE(TAG, "Out of memory for %u LEDs", (unsigned)total_leds);
+        capture_release();
+    } else if (!capture_sink.write(capture_sink.context, header, header_size)) {
+        ESP_LOGE(TAG, "Sink refused the stream header");
+        capture_release();
+    } else {
+        atomic_store(&capture_running, true);
+        result = pdPASS;
+    }
+
+    xSemaphoreGive(capture_mutex);
+    return result;
+}
+
+void led_capture_stop(void) {
+    if (!capture_mutex) return;
+    xSemaphoreTake(capture_mutex, portMAX_DELAY);
+    capture_release();
+    xSemaphoreGive(capture_mutex);
+}
+
+bool led_capture_active(void) {
+    return atomic_load(&capture_running);
+}
+
+uint32_t led_capture_frames(void) {
+    return capture_frame_count;
+}
+
+void led_capture_frame(const LedEdgeConfigState_t* frame, uint32_t time_ms) {
+    if (!atomic_load_explicit(&capture_running, memory_order_relaxed) || !frame) return;
+
+    xSemaphoreTake(capture_mutex, portMAX_DELAY);
+    if (!atomic_load(&capture_running)) {
+        xSemaphoreGive(capture_mutex);
+        return;
+    }
+
+    bool layout_matches = frame->num_edges == capture_num_edges;
+    for (int e = 0; layout_matches && e < capture_num_edges; e++) {
+        layout_matches = frame->num_led_per_edge[e] == capture_edge_length[e];
+    }
+    if (!layout_matches) {
+        ESP_LOGW(TAG, "Frame layout changed, capture stopped");
+        capture_release();
+        xSemaphoreGive(capture_mutex);
+        return;
+    }
+
+    // The flat RGB layout already has every edge back to back
+#if FRAMEBUFFER_INDEXED
+    const LedState_t* pixels = NULL;
+#else
+    const LedState_t* pixels = frame->pixels;
+#endif
+    if (!pixels) {
+        LedState_t* out = capture_gather;
+        for (int e = 0; e < capture_num_edges; e++) {
+            for (uint32_t i = 0; i < capture_edge_length[e]; i++) {
+                *out++ = framebuffer_color(frame, frame->data[e][i]);
+            }
+        }
+        pixels = capture_gather;
+    }
+
+    bool keyframe = capture_frame_count % LED_CAPTURE_KEYFRAME_INTERVAL == 0;
+    size_t size = led_frame_encode(pixels, keyframe ? NULL : capture_previous, capture_total_leds,
+                                   capture_record + LED_CAPTURE_RECORD_HEADER_SIZE,
+                                   capture_record_size - LED_CAPTURE_RECORD_HEADER_SIZE);
+    write_u32(&capture_record[0], time_ms);
+    write_u32(&capture_record[4], (uint32_t)size | (keyframe ? LED_CAPTURE_KEYFRAME : 0));
+    memcpy(capture_previous, pixels, capture_total_leds * sizeof(LedState_t));
+
+    if (capture_sink.write(capture_sink.context, capture_record, LED_CAPTURE_RECORD_HEADER_SIZE + size)) {
+        capture_frame_count++;
+    } else {
+        ESP_LOGW(TAG, "Sink full after %u frames, capture stopped", (unsigned)capture_frame_count);
+        capture_release();
+    }
+    xSemaphoreGive(capture_mutex);
+}
+
+#endif // LED_CAPTURE_ENABLED
+
+//----------------------------------------------------------------------------//
+// Sinks
+//----------------------------------------------------------------------------//
+
+static bool file_sink_write(void* context, const void* data, size_t size) {
+    return fwrite(data, 1, size, (FILE*)context) == size;
+}
+
+LedCaptureSink led_capture_file_sink(FILE* file) {
+    return (LedCaptureSink){ .write = file_sink_write, .context = file };
+}
+
+#ifdef ESP_PLATFORM
+static bool uart_sink_write(void* context, const void* data, size_t size) {
+    return uart_write_bytes((uart_port_t)(intptr_t)context, data, size) == (int)size;
+}
+
+LedCaptureSink led_capture_uart_sink(int uart_port) {
+    return (LedCaptureSink){ .write = uart_sink_write, .context = (void*)(intptr_t)uart_port };
+}
+#endif
+
+// Ring positions wrap at capacity; records may straddle the end
+static void ring_copy_in(LedCaptureRing* ring, size_t pos, const uint8_t* src, size_t size) {
+    size_t first = ring->capacity - pos < size ? ring->capacity - pos : size;
+    memcpy(&ring->data[pos], src, first);
+    memcpy(ring->data, src + first, size - first);
+}
+
+static void ring_copy_out(const LedCaptureRing* ring, size_t pos, uint8_t* dst, size_t size) {
+    size_t first = ring->capacity - pos < size ? ring->capacity - pos : size;
+    memcpy(dst, &ring->data[pos], first);
+    memcpy(dst + first, ring->data, size - first);
+}
+
+static inline size_t ring_advance(const LedCaptureRing* ring, size_t pos, size_t size) {
+    pos += size;
+    return pos >= ring->capacity ? pos - ring->capacity : pos;
+}
+
+static void ring_drop_oldest(LedCaptureRing* ring) {
+    uint8_t record_header[LED_CAPTURE_RECORD_HEADER_SIZE];
+    ring_copy_out(ring, ring->tail, record_header, sizeof(record_header));
+    size_t size = LED_CAPTURE_RECORD_HEADER_SIZE + (read_u32(&record_header[4]) & LED_CAPTURE_SIZE_MASK);
+    ring->tail = ring_advance(ring, ring->tail, size);
+    ring->used -= size;
+    ring->records--;
+    ring->records_dropped++;
+}
+
+static bool ring_sink_write(void* context, const void* data, size_t size) {
+    LedCaptureRing* ring = (LedCaptureRing*)context;
+    bool stored = false;
+    xSemaphoreTake(ring->mutex, portMAX_DELAY);
+
+    if (ring->header_size == 0) {
+        // A new stream: the header is kept apart so eviction never loses it
+        if (size <= sizeof(ring->header)) {
+            memcpy(ring->header, data, size);
+            ring->header_size = size;
+            ring->head = ring->tail = ring->used = 0;
+            ring->records = ring->records_dropped = 0;
+            stored = true;
+        }
+    } else if (size <= ring->capacity) {
+        while (ring->capacity - ring->used < size) {
+            ring_drop_oldest(ring);
+        }
+        ring_copy_in(ring, ring->head, (const uint8_t*)data, size);
+        ring->head = ring_advance(ring, ring->head, size);
+        ring->used += size;
+        ring->records++;
+        stored = true;
+    }
+
+    xSemaphoreGive(ring->mutex);
+    return stored;
+}
+
+BaseType_t led_capture_ring_init(LedCaptureRing* ring, size_t capacity) {
+    if (!ring || capacity < LED_CAPTURE_RECORD_HEADER_SIZE) return pdFAIL;
+    memset(ring, 0, sizeof(*ring));
+    ring->data = malloc(capacity);
+    ring->mutex = xSemaphoreCreateMutex();
+    if (!ring->data || !ring->mutex) {
+        led_capture_ring_deinit(ring);
+        return pdFAIL;
+    }
+    ring->capacity = capacity;
+    return pdPASS;
+}
+
+void led_capture_ring_deinit(LedCaptureRing* ring) {
+    if (!ring) return;
+    if (ring->mutex) vSemaphoreDelete(ring->mutex);
+    free(ring->data);
+    memset(ring, 0, sizeof(*ring));
+}
+
+LedCaptureSink led_capture_ring_sink(LedCaptureRing* ring) {
+    // Each capture started on this sink begins a new stream
+    if (ring && ring->mutex) {
+        xSemaphoreTake(ring->mutex, portMAX_DELAY);
+        ring->header_size = 0;
+        xSemaphoreGive(ring->mutex);
+    }
+    return (LedCaptureSink){ .write = ring_sink_write, .context = ring };
+}
+
+uint32_t led_capture_ring_dump(LedCaptureRing* ring, const LedCaptureSink* sink) {
+    if (!ring || !ring->mutex || !sink || !sink->write) return 0;
+    xSemaphoreTake(ring->mutex, portMAX_DELAY);
+
+    uint32_t written = 0;
+    if (ring->header_size == 0 || !sink->write(sink->context, ring->header, ring->header_size)) {
+        xSemaphoreGive(ring->mutex);
+        return 0;
+    }
+
+    bool started = false;
+    size_t pos = ring->tail;
+    for (uint32_t r = 0; r < ring->records; r++) {
+        uint8_t record_header[LED_CAPTURE_RECORD_HEADER_SIZE];
+        ring_copy_out(ring, pos, record_header, sizeof(record_header));
+        uint32_t entry = read_u32(&record_header[4]);
+        size_t size = LED_CAPTURE_RECORD_HEADER_SIZE + (entry & LED_CAPTURE_SIZE_MASK);
+
+        // Deltas before the oldest surviving keyframe cannot be decoded
+        started = started || (entry & LED_CAPTURE_KEYFRAME);
+        if (started) {
+            size_t first = ring->capacity - pos < size ? ring->capacity - pos : size;
+            if (!sink->write(sink->context, &ring->data[pos], first) ||
+                (first < size && !sink->write(sink->context, ring->data, size - first))) {
+                break;
+            }
+            written++;
+        }
+        pos = ring_advance(ring, pos, size);
+    }
+
+    xSemaphoreGive(ring->mutex);
+    return written;
+}
+
+//----------------------------------------------------------------------------//
+// Reading
+//----------------------------------------------------------------------------//
+
+BaseType_t led_capture_reader_open(LedCaptureReader* reader, const void* data, size_t size) {
+    if (!reader || !data) return pdFAIL;
+    memset(reader, 0, sizeof(*reader));
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    if (size < LED_CAPTURE_HEADER_SIZE(0) || read_u32(&bytes[HEADER_MAGIC]) != LED_CAPTURE_MAGIC) {
+        ESP_LOGE(TAG, "Not a capture");
+        return pdFAIL;
+    }
+
+    uint16_t header_size = read_u16(&bytes[HEADER_SIZE_FIELD]);
+    uint8_t num_edges = bytes[HEADER_NUM_EDGES];
+    if (read_u16(&bytes[HEADER_VERSION]) != LED_CAPTURE_VERSION || num_edges == 0 ||
+        header_size < LED_CAPTURE_HEADER_SIZE(num_edges) || header_size > size) {
+        ESP_LOGE(TAG, "Unsupported capture header");
+        return pdFAIL;
+    }
+
+    reader->data = bytes;
+    reader->size = size;
+    reader->pos = header_size;
+    reader->num_edges = num_edges;
+    reader->keyframe_interval = read_u16(&bytes[HEADER_KEYFRAME_INTERVAL]);
+    for (int e = 0; e < num_edges; e++) {
+        reader->total_leds += read_u16(&bytes[HEADER_EDGE_LENGTHS + 2 * e]);
+    }
+    return pdPASS;
+}
+
+uint16_t led_capture_reader_edge_length(const LedCaptureReader* reader, int edge) {
+    if (!reader || !reader->data || edge < 0 || edge >= reader->num_edges) return 0;
+    return read_u16(&reader->data[HEADER_EDGE_LENGTHS + 2 * edge]);
+}
+
+int led_capture_reader_next(LedCaptureReader* reader, LedState_t* frame, uint32_t* time_ms) {
+    if (!reader || !reader->data) return -1;
+    if (reader->pos == reader->size) return 0;
+    if (reader->size - reader->pos < LED_CAPTURE_RECORD_HEADER_SIZE) return -1;
+
+    const uint8_t* record = reader->data + reader->pos;
+    uint32_t entry = read_u32(&record[4]);
+    uint32_t size = entry & LED_CAPTURE_SIZE_MASK;
+    bool keyframe = (entry & LED_CAPTURE_KEYFRAME) != 0;
+    if (size > reader->size - reader->pos - LED_CAPTURE_RECORD_HEADER_SIZE || (!keyframe && !reader->have_frame)) {
+        return -1;
+    }
+
+    int used = led_frame_decode(record + LED_CAPTURE_RECORD_HEADER_SIZE, size, reader->total_leds, keyframe,
+                                frame, 0, reader->total_leds);
+    if (used != (int)size) return -1;
+
+    reader->have_frame = true;
+    reader->pos += LED_CAPTURE_RECORD_HEADER_SIZE + size;
+    if (time_ms) *time_ms = read_u32(&record[0]);
+    return 1;
+}
@@ -0,0 +1,132 @@
+#ifndef LED_CAPTURE_H
+#define LED_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "framebuffer.h"
+#include "render_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Records every frame led_controller_update publishes, for golden-output
+// regression tests and for reproducing glitches seen in the field. Set to 0 to
+// compile the render-task hook down to nothing.
+#ifndef LED_CAPTURE_ENABLED
+#define LED_CAPTURE_ENABLED 1
+#endif
+
+// Frames between keyframes. A RAM ring holding more frames than this always has
+// one to start decoding from; a dump skips the deltas recorded before it.
+#ifndef LED_CAPTURE_KEYFRAME_INTERVAL
+#define LED_CAPTURE_KEYFRAME_INTERVAL 64
+#endif
+
+// Stream layout, all fields little-endian:
+//   header   LED_CAPTURE_HEADER_SIZE(num_edges) bytes: magic, version, header size,
+//            num_edges, keyframe interval, then one u16 LED count per edge
+//   records  u32 time_ms, u32 size (LED_CAPTURE_KEYFRAME set on keyframes), then
+//            `size` bytes of one led_frame_codec frame covering every edge back to back
+#define LED_CAPTURE_MAGIC               0x4344454Cu    // "LEDC"
+#define LED_CAPTURE_VERSION             1
+#define LED_CAPTURE_HEADER_SIZE(edges)  (12 + 2 * (edges))
+#define LED_CAPTURE_RECORD_HEADER_SIZE  8
+#define LED_CAPTURE_KEYFRAME            0x80000000u
+#define LED_CAPTURE_SIZE_MASK           0x7FFFFFFFu
+
+// Where the stream goes. The capture calls write once with the stream header, then
+// once per frame with a whole record; write must take all of it or return false,
+// which stops the capture. led_capture_ring_dump may split a record that wraps
+// around the ring into two calls.
+typedef bool (*LedCaptureWriteFn)(void* context, const void* data, size_t size);
+
+typedef struct {
+    LedCaptureWriteFn write;
+    void* context;
+} LedCaptureSink;
+
+// RAM ring for the device: keeps the newest records, dropping whole old ones to
+// make room, and dumps them later from any task
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t head;                // Next byte written
+    size_t tail;                // Oldest record
+    size_t used;
+    uint32_t records;
+    uint32_t records_dropped;
+    uint8_t header[LED_CAPTURE_HEADER_SIZE(MAX_EDGES)];
+    size_t header_size;
+    SemaphoreHandle_t mutex;
+} LedCaptureRing;
+
+#if LED_CAPTURE_ENABLED
+
+// Start recording the frames published from now on; layout gives the edge
+// lengths (any framebuffer state). The sink is copied. Start and stop may be
+// called from any task, but not concurrently with each other.
+BaseType_t led_capture_start(const LedEdgeConfigState_t* layout, const LedCaptureSink* sink);
+void led_capture_stop(void);
+bool led_capture_active(void);
+uint32_t led_capture_frames(void);      // Frames written since start
+
+// Render task: record a finished frame before it is published
+void led_capture_frame(const LedEdgeConfigState_t* frame, uint32_t time_ms);
+
+#else
+
+static inline BaseType_t led_capture_start(const LedEdgeConfigState_t* layout, const LedCaptureSink* sink) {
+    (void)layout; (void)sink;
+    return pdFAIL;
+}
+static inline void led_capture_stop(void) {}
+static inline bool led_capture_active(void) { return false; }
+static inline uint32_t led_capture_frames(void) { return 0; }
+static inline void led_capture_frame(const LedEdgeConfigState_t* frame, uint32_t time_ms) {
+    (void)frame; (void)time_ms;
+}
+
+#endif // LED_CAPTURE_ENABLED
+
+// Sinks
+LedCaptureSink led_capture_file_sink(FILE* file);
+#ifdef ESP_PLATFORM
+LedCaptureSink led_capture_uart_sink(int uart_port);   // Driver must be installed
+#endif
+
+BaseType_t led_capture_ring_init(LedCaptureRing* ring, size_t capacity);
+void led_capture_ring_deinit(LedCaptureRing* ring);
+LedCaptureSink led_capture_ring_sink(LedCaptureRing* ring);
+// Write the ring out as a stream starting at its oldest keyframe. A capture still
+// recording into the ring waits until the dump is done, so stop it first when the
+// sink is slow. Returns the number of frames written.
+uint32_t led_capture_ring_dump(LedCaptureRing* ring, const LedCaptureSink* sink);
+
+// Reading a stream held in memory
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;                 // Next record
+    uint8_t num_edges;
+    uint32_t total_leds;
+    uint16_t keyframe_interval;
+    bool have_frame;            // A keyframe was decoded, deltas can follow
+} LedCaptureReader;
+
+BaseType_t led_capture_reader_open(LedCaptureReader* reader, const void* data, size_t size);
+uint16_t led_capture_reader_edge_length(const LedCaptureReader* reader, int edge);
+// Apply the next record to frame[0..total_leds), which must hold the previous
+// frame. Returns 1 for a frame, 0 at the end of the stream, -1 on corrupt data
+// or a delta before the first keyframe.
+int led_capture_reader_next(LedCaptureReader* reader, LedState_t* frame, uint32_t* time_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_CAPTURE_H
@@ -0,0 +1,112 @@
+#include "led_command_queue.h"
+#include <stddef.h>
+
+#define STACK_INDEX_MASK 0xFFFFu
+#define STACK_TAG_ONE    0x10000u
+
+//----------------------------------------Index stack-------------------------------------------//
+
+void led_index_stack_init(LedIndexStack* stack, atomic_ushort* links, uint16_t count) {
+    // Pops come out in index order
+    for (uint16_t i = 0; i < count; i++) {
+        atomic_store_explicit(&links[i], (uint16_t)(i + 1 < count ? i + 1 : LED_INDEX_NONE),
+                              memory_order_relaxed);
+    }
+    atomic_store_explicit(&stack->head, count ? 0u : LED_INDEX_NONE, memory_order_release);
+}
+
+bool led_index_stack_pop(LedIndexStack* stack, atomic_ushort* links, uint16_t* index) {
+    uint32_t head = atomic_load_explicit(&stack->head, memory_order_acquire);
+    for (;;) {
+        uint16_t top = head & STACK_INDEX_MASK;
+        if (top == LED_INDEX_NONE) return false;
+
+        // May read a stale link if top was popped meanwhile; the tag makes the CAS fail then
+        uint16_t below = atomic_load_explicit(&links[top], memory_order_relaxed);
+        uint32_t next = ((head & ~STACK_INDEX_MASK) + STACK_TAG_ONE) | below;
+        if (atomic_compare_exchange_weak_explicit(&stack->head, &head, next,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *index = top;
+            return true;
+        }
+    }
+}
+
+void led_index_stack_push(LedIndexStack* stack, atomic_ushort* links, uint16_t index) {
+    uint32_t head = atomic_load_explicit(&stack->head, memory_order_relaxed);
+    for (;;) {
+        atomic_store_explicit(&links[index], (uint16_t)(head & STACK_INDEX_MASK), memory_order_relaxed);
+        uint32_t next = (head & ~STACK_INDEX_MASK) | index;
+        if (atomic_compare_exchange_weak_explicit(&stack->head, &head, next,
+                                                  memory_order_release, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+//----------------------------------------Index stack-------------------------------------------//
+
+//----------------------------------------Command queue-----------------------------------------//
+
+_Static_assert(LED_COMMAND_POOL_SIZE < LED_INDEX_NONE, "command pool too large for the index stack");
+
+void led_command_queue_init(LedCommandQueue* queue) {
+    for (int i = 0; i < LED_COMMAND_POOL_SIZE; i++) {
+        atomic_store_explicit(&queue->nodes[i].next, NULL, memory_order_relaxed);
+    }
+    led_index_stack_init(&queue->free_nodes, queue->links, LED_COMMAND_POOL_SIZE);
+
+    atomic_store_explicit(&queue->stub.next, NULL, memory_order_relaxed);
+    queue->head = &queue->stub;
+    atomic_store_explicit(&queue->tail, &queue->stub, memory_order_release);
+}
+
+LedCommand* led_command_alloc(LedCommandQueue* queue) {
+    uint16_t index;
+    if (!led_index_stack_pop(&queue->free_nodes, queue->links, &index)) return NULL;
+
+    LedCommand* command = &queue->nodes[index];
+    atomic_store_explicit(&command->next, NULL, memory_order_relaxed);
+    return command;
+}
+
+void led_command_free(LedCommandQueue* queue, LedCommand* command) {
+    led_index_stack_push(&queue->free_nodes, queue->links, (uint16_t)(command - queue->nodes));
+}
+
+void led_command_push_chain(LedCommandQueue* queue, LedCommand* first, LedCommand* last) {
+    atomic_store_explicit(&last->next, NULL, memory_order_relaxed);
+    LedCommand* previous = atomic_exchange_explicit(&queue->tail, last, memory_order_acq_rel);
+    // Until this store the consumer stops at previous; it never sees half a chain
+    atomic_store_explicit(&previous->next, first, memory_order_release);
+}
+
+LedCommand* led_command_pop(LedCommandQueue* queue) {
+    LedCommand* head = queue->head;
+    LedCommand* next = atomic_load_explicit(&head->next, memory_order_acquire);
+
+    if (head == &queue->stub) {
+        if (!next) return NULL;
+        queue->head = next;
+        head = next;
+        next = atomic_load_explicit(&head->next, memory_order_acquire);
+    }
+
+    if (next) {
+        queue->head = next;
+        return head;
+    }
+
+    // head is the last node: a producer is linking after it, or the queue is about
+    // to be empty and the stub goes back in so head can be handed out
+    if (head != atomic_load_explicit(&queue->tail, memory_order_acquire)) return NULL;
+    led_command_push_chain(queue, &queue->stub, &queue->stub);
+
+    next = atomic_load_explicit(&head->next, memory_order_acquire);
+    if (next) {
+        queue->head = next;
+        return head;
+    }
+    return NULL;
+}
+//----------------------------------------Command queue-----------------------------------------//
+
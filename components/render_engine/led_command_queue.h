@@ -0,0 +1,70 @@
+#ifndef LED_COMMAND_QUEUE_H
+#define LED_COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free plumbing for handing pattern changes from any task to the render task.
+// Nothing here blocks or allocates: a full pool makes the caller fail instead.
+
+// Command nodes shared by all producers
+#ifndef LED_COMMAND_POOL_SIZE
+#define LED_COMMAND_POOL_SIZE 64
+#endif
+
+#define LED_INDEX_NONE 0xFFFFu
+
+// Multi-producer/multi-consumer stack of small indices (Treiber). head holds
+// (tag << 16) | index; the tag is bumped on every pop so a head that was popped
+// and pushed back between a load and the CAS is never mistaken for unchanged.
+typedef struct {
+    atomic_uint head;
+} LedIndexStack;
+
+// links[i] is the index below i while i is on the stack
+void led_index_stack_init(LedIndexStack* stack, atomic_ushort* links, uint16_t count);
+bool led_index_stack_pop(LedIndexStack* stack, atomic_ushort* links, uint16_t* index);
+void led_index_stack_push(LedIndexStack* stack, atomic_ushort* links, uint16_t index);
+
+typedef struct LedCommand LedCommand;
+
+struct LedCommand {
+    _Atomic(LedCommand*) next;  // Queue or batch link
+    uint8_t type;               // Meaning is up to the consumer
+    int32_t target;
+    int32_t arg;
+    const void* data;
+};
+
+// Multi-producer/single-consumer intrusive queue (Vyukov). Producers publish a
+// pre-linked chain with one exchange, so a chain is seen whole or not at all.
+typedef struct {
+    LedCommand nodes[LED_COMMAND_POOL_SIZE];
+    atomic_ushort links[LED_COMMAND_POOL_SIZE];
+    LedIndexStack free_nodes;
+    _Atomic(LedCommand*) tail; // Last published node, producers only
+    LedCommand* head;          // Next node to consume, consumer only
+    LedCommand stub;           // Keeps the queue non-empty
+} LedCommandQueue;
+
+void led_command_queue_init(LedCommandQueue* queue);
+// Take a node from the pool; NULL when every node is queued or in a batch
+LedCommand* led_command_alloc(LedCommandQueue* queue);
+void led_command_free(LedCommandQueue* queue, LedCommand* command);
+// Publish first..last, already linked through next (any task)
+void led_command_push_chain(LedCommandQueue* queue, LedCommand* first, LedCommand* last);
+// Oldest published command, NULL when empty or a producer is mid-publish
+// (consumer task only; hand the node back with led_command_free)
+LedCommand* led_command_pop(LedCommandQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_COMMAND_QUEUE_H
@@ -0,0 +1,110 @@
+#include "led_frame_codec.h"
+#include <string.h>
+#include "led_swar.h"
+
+#define RUN_BITS (LED_CODEC_RUN_MAX - 1)
+
+static inline bool same_pixel(LedState_t a, LedState_t b) {
+    return led_swar_load(a) == led_swar_load(b);
+}
+
+// Length of the run of LEDs equal to frame[start], at most LED_CODEC_RUN_MAX
+static uint32_t repeat_length(const LedState_t* frame, uint32_t start, uint32_t count) {
+    uint32_t end = start + 1;
+    while (end < count && end - start < LED_CODEC_RUN_MAX && same_pixel(frame[end], frame[start])) {
+        end++;
+    }
+    return end - start;
+}
+
+size_t led_frame_encode(const LedState_t* frame, const LedState_t* previous, uint32_t count,
+                        uint8_t* out, size_t out_size) {
+    size_t pos = 0;
+    uint32_t i = 0;
+
+    while (i < count) {
+        // Unchanged since the previous frame
+        if (previous && same_pixel(frame[i], previous[i])) {
+            uint32_t run = 1;
+            while (i + run < count && run < LED_CODEC_RUN_MAX && same_pixel(frame[i + run], previous[i + run])) {
+                run++;
+            }
+            if (pos + 1 > out_size) return 0;
+            out[pos++] = LED_CODEC_OP_SKIP | (uint8_t)(run - 1);
+            i += run;
+            continue;
+        }
+
+        // Two or more equal LEDs: 5 bytes instead of 4 per LED
+        uint32_t run = repeat_length(frame, i, count);
+        if (run >= 2) {
+            if (pos + 1 + LED_CODEC_PIXEL_SIZE > out_size) return 0;
+            out[pos++] = LED_CODEC_OP_REPEAT | (uint8_t)(run - 1);
+            memcpy(&out[pos], &frame[i], LED_CODEC_PIXEL_SIZE);
+            pos += LED_CODEC_PIXEL_SIZE;
+            i += run;
+            continue;
+        }
+
+        // Literal until something cheaper starts
+        run = 1;
+        while (i + run < count && run < LED_CODEC_RUN_MAX) {
+            uint32_t j = i + run;
+            if (previous && same_pixel(frame[j], previous[j])) break;
+            if (j + 1 < count && same_pixel(frame[j], frame[j + 1])) break;
+            run++;
+        }
+        if (pos + 1 + run * LED_CODEC_PIXEL_SIZE > out_size) return 0;
+        out[pos++] = LED_CODEC_OP_LITERAL | (uint8_t)(run - 1);
+        memcpy(&out[pos], &frame[i], run * LED_CODEC_PIXEL_SIZE);
+        pos += run * LED_CODEC_PIXEL_SIZE;
+        i += run;
+    }
+    return pos;
+}
+
+int led_frame_decode(const uint8_t* data, size_t size, uint32_t count, bool keyframe,
+                     LedState_t* window, uint32_t window_start, uint32_t window_count) {
+    uint32_t window_end = window_start + window_count;
+    size_t pos = 0;
+    uint32_t led = 0;
+
+    while (led < count) {
+        if (pos >= size) return -1;
+        uint8_t op = data[pos++];
+        uint32_t run = (op & RUN_BITS) + 1;
+        if (run > count - led) return -1;
+
+        // Part of this run that lands in the window
+        uint32_t first = led > window_start ? led : window_start;
+        uint32_t last = led + run < window_end ? led + run : window_end;
+
+        switch (op & LED_CODEC_OP_MASK) {
+            case LED_CODEC_OP_SKIP:
+                if (keyframe) return -1;
+                break;
+            case LED_CODEC_OP_LITERAL:
+                if (size - pos < run * LED_CODEC_PIXEL_SIZE) return -1;
+                if (first < last) {
+                    memcpy(&window[first - window_start], &data[pos + (first - led) * LED_CODEC_PIXEL_SIZE],
+                           (last - first) * LED_CODEC_PIXEL_SIZE);
+                }
+                pos += run * LED_CODEC_PIXEL_SIZE;
+                break;
+            case LED_CODEC_OP_REPEAT: {
+                if (size - pos < LED_CODEC_PIXEL_SIZE) return -1;
+                if (first < last) {
+                    LedState_t color;
+                    memcpy(&color, &data[pos], LED_CODEC_PIXEL_SIZE);
+                    led_span_fill(&window[first - window_start], (int)(last - first), color);
+                }
+                pos += LED_CODEC_PIXEL_SIZE;
+                break;
+            }
+            default:
+                return -1;
+        }
+        led += run;
+    }
+    return (int)pos;
+}
@@ -0,0 +1,45 @@
+#ifndef LED_FRAME_CODEC_H
+#define LED_FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame codec shared by stored animations and frame captures. A frame is a run of
+// ops, each one byte (op | (length - 1)) covering 1..LED_CODEC_RUN_MAX LEDs:
+//   SKIP     LEDs unchanged from the previous frame (delta frames only)
+//   LITERAL  `length` LedState_t values follow
+//   REPEAT   one LedState_t follows, used for all `length` LEDs
+// Pixels are stored as r, g, b, intensity bytes.
+#define LED_CODEC_OP_SKIP     0x00
+#define LED_CODEC_OP_LITERAL  0x40
+#define LED_CODEC_OP_REPEAT   0x80
+#define LED_CODEC_OP_MASK     0xC0
+#define LED_CODEC_RUN_MAX     64
+#define LED_CODEC_PIXEL_SIZE  4
+
+// Upper bound on an encoded frame: a lone literal LED costs 5 bytes, anything else less
+#define LED_CODEC_MAX_ENCODED_SIZE(count) ((size_t)(count) * (LED_CODEC_PIXEL_SIZE + 1))
+
+// Encode frame[0..count) against previous (NULL for a keyframe). Returns the
+// encoded size, 0 if it does not fit in out_size.
+size_t led_frame_encode(const LedState_t* frame, const LedState_t* previous, uint32_t count,
+                        uint8_t* out, size_t out_size);
+
+// Apply an encoded count-LED frame to window[0..window_count), which holds LEDs
+// [window_start, window_start + window_count) of the previous frame; LEDs outside
+// the window are parsed but not stored. Returns the bytes consumed, or -1 when the
+// data is malformed, covers other than count LEDs, or a keyframe contains SKIP.
+int led_frame_decode(const uint8_t* data, size_t size, uint32_t count, bool keyframe,
+                     LedState_t* window, uint32_t window_start, uint32_t window_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_FRAME_CODEC_H
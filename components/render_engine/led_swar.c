@@ -0,0 +1,249 @@
+#include "led_swar.h"
+
+// Word accesses go through memcpy: LedState_t is byte-aligned and this keeps
+// clear of aliasing rules; compilers turn it into single 32-bit loads/stores
+#if LED_SWAR_PIE
+
+// PIE has only signed saturating adds and signed max on 8-bit lanes, so lanes are
+// biased by 0x80 (unsigned order becomes signed order) around each operation:
+//   max:  max_s8(a ^ 0x80, b ^ 0x80) ^ 0x80
+//   add:  a + b saturated at 255 is ((a ^ 0x80) + b) saturated at 127, then
+//         unbiased; b is added as b & 0x7F plus two halves of b & 0x80 so every
+//         addend fits a signed lane, and saturating steps of non-negative addends
+//         saturate like the whole sum
+#define PIE_BLOCK_LEDS 4
+#define PIE_BLOCK_BYTES 16
+
+#if defined(__XTENSA__)
+// Blocks of four LEDs at a 16-byte aligned dst; q registers are not allocated by
+// the compiler, so each loop is one asm statement
+
+static inline void pie_fill_blocks(LedState_t* dst, int blocks, uint32_t word) {
+    __asm__ volatile(
+        "ee.vldbc.32 q0, %[word]\n"
+        "loopnez %[blocks], 1f\n"
+        "ee.vst.128.ip q0, %[dst], 16\n"
+        "1:\n"
+        : [dst] "+r"(dst)
+        : [word] "r"(&word), [blocks] "r"(blocks)
+        : "memory");
+}
+
+static inline void pie_max_blocks(LedState_t* dst, int blocks, uint32_t biased) {
+    const uint32_t bias = LED_SWAR_HIGH;
+    __asm__ volatile(
+        "ee.vldbc.32 q1, %[biased]\n"
+        "ee.vldbc.32 q2, %[bias]\n"
+        "loopnez %[blocks], 1f\n"
+        "ee.vld.128.ip q0, %[dst], 0\n"
+        "ee.xorq q0, q0, q2\n"
+        "ee.vmax.s8 q0, q0, q1\n"
+        "ee.xorq q0, q0, q2\n"
+        "ee.vst.128.ip q0, %[dst], 16\n"
+        "1:\n"
+        : [dst] "+r"(dst)
+        : [biased] "r"(&biased), [bias] "r"(&bias), [blocks] "r"(blocks)
+        : "memory");
+}
+
+static inline void pie_add_blocks(LedState_t* dst, int blocks, uint32_t low, uint32_t half) {
+    const uint32_t bias = LED_SWAR_HIGH;
+    __asm__ volatile(
+        "ee.vldbc.32 q1, %[low]\n"
+        "ee.vldbc.32 q2, %[half]\n"
+        "ee.vldbc.32 q3, %[bias]\n"
+        "loopnez %[blocks], 1f\n"
+        "ee.vld.128.ip q0, %[dst], 0\n"
+        "ee.xorq q0, q0, q3\n"
+        "ee.vadds.s8 q0, q0, q1\n"
+        "ee.vadds.s8 q0, q0, q2\n"
+        "ee.vadds.s8 q0, q0, q2\n"
+        "ee.xorq q0, q0, q3\n"
+        "ee.vst.128.ip q0, %[dst], 16\n"
+        "1:\n"
+        : [dst] "+r"(dst)
+        : [low] "r"(&low), [half] "r"(&half), [bias] "r"(&bias), [blocks] "r"(blocks)
+        : "memory");
+}
+
+#else
+// C model of the instructions used above, one 128-bit q register per PieQ
+
+typedef struct {
+    uint8_t lane[PIE_BLOCK_BYTES];
+} PieQ;
+
+static inline PieQ pie_vldbc_32(uint32_t word) {
+    PieQ q;
+    for (int i = 0; i < PIE_BLOCK_BYTES; i += 4) memcpy(&q.lane[i], &word, 4);
+    return q;
+}
+
+static inline PieQ pie_xorq(PieQ a, PieQ b) {
+    for (int i = 0; i < PIE_BLOCK_BYTES; i++) a.lane[i] ^= b.lane[i];
+    return a;
+}
+
+static inline PieQ pie_vadds_s8(PieQ a, PieQ b) {
+    for (int i = 0; i < PIE_BLOCK_BYTES; i++) {
+        int sum = (int8_t)a.lane[i] + (int8_t)b.lane[i];
+        a.lane[i] = (uint8_t)(int8_t)(sum > 127 ? 127 : sum < -128 ? -128 : sum);
+    }
+    return a;
+}
+
+static inline PieQ pie_vmax_s8(PieQ a, PieQ b) {
+    for (int i = 0; i < PIE_BLOCK_BYTES; i++) {
+        if ((int8_t)b.lane[i] > (int8_t)a.lane[i]) a.lane[i] = b.lane[i];
+    }
+    return a;
+}
+
+static inline void pie_fill_blocks(LedState_t* dst, int blocks, uint32_t word) {
+    PieQ q0 = pie_vldbc_32(word);
+    for (int b = 0; b < blocks; b++, dst += PIE_BLOCK_LEDS) memcpy(dst, &q0, PIE_BLOCK_BYTES);
+}
+
+static inline void pie_max_blocks(LedState_t* dst, int blocks, uint32_t biased) {
+    PieQ q1 = pie_vldbc_32(biased);
+    PieQ q2 = pie_vldbc_32(LED_SWAR_HIGH);
+    for (int b = 0; b < blocks; b++, dst += PIE_BLOCK_LEDS) {
+        PieQ q0;
+        memcpy(&q0, dst, PIE_BLOCK_BYTES);
+        q0 = pie_xorq(pie_vmax_s8(pie_xorq(q0, q2), q1), q2);
+        memcpy(dst, &q0, PIE_BLOCK_BYTES);
+    }
+}
+
+static inline void pie_add_blocks(LedState_t* dst, int blocks, uint32_t low, uint32_t half) {
+    PieQ q1 = pie_vldbc_32(low);
+    PieQ q2 = pie_vldbc_32(half);
+    PieQ q3 = pie_vldbc_32(LED_SWAR_HIGH);
+    for (int b = 0; b < blocks; b++, dst += PIE_BLOCK_LEDS) {
+        PieQ q0;
+        memcpy(&q0, dst, PIE_BLOCK_BYTES);
+        q0 = pie_vadds_s8(pie_xorq(q0, q3), q1);
+        q0 = pie_xorq(pie_vadds_s8(pie_vadds_s8(q0, q2), q2), q3);
+        memcpy(dst, &q0, PIE_BLOCK_BYTES);
+    }
+}
+#endif // __XTENSA__
+
+// LEDs before dst reaches a 16-byte boundary (all of them if it never can)
+static inline int pie_head(const LedState_t* dst, int count) {
+    uintptr_t address = (uintptr_t)dst;
+    if (address & (sizeof(uint32_t) - 1)) return count;
+    int head = (int)((PIE_BLOCK_BYTES - (address & (PIE_BLOCK_BYTES - 1))) & (PIE_BLOCK_BYTES - 1)) / 4;
+    return head < count ? head : count;
+}
+
+// Scalar word op over the LEDs the vector loop does not cover
+#define PIE_EDGE_LOOP(start, end, op)                                       \
+    for (int i = (start); i < (end); i++) {                                \
+        uint32_t below;                                                     \
+        memcpy(&below, &dst[i], sizeof(below));                             \
+        uint32_t blended = op;                                              \
+        memcpy(&dst[i], &blended, sizeof(blended));                         \
+    }
+
+// Head and tail by word op, the aligned middle by a block kernel
+#define PIE_SPAN(op, blocks_call)                                           \
+    do {                                                                    \
+        int head = pie_head(dst, count);                                    \
+        int blocks = (count - head) / PIE_BLOCK_LEDS;                       \
+        int tail = head + blocks * PIE_BLOCK_LEDS;                          \
+        PIE_EDGE_LOOP(0, head, op);                                         \
+        if (blocks > 0) blocks_call;                                        \
+        PIE_EDGE_LOOP(tail, count, op);                                     \
+    } while (0)
+
+void led_span_fill(LedState_t* dst, int count, LedState_t color) {
+    uint32_t word = led_swar_load(color);
+    int head = pie_head(dst, count);
+    int blocks = (count - head) / PIE_BLOCK_LEDS;
+    for (int i = 0; i < head; i++) memcpy(&dst[i], &word, sizeof(word));
+    if (blocks > 0) pie_fill_blocks(dst + head, blocks, word);
+    for (int i = head + blocks * PIE_BLOCK_LEDS; i < count; i++) memcpy(&dst[i], &word, sizeof(word));
+}
+
+void led_span_blend_color(LedState_t* dst, int count, LedState_t color, BlendMode mode) {
+    uint32_t word = led_swar_load(color);
+    switch (mode) {
+        case BLEND_ADD:
+            PIE_SPAN(led_swar_add_sat(below, word),
+                     pie_add_blocks(dst + head, blocks, word & LED_SWAR_LOW7, (word & LED_SWAR_HIGH) >> 1));
+            break;
+        case BLEND_MAX:
+            PIE_SPAN(led_swar_max(below, word), pie_max_blocks(dst + head, blocks, word ^ LED_SWAR_HIGH));
+            break;
+        case BLEND_AVERAGE:  PIE_EDGE_LOOP(0, count, led_swar_average(below, word)); break;
+        case BLEND_MULTIPLY: PIE_EDGE_LOOP(0, count, led_swar_multiply(below, word)); break;
+        case BLEND_REPLACE:  led_span_fill(dst, count, color); break;
+        default: break;
+    }
+}
+
+#else
+
+void led_span_fill(LedState_t* dst, int count, LedState_t color) {
+    uint32_t word = led_swar_load(color);
+    for (int i = 0; i < count; i++) {
+        memcpy(&dst[i], &word, sizeof(word));
+    }
+}
+
+#endif // LED_SWAR_PIE
+
+#if LED_SWAR_KERNELS
+
+// One loop per mode so the mode switch stays out of the per-LED path
+#define SPAN_KERNEL(op, source_word)                                        \
+    for (int i = 0; i < count; i++) {                                      \
+        uint32_t below;                                                     \
+        memcpy(&below, &dst[i], sizeof(below));                             \
+        uint32_t blended = op(below, source_word);                          \
+        memcpy(&dst[i], &blended, sizeof(blended));                         \
+    }
+
+#if !LED_SWAR_PIE
+void led_span_blend_color(LedState_t* dst, int count, LedState_t color, BlendMode mode) {
+    uint32_t word = led_swar_load(color);
+    switch (mode) {
+        case BLEND_ADD:      SPAN_KERNEL(led_swar_add_sat, word); break;
+        case BLEND_MAX:      SPAN_KERNEL(led_swar_max, word); break;
+        case BLEND_AVERAGE:  SPAN_KERNEL(led_swar_average, word); break;
+        case BLEND_MULTIPLY: SPAN_KERNEL(led_swar_multiply, word); break;
+        case BLEND_REPLACE:  led_span_fill(dst, count, color); break;
+        default: break;
+    }
+}
+#endif
+
+void led_span_blend(LedState_t* dst, const LedState_t* src, int count, BlendMode mode) {
+    switch (mode) {
+        case BLEND_ADD:      SPAN_KERNEL(led_swar_add_sat, led_swar_load(src[i])); break;
+        case BLEND_MAX:      SPAN_KERNEL(led_swar_max, led_swar_load(src[i])); break;
+        case BLEND_AVERAGE:  SPAN_KERNEL(led_swar_average, led_swar_load(src[i])); break;
+        case BLEND_MULTIPLY: SPAN_KERNEL(led_swar_multiply, led_swar_load(src[i])); break;
+        case BLEND_REPLACE:  memmove(dst, src, sizeof(LedState_t) * count); break;
+        default: break;
+    }
+}
+
+#else
+
+#if !LED_SWAR_PIE
+void led_span_blend_color(LedState_t* dst, int count, LedState_t color, BlendMode mode) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = led_color_blend(dst[i], color, mode);
+    }
+}
+#endif
+
+void led_span_blend(LedState_t* dst, const LedState_t* src, int count, BlendMode mode) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = led_color_blend(dst[i], src[i], mode);
+    }
+}
+
+#endif // LED_SWAR_KERNELS
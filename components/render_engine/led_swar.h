@@ -0,0 +1,127 @@
+#ifndef LED_SWAR_H
+#define LED_SWAR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "render_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Treat LedState_t as one 32-bit word with four 8-bit lanes and combine all lanes
+// with plain integer ops (SWAR). Every kernel matches led_color_blend bit for bit.
+// Set to 0 to fall back to per-channel led_color_blend loops.
+#ifndef LED_SWAR_KERNELS
+#define LED_SWAR_KERNELS 1
+#endif
+
+// ESP32-S3 PIE: led_span_fill and led_span_blend_color's add, max and replace run
+// on the 128-bit vector unit, four LEDs per instruction, over the 16-byte aligned
+// part of the span. Elsewhere the same kernels run on a C model of the
+// instructions, so host builds with the flag test them against the scalar path.
+#ifndef LED_SWAR_PIE
+#define LED_SWAR_PIE 0
+#endif
+
+_Static_assert(sizeof(LedState_t) == sizeof(uint32_t), "LedState_t must pack into one word");
+
+#define LED_SWAR_LOW7  0x7F7F7F7Fu
+#define LED_SWAR_HIGH  0x80808080u
+#define LED_SWAR_EVEN  0x00FF00FFu
+
+// Byte lane of the intensity channel inside the word
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LED_SWAR_INTENSITY_SHIFT 0
+#else
+#define LED_SWAR_INTENSITY_SHIFT 24
+#endif
+
+static inline uint32_t led_swar_load(LedState_t color) {
+    uint32_t word;
+    memcpy(&word, &color, sizeof(word));
+    return word;
+}
+
+static inline LedState_t led_swar_store(uint32_t word) {
+    LedState_t color;
+    memcpy(&color, &word, sizeof(color));
+    return color;
+}
+
+// 0x80 per lane -> 0xFF per lane
+static inline uint32_t led_swar_lane_mask(uint32_t high_bits) {
+    return (high_bits >> 7) * 0xFFu;
+}
+
+// min(a + b, 255) per lane
+static inline uint32_t led_swar_add_sat(uint32_t a, uint32_t b) {
+    uint32_t low = (a & LED_SWAR_LOW7) + (b & LED_SWAR_LOW7);
+    uint32_t sum = low ^ ((a ^ b) & LED_SWAR_HIGH);
+    uint32_t overflow = ((a & b) | ((a | b) & low)) & LED_SWAR_HIGH;
+    return sum | led_swar_lane_mask(overflow);
+}
+
+// max(a, b) per lane
+static inline uint32_t led_swar_max(uint32_t a, uint32_t b) {
+    // High bit of each lane: a's low 7 bits >= b's low 7 bits (no borrow crosses lanes)
+    uint32_t low_ge = ((a | LED_SWAR_HIGH) - (b & LED_SWAR_LOW7)) & LED_SWAR_HIGH;
+    uint32_t a_ge_b = ((a & ~b) | (~(a ^ b) & low_ge)) & LED_SWAR_HIGH;
+    uint32_t mask = led_swar_lane_mask(a_ge_b);
+    return (a & mask) | (b & ~mask);
+}
+
+// (a + b) / 2 per lane, rounded down
+static inline uint32_t led_swar_average(uint32_t a, uint32_t b) {
+    return (a & b) + (((a ^ b) & ~0x01010101u) >> 1);
+}
+
+// x / 255 rounded down for two 16-bit lanes holding products of two bytes
+static inline uint32_t led_swar_div255_x2(uint32_t products) {
+    return ((products + 0x00010001u + ((products >> 8) & LED_SWAR_EVEN)) >> 8) & LED_SWAR_EVEN;
+}
+
+// a * b / 255 per lane, rounded down
+static inline uint32_t led_swar_multiply(uint32_t a, uint32_t b) {
+    uint32_t even = (a & 0xFFu) * (b & 0xFFu) | ((a >> 16 & 0xFFu) * (b >> 16 & 0xFFu)) << 16;
+    uint32_t odd = (a >> 8 & 0xFFu) * (b >> 8 & 0xFFu) | ((a >> 24) * (b >> 24)) << 16;
+    return led_swar_div255_x2(even) | led_swar_div255_x2(odd) << 8;
+}
+
+// Every lane * scale / 255, rounded down (scale is 0..255)
+static inline uint32_t led_swar_scale(uint32_t word, uint32_t scale) {
+    uint32_t even = (word & LED_SWAR_EVEN) * scale;
+    uint32_t odd = ((word >> 8) & LED_SWAR_EVEN) * scale;
+    return led_swar_div255_x2(even) | led_swar_div255_x2(odd) << 8;
+}
+
+// Fold intensity into r/g/b (c * intensity / 255); the intensity lane comes out
+// as intensity^2 / 255 and should be ignored
+static inline uint32_t led_swar_apply_intensity(uint32_t word) {
+    return led_swar_scale(word, (word >> LED_SWAR_INTENSITY_SHIFT) & 0xFFu);
+}
+
+// led_color_blend on words
+static inline uint32_t led_swar_blend(uint32_t below, uint32_t above, BlendMode mode) {
+    switch (mode) {
+        case BLEND_ADD:      return led_swar_add_sat(below, above);
+        case BLEND_MAX:      return led_swar_max(below, above);
+        case BLEND_AVERAGE:  return led_swar_average(below, above);
+        case BLEND_MULTIPLY: return led_swar_multiply(below, above);
+        case BLEND_REPLACE:  return above;
+        default:             return below;
+    }
+}
+
+// Span kernels over contiguous LEDs
+void led_span_fill(LedState_t* dst, int count, LedState_t color);
+// dst[i] = led_color_blend(dst[i], color, mode)
+void led_span_blend_color(LedState_t* dst, int count, LedState_t color, BlendMode mode);
+// dst[i] = led_color_blend(dst[i], src[i], mode)
+void led_span_blend(LedState_t* dst, const LedState_t* src, int count, BlendMode mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_SWAR_H
@@ -0,0 +1,193 @@
+#include "led_timeline.h"
+
+// Twinkles are seeded by event index, so every pass through a loop looks the same
+#define TIMELINE_SEED_STEP 0x9E3779B9u
+#define TIMELINE_DEFAULT_PALETTE_STEPS 12
+
+bool led_timeline_validate(const LedTimelineEvent* events, int count) {
+    if (!events || count <= 0 || count > LED_TIMELINE_MAX_EVENTS) return false;
+
+    for (int i = 0; i < count; i++) {
+        const LedTimelineEvent* event = &events[i];
+        switch (event->op) {
+            case TIMELINE_SET:
+                if (event->edge >= MAX_EDGES || event->pattern > PATTERN_TWINKLE_ENVELOPE) return false;
+                // Their creation would be refused every time the event fires
+                if (event->period_ms == 0 && (event->pattern == PATTERN_BLINK || event->pattern == PATTERN_PULSE ||
+                                              event->pattern == PATTERN_SHIFT ||
+                                              event->pattern == PATTERN_PALETTE_CYCLE)) {
+                    return false;
+                }
+                break;
+            case TIMELINE_CLEAR:
+                if (event->edge >= MAX_EDGES && event->edge != LED_TIMELINE_ALL_EDGES) return false;
+                break;
+            case TIMELINE_REPEAT:
+                if (event->arg == 0 || event->arg == UINT16_MAX) return false;
+                // fall through
+            case TIMELINE_JUMP:
+                if (event->target >= count) return false;
+                // An unbounded loop back must take time, or it would spin within one frame
+                if (event->op == TIMELINE_JUMP && event->target <= i &&
+                    events[event->target].at_ms >= event->at_ms) return false;
+                break;
+            case TIMELINE_END:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+void led_timeline_init(LedTimeline* timeline) {
+    memset(timeline, 0, sizeof(*timeline));
+    for (int e = 0; e < MAX_EDGES; e++) {
+        timeline->edge_pattern[e] = -1;
+    }
+}
+
+static void timeline_clear_edge(LEDController* controller, int edge) {
+    LedTimeline* timeline = &controller->timeline;
+    if (timeline->edge_pattern[edge] >= 0) {
+        led_pattern_remove(controller, timeline->edge_pattern[edge]);
+        timeline->edge_pattern[edge] = -1;
+    }
+}
+
+void led_timeline_begin(LEDController* controller, const LedTimelineEvent* events, int count, uint32_t time) {
+    led_timeline_end(controller);
+
+    LedTimeline* timeline = &controller->timeline;
+    timeline->events = events;
+    timeline->count = (uint16_t)count;
+    timeline->next = 0;
+    timeline->base_time = time;
+}
+
+void led_timeline_end(LEDController* controller) {
+    LedTimeline* timeline = &controller->timeline;
+    for (int e = 0; e < MAX_EDGES; e++) {
+        timeline_clear_edge(controller, e);
+    }
+    timeline->events = NULL;
+    memset(timeline->repeat_left, 0, sizeof(timeline->repeat_left));
+}
+
+// Create the pattern a TIMELINE_SET event describes; -1 on failure
+static int timeline_create_pattern(LEDController* controller, const LedTimelineEvent* event, uint32_t seed) {
+    if (!nextLedConfigState || event->edge >= nextLedConfigState->num_edges) return -1;
+
+    int edge = event->edge;
+    int edge_length = (int)nextLedConfigState->num_led_per_edge[edge];
+    int start = event->start_index;
+    int end = event->count ? start + event->count - 1 : edge_length - 1;
+    if (end >= edge_length) end = edge_length - 1;
+    if (start > end) return -1;
+
+    switch (event->pattern) {
+        case PATTERN_STATIC:
+            return led_pattern_static(controller, edge, start, end, event->color);
+        case PATTERN_BLINK:
+            return led_pattern_blink(controller, edge, start, end, event->color,
+                                     event->period_ms / 2, event->period_ms - event->period_ms / 2, event->arg);
+        case PATTERN_FADE:
+            return led_pattern_fade(controller, edge, start, end, event->color, event->color2, event->period_ms);
+        case PATTERN_PULSE:
+            return led_pattern_pulse(controller, edge, start, end, event->color, (uint8_t)event->arg, event->period_ms);
+        case PATTERN_SHIFT:
+            return led_pattern_shift_comet(controller, edge, start, end, event->color, event->arg, event->period_ms);
+        case PATTERN_GRADIENT:
+            return led_pattern_gradient(controller, edge, start, end, event->color, event->color2);
+        case PATTERN_TWINKLE:
+            return led_pattern_twinkle_seeded(controller, edge, start, end, event->color,
+                                              event->arg / 1000.0f, seed);
+        case PATTERN_PALETTE_CYCLE: {
+            ColorPalette palette = led_palette_rainbow(event->arg ? event->arg : TIMELINE_DEFAULT_PALETTE_STEPS);
+            return led_pattern_palette_cycle(controller, edge, start, end, palette, event->period_ms, 0);
+        }
+        case PATTERN_TWINKLE_ENVELOPE:
+            return led_pattern_twinkle_envelope(controller, edge, start, end, event->color, event->arg / 1000.0f,
+                                                event->period_ms, event->period_ms, seed);
+        default:
+            return -1;
+    }
+}
+
+// Swap the edge's pattern in one batch, started at the event's due time
+static void timeline_set(LEDController* controller, const LedTimelineEvent* event, uint32_t due, uint32_t seed) {
+    LedTimeline* timeline = &controller->timeline;
+
+    led_batch_begin(controller);
+    if (timeline->edge_pattern[event->edge] >= 0) {
+        led_pattern_remove(controller, timeline->edge_pattern[event->edge]);
+    }
+    int pattern_id = timeline_create_pattern(controller, event, seed);
+    if (pattern_id >= 0) {
+        led_pattern_start(controller, pattern_id, due);
+    }
+    if (led_batch_commit(controller) == pdPASS) {
+        timeline->edge_pattern[event->edge] = pattern_id;
+    }
+}
+
+// Continue at `target`, which becomes due when the jump was
+static void timeline_jump(LedTimeline* timeline, uint32_t at_ms, uint16_t target) {
+    timeline->base_time += at_ms - timeline->events[target].at_ms;
+    timeline->next = target;
+}
+
+void led_timeline_advance(LEDController* controller, uint32_t time) {
+    LedTimeline* timeline = &controller->timeline;
+
+    while (timeline->events && timeline->next < timeline->count) {
+        uint16_t index = timeline->next;
+        const LedTimelineEvent* event = &timeline->events[index];
+        uint32_t due = timeline->base_time + event->at_ms;
+        if ((int32_t)(time - due) < 0) return;
+
+        switch (event->op) {
+            case TIMELINE_SET:
+                timeline_set(controller, event, due, (index + 1u) * TIMELINE_SEED_STEP);
+                timeline->next++;
+                break;
+            case TIMELINE_CLEAR:
+                if (event->edge == LED_TIMELINE_ALL_EDGES) {
+                    for (int e = 0; e < MAX_EDGES; e++) {
+                        timeline_clear_edge(controller, e);
+                    }
+                } else {
+                    timeline_clear_edge(controller, event->edge);
+                }
+                timeline->next++;
+                break;
+            case TIMELINE_JUMP:
+                timeline_jump(timeline, event->at_ms, event->target);
+                break;
+            case TIMELINE_REPEAT:
+                if (timeline->repeat_left[index] == 0) {
+                    timeline->repeat_left[index] = event->arg + 1;
+                }
+                if (--timeline->repeat_left[index] > 0) {
+                    timeline_jump(timeline, event->at_ms, event->target);
+                } else {
+                    timeline->next++;   // Disarmed, so an outer loop starts a fresh count
+                }
+                break;
+            case TIMELINE_END:
+            default:
+                timeline->events = NULL;
+                return;
+        }
+    }
+
+    // Ran off the end
+    timeline->events = NULL;
+}
+
+uint32_t led_timeline_next_due_in(const LedTimeline* timeline, uint32_t time) {
+    if (!timeline->events || timeline->next >= timeline->count) return LED_NEVER;
+
+    uint32_t due = timeline->base_time + timeline->events[timeline->next].at_ms;
+    return (int32_t)(due - time) > 0 ? due - time : 0;
+}
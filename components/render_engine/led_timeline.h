@@ -0,0 +1,34 @@
+#ifndef LED_TIMELINE_H
+#define LED_TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "render_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Render task side of the timeline; led_timeline_play/stop queue the commands
+// that end up here. Events turn into ordinary pattern calls, queued in one batch
+// per event and applied on the same frame.
+
+// Jump targets in range, backward jumps move time forward, REPEAT counts set,
+// periodic patterns have a period
+bool led_timeline_validate(const LedTimelineEvent* events, int count);
+void led_timeline_init(LedTimeline* timeline);
+// Replace the playing timeline; timeline time 0 is `time`
+void led_timeline_begin(LEDController* controller, const LedTimelineEvent* events, int count, uint32_t time);
+// Stop and remove every pattern the timeline set
+void led_timeline_end(LEDController* controller);
+// Fire every event due at or before `time`; a pattern started by an event is
+// phased from the event's due time, not from the frame that ran it
+void led_timeline_advance(LEDController* controller, uint32_t time);
+// ms after `time` until the next event is due, LED_NEVER when idle
+uint32_t led_timeline_next_due_in(const LedTimeline* timeline, uint32_t time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_TIMELINE_H
@@ -1,17 +1,77 @@
 #include "render_engine.h"
+#include "led_swar.h"
+#include "led_timeline.h"
+#include "led_frame_codec.h"
+#include "led_capture.h"
 #include <stdio.h>
 #include <time.h>
 #include  <math.h>
 #include "main.h"
-// Forward declarations for static functions
-static void apply_static_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_blink_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_fade_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_pulse_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_shift_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_gradient_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_twinkle_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
-static void apply_palette_cycle_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time);
+#include "frame_telemetry.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#if LED_FIXED_POINT
+// (sin(2*pi*i/256) + 1) / 2 scaled to 0..65535, with the first entry repeated at the end
+static const uint16_t sine_wave_q16[257] = {
+    32768, 33572, 34375, 35178, 35979, 36779, 37575, 38369,
+    39160, 39947, 40729, 41507, 42279, 43046, 43807, 44560,
+    45307, 46046, 46777, 47500, 48214, 48919, 49613, 50298,
+    50972, 51635, 52287, 52927, 53555, 54170, 54773, 55362,
+    55938, 56499, 57047, 57579, 58097, 58600, 59087, 59558,
+    60013, 60451, 60873, 61278, 61666, 62036, 62389, 62724,
+    63041, 63339, 63620, 63881, 64124, 64348, 64553, 64739,
+    64905, 65053, 65180, 65289, 65377, 65446, 65496, 65525,
+    65535, 65525, 65496, 65446, 65377, 65289, 65180, 65053,
+    64905, 64739, 64553, 64348, 64124, 63881, 63620, 63339,
+    63041, 62724, 62389, 62036, 61666, 61278, 60873, 60451,
+    60013, 59558, 59087, 58600, 58097, 57579, 57047, 56499,
+    55938, 55362, 54773, 54170, 53555, 52927, 52287, 51635,
+    50972, 50298, 49613, 48919, 48214, 47500, 46777, 46046,
+    45307, 44560, 43807, 43046, 42279, 41507, 40729, 39947,
+    39160, 38369, 37575, 36779, 35979, 35178, 34375, 33572,
+    32768, 31963, 31160, 30357, 29556, 28756, 27960, 27166,
+    26375, 25588, 24806, 24028, 23256, 22489, 21728, 20975,
+    20228, 19489, 18758, 18035, 17321, 16616, 15922, 15237,
+    14563, 13900, 13248, 12608, 11980, 11365, 10762, 10173,
+     9597,  9036,  8488,  7956,  7438,  6935,  6448,  5977,
+     5522,  5084,  4662,  4257,  3869,  3499,  3146,  2811,
+     2494,  2196,  1915,  1654,  1411,  1187,   982,   796,
+      630,   482,   355,   246,   158,    89,    39,    10,
+        0,    10,    39,    89,   158,   246,   355,   482,
+      630,   796,   982,  1187,  1411,  1654,  1915,  2196,
+     2494,  2811,  3146,  3499,  3869,  4257,  4662,  5084,
+     5522,  5977,  6448,  6935,  7438,  7956,  8488,  9036,
+     9597, 10173, 10762, 11365, 11980, 12608, 13248, 13900,
+    14563, 15237, 15922, 16616, 17321, 18035, 18758, 19489,
+    20228, 20975, 21728, 22489, 23256, 24028, 24806, 25588,
+    26375, 27166, 27960, 28756, 29556, 30357, 31160, 31963,
+    32768
+};
+
+// Convert a float fraction to Q16.16, clamped to [0, 1]
+static inline uint32_t fraction_to_q16(float t) {
+    if (t <= 0.0f) return 0;
+    if (t >= 1.0f) return LED_Q16_ONE;
+    return (uint32_t)(t * (float)LED_Q16_ONE);
+}
+#endif
+
+// Probability as a Q16.16 threshold for (random >> 16); 1.0 must pass every draw
+static uint32_t probability_to_q16(float probability) {
+    if (probability <= 0.0f) return 0;
+    if (probability >= 1.0f) return LED_Q16_ONE + 1;
+    return (uint32_t)(probability * (float)LED_Q16_ONE);
+}
+
+// Avalanche a 32-bit value (murmur3 finalizer) so nearby seeds diverge at once
+static inline uint32_t random_mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
 
 // Global random seed
 static bool random_seeded = false;
@@ -31,103 +91,606 @@ LEDController* led_controller_create(int num_edges, int* leds_per_edge) {
     if (!controller) return NULL;
     controller->pattern_count = 0;
     controller->current_time = 0;
+    controller->dirty_edges = (1u << MAX_EDGES) - 1; // Publish an initial blank frame
+    controller->next_change_in = 0;
+    atomic_store(&controller->seed_sequence, 0);
     
-    // Initialize patterns array
+    // Initialize patterns array with every slot free
     memset(controller->patterns, 0, sizeof(controller->patterns));
+    led_index_stack_init(&controller->free_slots, controller->slot_links, MAX_PATTERNS);
+    led_command_queue_init(&controller->commands);
+    led_arena_init(&controller->arena, controller->arena_memory, controller->arena_used,
+                   LED_PATTERN_ARENA_GROUPS);
+    led_timeline_init(&controller->timeline);
+    
+    controller->scratch_length = 0;
+    controller->scratch_rows[0] = controller->scratch_pixels;
+    controller->scratch_frame = (LedEdgeConfigState_t){
+        .num_edges = 1,
+        .num_led_per_edge = &controller->scratch_length,
+        .data = controller->scratch_rows,
+#if FRAMEBUFFER_INDEXED
+        .palette = controller->scratch_palette,
+#endif
+    };
     if(framebuffer_init(num_edges, (uint32_t*)leds_per_edge) != pdPASS) {
         printf("Error: Failed to initialize frame buffer\n");
         free(controller);
         return pdFAIL;
     }
+    frame_telemetry_init(LED_MIN_FRAME_PERIOD_MS * 1000);
     ensure_random_seed();
     return controller;
 }
 
+static void command_discard(LEDController* controller, LedCommand* command);
+static void pattern_discard(LEDController* controller, int slot);
+
 void led_controller_destroy(LEDController* controller) {
     if (!controller) return;
     
-    // Free pattern parameters
-    for (int i = 0; i < controller->pattern_count; i++) {
-        if (controller->patterns[i].params) {
-            free(controller->patterns[i].params);
-        }
+    // Changes never applied still hold what they claimed: created patterns their
+    // slots and storage, segment lists their copies
+    LedCommand* command;
+    while ((command = led_command_pop(&controller->commands)) != NULL) {
+        command_discard(controller, command);
+    }
+    
+    // Then every live pattern gets its type's destroy and gives its storage back
+    for (int slot = 0; slot < MAX_PATTERNS; slot++) {
+        if (controller->patterns[slot].in_use) pattern_discard(controller, slot);
     }
     framebuffer_cleanup();
     free(controller);
 }
 
-void led_controller_update(LEDController* controller, uint32_t time) {
-    if (!controller || !nextLedConfigState->data) return;
+_Static_assert(MAX_PATTERNS <= (1 << PATTERN_HANDLE_SLOT_BITS), "pattern slot does not fit the handle");
+
+// Commands queued by the pattern functions and applied by the render task
+enum {
+    PATTERN_COMMAND_CREATE,
+    PATTERN_COMMAND_REMOVE,
+    PATTERN_COMMAND_STOP,
+    PATTERN_COMMAND_START,
+    PATTERN_COMMAND_SET_BLEND,
+    PATTERN_COMMAND_SET_Z_ORDER,
+    PATTERN_COMMAND_SET_SEGMENTS,   // data: arg LedSegments in pattern memory, freed when applied
+    PATTERN_COMMAND_TIMELINE_PLAY,
+    PATTERN_COMMAND_TIMELINE_STOP
+};
+
+// Changes queued by this task since the outermost led_batch_begin
+typedef struct {
+    LEDController* controller;
+    int depth;
+    bool failed;
+    LedCommand* first;
+    LedCommand* last;
+} CommandBatch;
+
+static _Thread_local CommandBatch command_batch;
+
+static inline bool batch_open(LEDController* controller) {
+    return command_batch.depth > 0 && command_batch.controller == controller;
+}
+
+// A change could not be queued: an open batch must not land partially
+static inline void batch_fail(LEDController* controller) {
+    if (batch_open(controller)) command_batch.failed = true;
+}
+
+// Pattern data beyond the slot: an arena run, or heap memory when the arena has
+// no room. Only claimed when a pattern is created or resegmented, never mid-frame.
+static void* pattern_memory_alloc(LEDController* controller, size_t size) {
+    void* memory = led_arena_alloc(&controller->arena, size);
+    return memory ? memory : malloc(size ? size : 1);
+}
+
+static void pattern_memory_free(LEDController* controller, void* memory, size_t size) {
+    if (led_arena_contains(&controller->arena, memory)) {
+        led_arena_free(&controller->arena, memory, size);
+    } else {
+        free(memory);
+    }
+}
+
+// Give a reserved slot and its storage back; the new generation retires the
+// handle handed out for it
+static void pattern_release_slot(LEDController* controller, int slot) {
+    Pattern* pattern = &controller->patterns[slot];
+    pattern_memory_free(controller, pattern->storage, pattern->storage_size);
+    pattern->storage = NULL;
+    pattern->generation = (pattern->generation + 1) & PATTERN_GENERATION_MASK;
+    led_index_stack_push(&controller->free_slots, controller->slot_links, (uint16_t)slot);
+}
+
+// Release a pattern that finished init: its type's destroy, then the slot
+static void pattern_discard(LEDController* controller, int slot) {
+    Pattern* pattern = &controller->patterns[slot];
+    if (pattern->pattern_class->destroy) pattern->pattern_class->destroy(pattern);
+    pattern_release_slot(controller, slot);
+}
+
+// Drop a command that will never be applied, releasing what it holds
+static void command_discard(LEDController* controller, LedCommand* command) {
+    if (command->type == PATTERN_COMMAND_CREATE) {
+        pattern_discard(controller, command->target & PATTERN_HANDLE_SLOT_MASK);
+    } else if (command->type == PATTERN_COMMAND_SET_SEGMENTS) {
+        pattern_memory_free(controller, (void*)command->data, (size_t)command->arg * sizeof(LedSegment));
+    }
+    led_command_free(&controller->commands, command);
+}
+
+// Queue one command, or add it to the open batch; never blocks
+static bool command_submit_data(LEDController* controller, uint8_t type, int pattern_id, int32_t arg,
+                                const void* data) {
+    if (!controller) return false;
+    
+    LedCommand* command = led_command_alloc(&controller->commands);
+    if (!command) {
+        batch_fail(controller);
+        return false;
+    }
+    command->type = type;
+    command->target = pattern_id;
+    command->arg = arg;
+    command->data = data;
+    
+    if (batch_open(controller)) {
+        if (command_batch.last) {
+            atomic_store_explicit(&command_batch.last->next, command, memory_order_relaxed);
+        } else {
+            command_batch.first = command;
+        }
+        command_batch.last = command;
+        return true;
+    }
+    
+    led_command_push_chain(&controller->commands, command, command);
+    led_controller_wake();
+    return true;
+}
+
+static inline bool command_submit(LEDController* controller, uint8_t type, int pattern_id, int32_t arg) {
+    return command_submit_data(controller, type, pattern_id, arg, NULL);
+}
+
+void led_batch_begin(LEDController* controller) {
+    if (!controller) return;
+    if (command_batch.depth++ > 0) return;
+    
+    command_batch.controller = controller;
+    command_batch.failed = false;
+    command_batch.first = NULL;
+    command_batch.last = NULL;
+}
+
+BaseType_t led_batch_commit(LEDController* controller) {
+    if (!batch_open(controller)) return pdFAIL;
+    if (--command_batch.depth > 0) return command_batch.failed ? pdFAIL : pdPASS;
+    
+    LedCommand* first = command_batch.first;
+    LedCommand* last = command_batch.last;
+    command_batch.first = NULL;
+    command_batch.last = NULL;
+    
+    if (command_batch.failed) {
+        // Drop the whole batch; the render task never saw the patterns it created
+        while (first) {
+            LedCommand* next = atomic_load_explicit(&first->next, memory_order_relaxed);
+            command_discard(controller, first);
+            first = next;
+        }
+        return pdFAIL;
+    }
+    
+    if (first) {
+        led_command_push_chain(&controller->commands, first, last);
+        led_controller_wake();
+    }
+    return pdPASS;
+}
+
+// Take a free slot and fill in the fields every pattern shares (O(1), any task).
+// The render task ignores the slot until the pattern is published.
+static Pattern* pattern_reserve(LEDController* controller, int type, const LedPatternClass* pattern_class,
+                                int edge, int start_idx, int end_idx, int* pattern_id) {
+    uint16_t slot;
+    if (!controller || !led_index_stack_pop(&controller->free_slots, controller->slot_links, &slot)) {
+        batch_fail(controller);
+        return NULL;
+    }
+    
+    Pattern* pattern = &controller->patterns[slot];
+    pattern->type = (PatternType)type;
+    pattern->pattern_class = pattern_class;
+    pattern->edge = edge;
+    pattern->start_index = start_idx;
+    pattern->end_index = end_idx;
+    pattern->duration = 0;
+    pattern->blend_mode = BLEND_REPLACE;
+    pattern->z_order = 0;
+    pattern->coverage = NULL;
+    pattern->segment_count = 0;
+    pattern->params = &pattern->param_storage;
+    
+    *pattern_id = (pattern->generation << PATTERN_HANDLE_SLOT_BITS) | slot;
+    return pattern;
+}
+
+// Hand a fully set up pattern to the render task; it starts on the frame that picks it up
+static int pattern_publish(LEDController* controller, int pattern_id) {
+    if (!command_submit(controller, PATTERN_COMMAND_CREATE, pattern_id, 0)) {
+        pattern_discard(controller, pattern_id & PATTERN_HANDLE_SLOT_MASK);
+        return -1;
+    }
+    return pattern_id;
+}
+
+// Resolve a handle; NULL if it is malformed or its pattern has been removed (render task only)
+static Pattern* pattern_lookup(LEDController* controller, int pattern_id) {
+    if (!controller || pattern_id < 0) return NULL;
+    
+    int slot = pattern_id & PATTERN_HANDLE_SLOT_MASK;
+    if (slot >= MAX_PATTERNS) return NULL;
+    
+    Pattern* pattern = &controller->patterns[slot];
+    if (!pattern->in_use || pattern->generation != (pattern_id >> PATTERN_HANDLE_SLOT_BITS)) return NULL;
+    return pattern;
+}
+
+// Animation frame shown at pattern time `time`
+static uint32_t animation_frame_at(const AnimationParams* params, uint32_t time) {
+    uint32_t frame = time / params->animation->frame_period_ms;
+    if (params->loop) return frame % params->animation->frame_count;
+    return frame < params->animation->frame_count ? frame : params->animation->frame_count - 1;
+}
+
+static inline uint32_t edge_bit(int edge) {
+    return (edge >= 0 && edge < MAX_EDGES) ? 1u << edge : 0;
+}
+
+// Bit per edge the pattern draws on
+static uint32_t pattern_edges(const Pattern* pattern) {
+    if (pattern->segment_count == 0) return edge_bit(pattern->edge);
+    uint32_t edges = 0;
+    for (int s = 0; s < pattern->segment_count; s++) {
+        edges |= edge_bit(pattern->segments[s].edge);
+    }
+    return edges;
+}
+
+// Mark every edge the pattern draws on as needing a new frame
+static void mark_pattern_dirty(LEDController* controller, const Pattern* pattern) {
+    controller->dirty_edges |= pattern_edges(pattern);
+}
+
+// Output timing of the built-in types, see LedPatternClass::next_change and
+// ::output_key. Time-invariant patterns only change on creation, removal or restart.
+static uint32_t never_changes(const Pattern* pattern, uint32_t time) {
+    return LED_NEVER;
+}
+
+static uint32_t constant_output_key(const Pattern* pattern, uint32_t time) {
+    return 0;
+}
+
+static uint32_t blink_output_key(const Pattern* pattern, uint32_t time) {
+    const BlinkParams* params = (const BlinkParams*)pattern->params;
+    return (time % (params->on_time + params->off_time)) < params->on_time;
+}
+
+static uint32_t blink_next_change(const Pattern* pattern, uint32_t time) {
+    const BlinkParams* params = (const BlinkParams*)pattern->params;
+    uint32_t phase = time % (params->on_time + params->off_time);
+    return phase < params->on_time ? params->on_time - phase
+                                   : params->on_time + params->off_time - phase;
+}
+
+// A fade of duration 0 has finished on creation and holds its end color
+static uint32_t fade_output_key(const Pattern* pattern, uint32_t time) {
+    return time >= pattern->duration ? pattern->duration : time;
+}
+
+static uint32_t fade_next_change(const Pattern* pattern, uint32_t time) {
+    return time >= pattern->duration ? LED_NEVER : 0;
+}
+
+static uint32_t shift_output_key(const Pattern* pattern, uint32_t time) {
+    const ShiftParams* params = (const ShiftParams*)pattern->params;
+    return (time / params->period) % params->pattern_length;
+}
+
+static uint32_t shift_next_change(const Pattern* pattern, uint32_t time) {
+    const ShiftParams* params = (const ShiftParams*)pattern->params;
+    return params->period - time % params->period;
+}
+
+static uint32_t twinkle_output_key(const Pattern* pattern, uint32_t time) {
+    return time / 100; // Twinkle reseeds every 100ms
+}
+
+static uint32_t twinkle_next_change(const Pattern* pattern, uint32_t time) {
+    return 100 - time % 100;
+}
+
+static uint32_t twinkle_envelope_output_key(const Pattern* pattern, uint32_t time) {
+    return time / TWINKLE_ENVELOPE_STEP_MS;
+}
+
+static uint32_t twinkle_envelope_next_change(const Pattern* pattern, uint32_t time) {
+    return TWINKLE_ENVELOPE_STEP_MS - time % TWINKLE_ENVELOPE_STEP_MS;
+}
+
+static uint32_t animation_output_key(const Pattern* pattern, uint32_t time) {
+    return animation_frame_at((const AnimationParams*)pattern->params, time);
+}
+
+static uint32_t animation_next_change(const Pattern* pattern, uint32_t time) {
+    const AnimationParams* params = (const AnimationParams*)pattern->params;
+    uint32_t period = params->animation->frame_period_ms;
+    bool finished = !params->loop && time / period >= params->animation->frame_count - 1;
+    return finished ? LED_NEVER : period - time % period;
+}
+
+// Value that changes exactly when the pattern's output changes
+static inline uint32_t pattern_output_key(const Pattern* pattern, uint32_t time) {
+    const LedPatternClass* pattern_class = pattern->pattern_class;
+    return pattern_class->output_key ? pattern_class->output_key(pattern, time) : time;
+}
+
+// ms after `time` until the pattern's output next changes; 0 for continuously
+// changing output, LED_NEVER when it only changes on creation, removal or restart
+static uint32_t pattern_next_change(const Pattern* pattern, uint32_t time) {
+    const LedPatternClass* pattern_class = pattern->pattern_class;
+    uint32_t next = pattern_class->next_change ? pattern_class->next_change(pattern, time) : 0;
+    
+    // Expiry clears the pattern's LEDs one ms after its duration
+    if (pattern->duration > 0) {
+        uint32_t until_expiry = time <= pattern->duration ? pattern->duration - time + 1 : 0;
+        if (until_expiry < next) next = until_expiry;
+    }
+    return next;
+}
+
+// Apply one queued change (render task)
+static void apply_pattern_command(LEDController* controller, const LedCommand* command, uint32_t time) {
+    if (command->type == PATTERN_COMMAND_TIMELINE_PLAY) {
+        led_timeline_begin(controller, (const LedTimelineEvent*)command->data, command->arg, time);
+        return;
+    }
+    if (command->type == PATTERN_COMMAND_TIMELINE_STOP) {
+        led_timeline_end(controller);
+        return;
+    }
+    
+    if (command->type == PATTERN_COMMAND_CREATE) {
+        int slot = command->target & PATTERN_HANDLE_SLOT_MASK;
+        Pattern* pattern = &controller->patterns[slot];
+        pattern->in_use = true;
+        pattern->active = true;
+        pattern->output_valid = false;
+        pattern->start_time = time;
+        controller->pattern_count++;
+        mark_pattern_dirty(controller, pattern);
+        return;
+    }
+    
+    Pattern* pattern = pattern_lookup(controller, command->target);
+    if (command->type == PATTERN_COMMAND_SET_SEGMENTS) {
+        // The copy is freed even when the handle is stale
+        if (pattern) {
+            if (pattern->active) mark_pattern_dirty(controller, pattern);
+            pattern->segment_count = command->arg;
+            if (command->data) memcpy(pattern->segments, command->data, (size_t)command->arg * sizeof(LedSegment));
+            if (pattern->active) mark_pattern_dirty(controller, pattern);
+        }
+        pattern_memory_free(controller, (void*)command->data, (size_t)command->arg * sizeof(LedSegment));
+        return;
+    }
+    if (!pattern) return;
+    
+    switch (command->type) {
+        case PATTERN_COMMAND_REMOVE:
+            if (pattern->active) mark_pattern_dirty(controller, pattern);
+            pattern->active = false;
+            pattern->in_use = false;
+            controller->pattern_count--;
+            pattern_discard(controller, command->target & PATTERN_HANDLE_SLOT_MASK);
+            break;
+        case PATTERN_COMMAND_STOP:
+            if (pattern->active) mark_pattern_dirty(controller, pattern);
+            pattern->active = false;
+            break;
+        case PATTERN_COMMAND_START:
+            pattern->start_time = (uint32_t)command->arg;
+            pattern->active = true;
+            pattern->output_valid = false;
+            break;
+        case PATTERN_COMMAND_SET_BLEND:
+            pattern->blend_mode = (BlendMode)command->arg;
+            mark_pattern_dirty(controller, pattern);
+            break;
+        case PATTERN_COMMAND_SET_Z_ORDER:
+            pattern->z_order = command->arg;
+            mark_pattern_dirty(controller, pattern);
+            break;
+    }
+}
+
+// Apply everything queued so far before the frame looks at any pattern; a batch
+// is published as one chain, so it is either applied whole or left for next frame
+static void apply_pattern_commands(LEDController* controller, uint32_t time) {
+    LedCommand* command;
+    while ((command = led_command_pop(&controller->commands)) != NULL) {
+        apply_pattern_command(controller, command, time);
+        led_command_free(&controller->commands, command);
+    }
+}
+
+static void pattern_render_segments(LEDController* controller, LedEdgeConfigState_t* frame,
+                                    Pattern* pattern, uint32_t time);
+static void matrix_begin_frame(LedEdgeConfigState_t* frame, const LedEdgeConfigState_t* previous,
+                               uint32_t redraw);
+
+bool led_controller_update(LEDController* controller, uint32_t time) {
+    if (!controller || !nextLedConfigState->data) return false;
 
     controller->current_time = time;
+    apply_pattern_commands(controller, time);
+    
+    // Timeline events queue ordinary pattern changes; apply them on this frame too
+    led_timeline_advance(controller, time);
+    apply_pattern_commands(controller, time);
 
-    // Process each active pattern
-    for (int i = 0; i < controller->pattern_count; i++) {
+    // Collect active patterns in z-order (insertion sort keeps creation order for equal z)
+    int layers[MAX_PATTERNS];
+    int layer_count = 0;
+    uint32_t next_change_in = LED_NEVER;
+    for (int i = 0; i < MAX_PATTERNS; i++) {
         Pattern* pattern = &controller->patterns[i];
         if (!pattern->active) continue;
         
         uint32_t pattern_time = time - pattern->start_time;
         if (pattern->duration > 0 && pattern_time > pattern->duration) {
             pattern->active = false;
+            mark_pattern_dirty(controller, pattern);
             continue;
         }
         
-        led_matrix_clear(nextLedConfigState);
+        uint32_t key = pattern_output_key(pattern, pattern_time);
+        if (!pattern->output_valid || key != pattern->output_key) {
+            pattern->output_key = key;
+            pattern->output_valid = true;
+            mark_pattern_dirty(controller, pattern);
+        }
+        
+        uint32_t pattern_next = pattern_next_change(pattern, pattern_time);
+        if (pattern_next < next_change_in) next_change_in = pattern_next;
         
-        // Apply pattern based on type
-        switch (pattern->type) {
-            case PATTERN_STATIC:
-                apply_static_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_BLINK:
-                apply_blink_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_FADE:
-                apply_fade_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_PULSE:
-                apply_pulse_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_SHIFT:
-                apply_shift_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_GRADIENT:
-                apply_gradient_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_TWINKLE:
-                apply_twinkle_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
-            case PATTERN_PALETTE_CYCLE:
-                apply_palette_cycle_pattern(nextLedConfigState, pattern, pattern_time);
-                break;
+        int pos = layer_count++;
+        while (pos > 0 && controller->patterns[layers[pos - 1]].z_order > pattern->z_order) {
+            layers[pos] = layers[pos - 1];
+            pos--;
+        }
+        layers[pos] = i;
+    }
+
+    uint32_t timeline_next = led_timeline_next_due_in(&controller->timeline, time);
+    if (timeline_next < next_change_in) next_change_in = timeline_next;
+    controller->next_change_in = next_change_in;
+
+#if LED_SKIP_UNCHANGED_FRAMES
+    // Nothing changed: keep showing the previous frame
+    if (controller->dirty_edges == 0) return false;
+#endif
+    uint32_t redraw = controller->dirty_edges;
+    controller->dirty_edges = 0;
+
+    // Only layers on changed edges are drawn again, over those edges cleared; the
+    // rest of the frame is copied from the last one. A layer spanning several
+    // edges is drawn on all of them, so they are all redrawn: grow the set until
+    // no layer reaches outside it.
+    const LedEdgeConfigState_t* previous = framebuffer_last_published();
+    if (!previous) redraw = (1u << MAX_EDGES) - 1;
+    for (;;) {
+        uint32_t grown = redraw;
+        for (int l = 0; l < layer_count; l++) {
+            uint32_t edges = pattern_edges(&controller->patterns[layers[l]]);
+            if (edges & redraw) grown |= edges;
         }
+        if (grown == redraw) break;
+        redraw = grown;
+    }
+    matrix_begin_frame(nextLedConfigState, previous, redraw);
+
+    for (int l = 0; l < layer_count; l++) {
+        Pattern* pattern = &controller->patterns[layers[l]];
+        uint32_t pattern_time = time - pattern->start_time;
+        if (!(pattern_edges(pattern) & redraw)) continue;
         
-        //swap frames in framebuffer
-        framebuffer_swap();
+        if (pattern->segment_count > 0) {
+            pattern_render_segments(controller, nextLedConfigState, pattern, pattern_time);
+        } else {
+            pattern->pattern_class->render(nextLedConfigState, pattern, pattern_time);
+        }
+    }
+    
+    led_capture_frame(nextLedConfigState, time);
+
+    //swap frames in framebuffer once the whole frame is composited
+    framebuffer_publish(redraw);
+    return true;
+}
+
+uint32_t led_controller_frame_delay_ms(LEDController* controller, uint32_t now, uint32_t min_period_ms) {
+    if (!controller) return LED_NEVER;
+    
+    uint32_t since_update = now - controller->current_time;
+    uint32_t until_change = controller->dirty_edges ? 0 : controller->next_change_in;
+#if !LED_SKIP_UNCHANGED_FRAMES
+    if (until_change == LED_NEVER) until_change = min_period_ms;
+#endif
+    if (until_change == LED_NEVER) return LED_NEVER;
+    
+    if (until_change < min_period_ms) until_change = min_period_ms;
+    return until_change > since_update ? until_change - since_update : 0;
+}
+
+void led_controller_wake(void) {
+    // The render task applies its own changes before it sleeps again
+    if (render_engine_task_handle && xTaskGetCurrentTaskHandle() != render_engine_task_handle) {
+        xTaskNotifyGive(render_engine_task_handle);
     }
 }
 
+// Runs in the esp_timer task when the next render pass is due
+static void render_wake_callback(void* arg) {
+    led_controller_wake();
+}
+
 //render engine task fucntion
 void led_controller_task(void* params){
-    TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t render_period = pdMS_TO_TICKS(50); // 20 FPS
+    // Sleep until the earliest pattern output change instead of polling; the
+    // one-shot timer has microsecond resolution, unlike the 10 ms tick
+    const esp_timer_create_args_t wake_timer_args = {
+        .callback = render_wake_callback,
+        .name = "render_wake",
+    };
+    esp_timer_handle_t wake_timer;
+    ESP_ERROR_CHECK(esp_timer_create(&wake_timer_args, &wake_timer));
+    int64_t scheduled_us = 0;   // When this pass was due, 0 if woken by a pattern change
     
     while (1) {
         uint32_t current_time = get_current_time_ms();
         
         // Update visual LED controller
         if (led_controller) {
-            led_controller_update(led_controller, current_time);
+            int64_t render_start = frame_telemetry_now();
+            bool frame_ready = led_controller_update(led_controller, current_time);
+            frame_telemetry_render_done(scheduled_us, render_start, frame_telemetry_now());
             
             // Notify display task that new frame is ready
-            if (physical_led_task_handle) {
+            if (frame_ready && physical_led_task_handle) {
+                frame_telemetry_notify_sent();
                 xTaskNotify(physical_led_task_handle, 1, eSetValueWithOverwrite);
             }
         }
         
-        vTaskDelayUntil(&last_wake_time, render_period);
+        uint32_t delay_ms = led_controller_frame_delay_ms(led_controller, get_current_time_ms(),
+                                                          LED_MIN_FRAME_PERIOD_MS);
+        esp_timer_stop(wake_timer); // Not running is fine
+        scheduled_us = 0;
+        if (delay_ms != LED_NEVER) {
+            scheduled_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+            ESP_ERROR_CHECK(esp_timer_start_once(wake_timer, (uint64_t)delay_ms * 1000));
+        }
+        
+        // Timer expiry or a pattern change, whichever comes first
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
     
+    esp_timer_delete(wake_timer);
     vTaskDelete(NULL);
 }
 
@@ -139,33 +702,307 @@ void led_controller_clear(LEDController* controller) {
 
 //-----------------------------------------Matrix operations--------------------------------------//
 
+static inline LedState_t layer_blend(LedState_t below, LedState_t above, BlendMode mode) {
+    return led_swar_store(led_swar_blend(led_swar_load(below), led_swar_load(above), mode));
+}
+
 void led_matrix_clear(LedEdgeConfigState_t* configState) {
     if (!configState) return;
+    framebuffer_palette_reset(configState);
+    if (configState->pixels) {
+        memset(configState->pixels, 0, configState->total_leds * sizeof(LedPixel_t));
+        return;
+    }
     for(int i=0; i< configState->num_edges; i++) {
-        memset(configState->data[i], 0, configState->num_led_per_edge[i] * sizeof(LedState_t));
+        memset(configState->data[i], 0, configState->num_led_per_edge[i] * sizeof(LedPixel_t));
+    }
+}
+
+// Start a frame: edges in `redraw` cleared, every other edge a copy of `previous`
+// (re-indexed into the frame's own palette in indexed mode)
+static void matrix_begin_frame(LedEdgeConfigState_t* frame, const LedEdgeConfigState_t* previous,
+                               uint32_t redraw) {
+    uint32_t all = frame->num_edges >= 32 ? UINT32_MAX : (1u << frame->num_edges) - 1;
+    if (!previous || (redraw & all) == all) {
+        led_matrix_clear(frame);
+        return;
+    }
+    
+    framebuffer_palette_reset(frame);
+#if FRAMEBUFFER_INDEXED
+    uint16_t remap[FRAMEBUFFER_PALETTE_SIZE] = {0};     // Entry in frame + 1, 0 until seen
+#endif
+    for (int e = 0; e < frame->num_edges; e++) {
+        uint32_t count = frame->num_led_per_edge[e];
+        if (redraw & (1u << e)) {
+            memset(frame->data[e], 0, count * sizeof(LedPixel_t));
+            continue;
+        }
+#if FRAMEBUFFER_INDEXED
+        for (uint32_t i = 0; i < count; i++) {
+            LedPixel_t pixel = previous->data[e][i];
+            if (remap[pixel] == 0) {
+                remap[pixel] = (uint16_t)(framebuffer_pixel(frame, framebuffer_color(previous, pixel)) + 1);
+            }
+            frame->data[e][i] = (LedPixel_t)(remap[pixel] - 1);
+        }
+#else
+        memcpy(frame->data[e], previous->data[e], count * sizeof(LedPixel_t));
+#endif
     }
 }
 
 void led_matrix_set_led(LedEdgeConfigState_t* configState, int edge, int index, LedState_t color) {
     if (!configState->data || edge >= configState->num_edges || index >= configState->num_led_per_edge[edge])return;
-    configState->data[edge][index] = color;
+    configState->data[edge][index] = framebuffer_pixel(configState, color);
 }
 
 LedState_t led_matrix_get_led(LedEdgeConfigState_t* configState, int edge, int index) {
     LedState_t black = {0, 0, 0, 0};
     if (!configState->data || edge >= configState->num_edges || index >= configState->num_led_per_edge[edge]) return black;
-    return configState->data[edge][index];
+    return framebuffer_color(configState, configState->data[edge][index]);
 }
 
 void led_matrix_blend(LedEdgeConfigState_t* dest,LedEdgeConfigState_t* src, BlendMode mode) {
     if (!dest || !src) return;
     
+#if FRAMEBUFFER_INDEXED
+    // Each frame has its own palette: blend the colors and re-index into dest's
+    for (int e = 0; e < dest->num_edges && e < src->num_edges; e++) {
+        for (uint32_t i = 0; i < dest->num_led_per_edge[e] && i < src->num_led_per_edge[e]; i++) {
+            LedState_t below = framebuffer_color(dest, dest->data[e][i]);
+            LedState_t above = framebuffer_color(src, src->data[e][i]);
+            dest->data[e][i] = framebuffer_pixel(dest, layer_blend(below, above, mode));
+        }
+    }
+#else
+    // Flat layout: one linear sweep over the whole frame
+    if (dest->pixels && src->pixels && dest->total_leds == src->total_leds) {
+        led_span_blend(dest->pixels, src->pixels, (int)dest->total_leds, mode);
+        return;
+    }
+    
     for (int e = 0; e < dest->num_edges; e++) {
-        for (int i = 0; i < dest->num_led_per_edge[e]; i++) {
-            LedState_t current = dest->data[e][i];
-            LedState_t new_color = src->data[e][i];
-            dest->data[e][i] = led_color_blend(current, new_color, mode);
+        led_span_blend(dest->data[e], src->data[e], (int)dest->num_led_per_edge[e], mode);
+    }
+#endif
+}
+
+// Write one LED of a pattern layer, combining it with what lower layers left in the frame
+static inline void pattern_put_led(LedEdgeConfigState_t* configState, Pattern* pattern, int index, LedState_t color) {
+    if (pattern->blend_mode != BLEND_REPLACE) {
+        LedState_t below = led_matrix_get_led(configState, pattern->edge, index);
+        color = layer_blend(below, color, pattern->blend_mode);
+    }
+    led_matrix_set_led(configState, pattern->edge, index, color);
+    if (pattern->coverage && index >= 0 && index < (int)configState->num_led_per_edge[pattern->edge]) {
+        pattern->coverage[index] = 1;
+    }
+}
+
+// Write one color over the pattern's whole range: bounds are checked once and the
+// span goes through a single fill/blend kernel
+static void pattern_fill_span(LedEdgeConfigState_t* configState, Pattern* pattern, LedState_t color) {
+    if (!configState->data || pattern->edge < 0 || pattern->edge >= configState->num_edges) return;
+    
+    int start = pattern->start_index < 0 ? 0 : pattern->start_index;
+    int end = pattern->end_index;
+    int edge_length = (int)configState->num_led_per_edge[pattern->edge];
+    if (end >= edge_length) end = edge_length - 1;
+    if (end < start) return;
+    
+    LedPixel_t* span = configState->data[pattern->edge] + start;
+    int count = end - start + 1;
+    if (pattern->coverage) memset(pattern->coverage + start, 1, (size_t)count);
+#if FRAMEBUFFER_INDEXED
+    // One palette entry for the whole span; blending only needs a new entry where
+    // the index underneath changes, which over a filled background is rarely
+    if (pattern->blend_mode == BLEND_REPLACE) {
+        memset(span, framebuffer_pixel(configState, color), (size_t)count);
+        return;
+    }
+    LedPixel_t below = span[0];
+    LedPixel_t blended = framebuffer_pixel(configState,
+        layer_blend(framebuffer_color(configState, below), color, pattern->blend_mode));
+    for (int i = 0; i < count; i++) {
+        if (span[i] != below) {
+            below = span[i];
+            blended = framebuffer_pixel(configState,
+                layer_blend(framebuffer_color(configState, below), color, pattern->blend_mode));
         }
+        span[i] = blended;
+    }
+#else
+    led_span_blend_color(span, count, color, pattern->blend_mode);
+#endif
+}
+
+// Blend src[0..count) over the pattern's edge starting at LED `start`
+static void pattern_blend_run(LedEdgeConfigState_t* configState, Pattern* pattern, int start,
+                              const LedState_t* src, int count) {
+    if (!configState->data || pattern->edge < 0 || pattern->edge >= configState->num_edges) return;
+    
+    int edge_length = (int)configState->num_led_per_edge[pattern->edge];
+    if (start < 0) {
+        src -= start;
+        count += start;
+        start = 0;
+    }
+    if (count > edge_length - start) count = edge_length - start;
+    if (count <= 0) return;
+    if (pattern->coverage) memset(pattern->coverage + start, 1, (size_t)count);
+    
+#if FRAMEBUFFER_INDEXED
+    for (int i = 0; i < count; i++) {
+        pattern_put_led(configState, pattern, start + i, src[i]);
+    }
+#else
+    led_span_blend(configState->data[pattern->edge] + start, src, count, pattern->blend_mode);
+#endif
+}
+
+// Blend src[0..count) over the pattern's range starting at start_index
+static inline void pattern_blend_span(LedEdgeConfigState_t* configState, Pattern* pattern,
+                                      const LedState_t* src, int count) {
+    pattern_blend_run(configState, pattern, pattern->start_index, src, count);
+}
+
+void led_pattern_fill(LedEdgeConfigState_t* frame, Pattern* pattern, LedState_t color) {
+    if (frame && pattern) pattern_fill_span(frame, pattern, color);
+}
+
+void led_pattern_blend_run(LedEdgeConfigState_t* frame, Pattern* pattern, int start,
+                           const LedState_t* colors, int count) {
+    if (frame && pattern && colors) pattern_blend_run(frame, pattern, start, colors, count);
+}
+
+void led_pattern_put_led(LedEdgeConfigState_t* frame, Pattern* pattern, int index, LedState_t color) {
+    if (!frame || !pattern || !frame->data || pattern->edge < 0 || pattern->edge >= frame->num_edges ||
+        index < 0 || index >= (int)frame->num_led_per_edge[pattern->edge]) {
+        return;
+    }
+    pattern_put_led(frame, pattern, index, color);
+}
+
+// Scratch span LED shown by LED i of a segment `count` LEDs long
+static inline int segment_source(const LedSegment* segment, int count, int i) {
+    switch (segment->direction) {
+        case SEGMENT_REVERSE: return count - 1 - i;
+        case SEGMENT_MIRROR:  return i < count - 1 - i ? i : count - 1 - i;
+        default:              return i;
+    }
+}
+
+// Blend the drawn LEDs of the scratch span [start, start + length) into one segment,
+// a run of consecutive drawn LEDs at a time. palette_map (indexed frames replacing
+// only) gives the frame's pixel for each scratch palette entry.
+static void segment_blend(LEDController* controller, LedEdgeConfigState_t* frame, Pattern* target,
+                          const LedSegment* segment, int start, int length, bool all_drawn,
+                          const LedPixel_t* palette_map) {
+    const LedPixel_t* pixels = controller->scratch_pixels + start;
+    const uint8_t* coverage = controller->scratch_coverage + start;
+    int count = segment->end - segment->start + 1;
+    
+#if FRAMEBUFFER_INDEXED
+    // Replacing needs no color from below: copy indices straight across
+    if (palette_map) {
+        if (segment->edge >= frame->num_edges || segment->start >= frame->num_led_per_edge[segment->edge]) return;
+        LedPixel_t* dest = frame->data[segment->edge] + segment->start;
+        int visible = (int)frame->num_led_per_edge[segment->edge] - segment->start;
+        if (visible > count) visible = count;
+        for (int i = 0; i < visible; i++) {
+            int source = segment_source(segment, count, i);
+            if (source < length && (all_drawn || coverage[source])) dest[i] = palette_map[pixels[source]];
+        }
+        return;
+    }
+#else
+    // Pixels are colors: a forward segment blends straight from the span
+    if (segment->direction == SEGMENT_FORWARD) {
+        if (count > length) count = length;
+        if (all_drawn) {
+            pattern_blend_run(frame, target, segment->start, pixels, count);
+            return;
+        }
+        for (int i = 0; i < count; ) {
+            if (!coverage[i]) {
+                i++;
+                continue;
+            }
+            int run_end = i + 1;
+            while (run_end < count && coverage[run_end]) run_end++;
+            pattern_blend_run(frame, target, segment->start + i, pixels + i, run_end - i);
+            i = run_end;
+        }
+        return;
+    }
+#endif
+    
+    const LedEdgeConfigState_t* scratch = &controller->scratch_frame;
+    LedState_t* line = controller->scratch_line;
+    int run_start = 0;
+    int run_length = 0;
+    for (int i = 0; i <= count; i++) {
+        int source = i < count ? segment_source(segment, count, i) : length;
+        if (source < length && (all_drawn || coverage[source])) {
+            if (run_length++ == 0) run_start = i;
+            line[i] = framebuffer_color(scratch, pixels[source]);
+            continue;
+        }
+        if (run_length > 0) {
+            pattern_blend_run(frame, target, segment->start + run_start, line + run_start, run_length);
+            run_length = 0;
+        }
+    }
+}
+
+// Draw a pattern once, on its own range of a one-edge scratch frame, then into each
+// of its segments. The scratch copy replaces, so coverage records exactly which LEDs
+// the pattern drew and the rest of each segment keeps what lower layers left.
+static void pattern_render_segments(LEDController* controller, LedEdgeConfigState_t* frame,
+                                    Pattern* pattern, uint32_t time) {
+    int start = pattern->start_index < 0 ? 0 : pattern->start_index;
+    int end = pattern->end_index < MAX_LEDS_PER_EDGE ? pattern->end_index : MAX_LEDS_PER_EDGE - 1;
+    if (end < start) return;
+    int length = end - start + 1;
+    
+    // Params stay shared with the pattern, so state it advances carries over
+    Pattern evaluation = *pattern;
+    evaluation.edge = 0;
+    evaluation.blend_mode = BLEND_REPLACE;
+    evaluation.coverage = controller->scratch_coverage;
+    evaluation.segment_count = 0;
+    
+    controller->scratch_length = (uint32_t)end + 1;
+    controller->scratch_frame.total_leds = controller->scratch_length;
+    framebuffer_palette_reset(&controller->scratch_frame);
+    memset(controller->scratch_coverage + start, 0, (size_t)length);
+    
+    // Black added or maxed in leaves a LED as it was, so with those modes LEDs the
+    // pattern skipped can go along as black and every segment is one run
+    bool black_is_clear = pattern->blend_mode == BLEND_ADD || pattern->blend_mode == BLEND_MAX;
+    if (black_is_clear) memset(controller->scratch_pixels + start, 0, (size_t)length * sizeof(LedPixel_t));
+    
+    pattern->pattern_class->render(&controller->scratch_frame, &evaluation, time);
+    bool all_drawn = black_is_clear || memchr(controller->scratch_coverage + start, 0, (size_t)length) == NULL;
+    
+    const LedPixel_t* palette_map = NULL;
+#if FRAMEBUFFER_INDEXED
+    // Each scratch color is looked up in the frame's palette once, not once per segment
+    LedPixel_t frame_pixels[FRAMEBUFFER_PALETTE_SIZE];
+    if (pattern->blend_mode == BLEND_REPLACE) {
+        for (uint32_t entry = 0; entry < controller->scratch_frame.palette_used; entry++) {
+            frame_pixels[entry] = framebuffer_pixel(frame, controller->scratch_palette[entry]);
+        }
+        palette_map = frame_pixels;
+    }
+#endif
+    
+    evaluation.blend_mode = pattern->blend_mode;
+    evaluation.coverage = NULL;
+    for (int s = 0; s < pattern->segment_count; s++) {
+        evaluation.edge = pattern->segments[s].edge;
+        segment_blend(controller, frame, &evaluation, &pattern->segments[s], start, length, all_drawn, palette_map);
     }
 }
 //-----------------------------------------Matrix operations--------------------------------------//
@@ -177,6 +1014,9 @@ LedState_t led_color_create(uint8_t r, uint8_t g, uint8_t b, uint8_t intensity)
 }
 
 LedState_t led_color_interpolate(LedState_t start, LedState_t end, float t) {
+#if LED_FIXED_POINT
+    return led_color_interpolate_q16(start, end, fraction_to_q16(t));
+#else
     if (t < 0.0f) t = 0.0f;
     if (t > 1.0f) t = 1.0f;
     
@@ -186,6 +1026,20 @@ LedState_t led_color_interpolate(LedState_t start, LedState_t end, float t) {
     result.b = (uint8_t)(start.b + t * (end.b - start.b));
     result.intensity = (uint8_t)(start.intensity + t * (end.intensity - start.intensity));
     return result;
+#endif
+}
+
+LedState_t led_color_interpolate_q16(LedState_t start, LedState_t end, uint32_t t_q16) {
+    if (t_q16 > LED_Q16_ONE) t_q16 = LED_Q16_ONE;
+    
+    // Arithmetic shift floors the signed delta, matching the float truncation
+    int32_t t = (int32_t)t_q16;
+    LedState_t result;
+    result.r = (uint8_t)(start.r + (((end.r - start.r) * t) >> 16));
+    result.g = (uint8_t)(start.g + (((end.g - start.g) * t) >> 16));
+    result.b = (uint8_t)(start.b + (((end.b - start.b) * t) >> 16));
+    result.intensity = (uint8_t)(start.intensity + (((end.intensity - start.intensity) * t) >> 16));
+    return result;
 }
 
 LedState_t led_color_blend(LedState_t c1, LedState_t c2, BlendMode mode) {
@@ -220,6 +1074,10 @@ LedState_t led_color_blend(LedState_t c1, LedState_t c2, BlendMode mode) {
             result.intensity = (c1.intensity * c2.intensity) / 255;
             break;
             
+        case BLEND_REPLACE:
+            result = c2;
+            break;
+            
         default:
             result = c1;
     }
@@ -228,6 +1086,9 @@ LedState_t led_color_blend(LedState_t c1, LedState_t c2, BlendMode mode) {
 }
 
 LedState_t led_color_scale(LedState_t color, float scale) {
+#if LED_FIXED_POINT
+    return led_color_scale_q16(color, fraction_to_q16(scale));
+#else
     if (scale < 0.0f) scale = 0.0f;
     if (scale > 1.0f) scale = 1.0f;
     
@@ -237,6 +1098,18 @@ LedState_t led_color_scale(LedState_t color, float scale) {
     result.b = (uint8_t)(color.b * scale);
     result.intensity = (uint8_t)(color.intensity * scale);
     return result;
+#endif
+}
+
+LedState_t led_color_scale_q16(LedState_t color, uint32_t scale_q16) {
+    if (scale_q16 > LED_Q16_ONE) scale_q16 = LED_Q16_ONE;
+    
+    LedState_t result;
+    result.r = (uint8_t)((color.r * scale_q16) >> 16);
+    result.g = (uint8_t)((color.g * scale_q16) >> 16);
+    result.b = (uint8_t)((color.b * scale_q16) >> 16);
+    result.intensity = (uint8_t)((color.intensity * scale_q16) >> 16);
+    return result;
 }
 //-----------------------------------------Color operations---------------------------------------//
 
@@ -244,9 +1117,7 @@ LedState_t led_color_scale(LedState_t color, float scale) {
 static void apply_static_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     StaticParams* params = (StaticParams*)pattern->params;
     
-    for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        led_matrix_set_led(configState, pattern->edge, i, params->color);
-    }
+    pattern_fill_span(configState, pattern, params->color);
 }
 
 static void apply_blink_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
@@ -256,58 +1127,67 @@ static void apply_blink_pattern(LedEdgeConfigState_t* configState, Pattern* patt
     uint32_t phase = time % cycle_time;
     
     if (phase < params->on_time) {
-        for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-            led_matrix_set_led(configState, pattern->edge, i, params->on_color);
-        }
+        pattern_fill_span(configState, pattern, params->on_color);
     }
 }
 
 static void apply_fade_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     FadeParams* params = (FadeParams*)pattern->params;
     
-    float t = (float)time / (float)pattern->duration;
-    if (t > 1.0f) t = 1.0f;
+#if LED_FIXED_POINT
+    uint32_t t_q16 = LED_Q16_ONE;
+    if (time < pattern->duration) {
+        t_q16 = (uint32_t)(((uint64_t)time << 16) / pattern->duration);
+    }
+    LedState_t current = led_color_interpolate_q16(params->start_color, params->end_color, t_q16);
+#else
+    float t = time < pattern->duration ? (float)time / (float)pattern->duration : 1.0f;
     
     LedState_t current = led_color_interpolate(params->start_color, params->end_color, t);
+#endif
     
-    for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        led_matrix_set_led(configState, pattern->edge, i, current);
-    }
+    pattern_fill_span(configState, pattern, current);
 }
 
 static void apply_pulse_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     PulseParams* params = (PulseParams*)pattern->params;
     
+    LedState_t pulsed = params->base_color;
+#if LED_FIXED_POINT
+    // Phase in 1/65536 of a period; top 8 bits index the sine table, low 8 interpolate
+    uint32_t phase = (uint32_t)(((uint64_t)(time % params->period) << 16) / params->period);
+    uint32_t idx = phase >> 8;
+    int32_t frac = (int32_t)(phase & 0xFF);
+    int32_t a = sine_wave_q16[idx];
+    int32_t b = sine_wave_q16[idx + 1];
+    uint32_t intensity_factor = (uint32_t)(a + (((b - a) * frac) >> 8));
+    pulsed.intensity = (uint8_t)((params->peak_intensity * intensity_factor) / 65535u);
+#else
     float phase = (float)(time % params->period) / (float)params->period;
     float intensity_factor = (sinf(2.0f * M_PI * phase) + 1.0f) / 2.0f;
     
-    LedState_t pulsed = params->base_color;
     pulsed.intensity = (uint8_t)(params->peak_intensity * intensity_factor);
+#endif
     
-    for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        led_matrix_set_led(configState, pattern->edge, i, pulsed);
-    }
+    pattern_fill_span(configState, pattern, pulsed);
 }
 
 static void apply_shift_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     ShiftParams* params = (ShiftParams*)pattern->params;
     
-    // Calculate the current shift offset based on time
-    int shift_amount = (time / params->period) % params->pattern_length;
-    
-    for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        int led_position = i - pattern->start_index;
-        int total_leds = pattern->end_index - pattern->start_index + 1;
-        
-        // Calculate which pattern element to use for this LED
-        int pattern_idx = (led_position + shift_amount + params->offset) % params->pattern_length;
-        
-        // If we have fewer LEDs than pattern length, wrap around
-        if (pattern_idx >= total_leds) {
-            pattern_idx = pattern_idx % total_leds;
-        }
-        
-        led_matrix_set_led(configState, pattern->edge, i, params->pattern[pattern_idx]);
+    // LED i of the range shows colors[(i + rotation) % pattern_length]: the run from
+    // `rotation` to the end, then whole runs from the start until the range is covered
+    int rotation = (int)(((time / params->period) % params->pattern_length + params->offset) % params->pattern_length);
+    const LedState_t* run = params->colors + rotation;
+    int run_length = params->pattern_length - rotation;
+    
+    for (int i = pattern->start_index; i <= pattern->end_index; ) {
+        int count = pattern->end_index - i + 1;
+        if (count > run_length) count = run_length;
+        pattern_blend_run(configState, pattern, i, run, count);
+        i += count;
+        run = params->colors;
+        run_length = params->pattern_length;
     }
 }
 
@@ -316,289 +1196,576 @@ static void apply_gradient_pattern(LedEdgeConfigState_t* configState, Pattern* p
     
     int led_count = pattern->end_index - pattern->start_index + 1;
     
+#if LED_FIXED_POINT
+    // t advances by 1/(led_count-1) per LED, accumulated in Q8.24
+    uint32_t step_q24 = led_count > 1 ? (1u << 24) / (uint32_t)(led_count - 1) : 0;
+    uint32_t t_q24 = 0;
+    for (int i = pattern->start_index; i <= pattern->end_index; i++, t_q24 += step_q24) {
+        LedState_t gradient_color = led_color_interpolate_q16(params->start_color, params->end_color, t_q24 >> 8);
+        pattern_put_led(configState, pattern, i, gradient_color);
+    }
+#else
     for (int i = pattern->start_index; i <= pattern->end_index; i++) {
         float t = (float)(i - pattern->start_index) / (float)(led_count - 1);
         LedState_t gradient_color = led_color_interpolate(params->start_color, params->end_color, t);
-        led_matrix_set_led(configState, pattern->edge, i, gradient_color);
+        pattern_put_led(configState, pattern, i, gradient_color);
     }
+#endif
 }
 
 static void apply_twinkle_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     TwinkleParams* params = (TwinkleParams*)pattern->params;
     
-    // Use time-based seeding for more predictable but still random behavior
-    srand(time / 100);  // Change seed every 100ms
+    // Same draws for the whole 100ms window, different for every pattern
+    LedRandom random;
+    led_random_seed(&random, params->seed + (time / 100) * 0x9E3779B9u);
     
     for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        float random_val = (float)rand() / RAND_MAX;
+        uint32_t draw = led_random_next(&random);
+#if LED_FIXED_POINT
+        uint32_t random_q16 = draw >> 16;
+        if (random_q16 < params->probability_q16) {
+            // Add some intensity variation for more natural twinkling (0.7 + 0.3 * random)
+            uint32_t intensity_variation = 45875u + ((19661u * random_q16) >> 16);
+            LedState_t twinkle_color = led_color_scale_q16(params->color, intensity_variation);
+            pattern_put_led(configState, pattern, i, twinkle_color);
+        }
+#else
+        float random_val = (float)(draw >> 8) / 16777216.0f;
         if (random_val < params->probability) {
             // Add some intensity variation for more natural twinkling
             float intensity_variation = 0.7f + (random_val * 0.3f);
             LedState_t twinkle_color = led_color_scale(params->color, intensity_variation);
-            led_matrix_set_led(configState, pattern->edge, i, twinkle_color);
+            pattern_put_led(configState, pattern, i, twinkle_color);
+        }
+#endif
+    }
+}
+
+static void twinkle_envelope_reset(TwinkleEnvelopeParams* params) {
+    led_random_seed(&params->random, params->seed);
+    params->step = 0;
+    memset(params->level, 0, (size_t)params->count);
+    memset(params->peak, 0, (size_t)params->count);
+}
+
+// Advance every LED's envelope by one step
+static void twinkle_envelope_step(TwinkleEnvelopeParams* params, int count) {
+    for (int i = 0; i < count; i++) {
+        uint8_t level = params->level[i];
+        uint8_t peak = params->peak[i];
+        
+        if (peak) {
+            // Rising
+            level = (peak - level > params->attack_rate) ? level + params->attack_rate : peak;
+            if (level == peak) peak = 0;
+        } else if (level) {
+            // Falling
+            level = level > params->decay_rate ? level - params->decay_rate : 0;
+        } else {
+            // Idle: maybe start, towards a peak of 0.7..1.0
+            uint32_t draw = led_random_next(&params->random);
+            if ((draw >> 16) < params->spawn_q16) {
+                peak = (uint8_t)(179u + (((draw & 0xFFFFu) * 76u) >> 16));
+            }
         }
+        
+        params->level[i] = level;
+        params->peak[i] = peak;
+    }
+}
+
+static void apply_twinkle_envelope_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
+    TwinkleEnvelopeParams* params = (TwinkleEnvelopeParams*)pattern->params;
+    int count = params->count;
+    if (count <= 0) return;
+    
+    // Envelopes only move forward in whole steps, so re-rendering the same time
+    // is idempotent and a restart replays from the seed
+    uint32_t target = time / TWINKLE_ENVELOPE_STEP_MS;
+    if (target < params->step) twinkle_envelope_reset(params);
+    if (target - params->step > TWINKLE_ENVELOPE_MAX_CATCH_UP) {
+        params->step = target - TWINKLE_ENVELOPE_MAX_CATCH_UP;
+    }
+    while (params->step < target) {
+        twinkle_envelope_step(params, count);
+        params->step++;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (params->level[i] == 0) continue;
+        LedState_t color = led_color_scale_q16(params->color, params->level[i] * 257u);
+        pattern_put_led(configState, pattern, pattern->start_index + i, color);
     }
 }
 
 static void apply_palette_cycle_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
     PaletteCycleParams* params = (PaletteCycleParams*)pattern->params;
     
-    float cycle_position = (float)(time % params->cycle_period) / (float)params->cycle_period;
+    // Positions are fractions of the cycle in Q0.32, so wrapping is free (fmodf);
+    // the top bits pick the LUT entry
+    uint32_t led_step = params->spread_q16 << 16;
+    uint32_t position = (uint32_t)(((uint64_t)(time % params->cycle_period) << 32) / params->cycle_period);
+    position += (uint32_t)(pattern->start_index + params->offset) * led_step;
     
-    for (int i = pattern->start_index; i <= pattern->end_index; i++) {
-        float led_position = cycle_position + (float)(i + params->offset) / 10.0f;
-        led_position = fmodf(led_position, 1.0f);
-        
-        // Interpolate between colors for smoother transitions
-        float color_pos = led_position * (params->palette.count - 1);
-        int color_idx = (int)color_pos;
-        float t = color_pos - color_idx;
-        
-        LedState_t color1 = params->palette.colors[color_idx % params->palette.count];
-        LedState_t color2 = params->palette.colors[(color_idx + 1) % params->palette.count];
-        
-        LedState_t final_color = led_color_interpolate(color1, color2, t);
-        led_matrix_set_led(configState, pattern->edge, i, final_color);
+    for (int i = pattern->start_index; i <= pattern->end_index; i++, position += led_step) {
+        pattern_put_led(configState, pattern, i, params->lut[position >> (32 - PALETTE_CYCLE_LUT_BITS)]);
     }
 }
 //-------------------------- Pattern application functions (internal)-----------------------------//
 
+// LEDs of the animation this pattern shows
+static uint32_t animation_window(const AnimationParams* params, const Pattern* pattern) {
+    uint32_t span = (uint32_t)(pattern->end_index - pattern->start_index + 1);
+    uint32_t available = params->animation->led_count - params->source_offset;
+    return span < available ? span : available;
+}
+
+// Bring params->frame up to `frame`: step forward through deltas when that is
+// shorter, otherwise restart from the keyframe at or before it
+static bool animation_seek(AnimationParams* params, uint32_t window, uint32_t frame) {
+    const LedAnimation* animation = params->animation;
+    uint32_t keyframe = frame - frame % animation->keyframe_interval;
+    uint32_t next = (params->decoded_frame >= (int32_t)keyframe && params->decoded_frame <= (int32_t)frame)
+        ? (uint32_t)params->decoded_frame + 1 : keyframe;
+    
+    for (; next <= frame; next++) {
+        const uint8_t* data;
+        size_t size;
+        bool is_keyframe;
+        if (!led_animation_frame(animation, next, &data, &size, &is_keyframe) ||
+            led_frame_decode(data, size, animation->led_count, is_keyframe,
+                             params->frame, params->source_offset, window) != (int)size) {
+            params->decoded_frame = -1;
+            return false;
+        }
+        params->decoded_frame = (int32_t)next;
+    }
+    return true;
+}
+
+static void apply_animation_pattern(LedEdgeConfigState_t* configState, Pattern* pattern, uint32_t time) {
+    AnimationParams* params = (AnimationParams*)pattern->params;
+    if (params->failed) return;
+    
+    uint32_t window = animation_window(params, pattern);
+    if (!animation_seek(params, window, animation_frame_at(params, time))) {
+        params->failed = true;
+        return;
+    }
+    pattern_blend_span(configState, pattern, params->frame, (int)window);
+}
+
 //-----------------------------------Pattern creation functions-----------------------------------//
-int led_pattern_static(LEDController* controller, int edge, int start_idx, int end_idx, LedState_t color) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_STATIC;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Static patterns run indefinitely
-    pattern->active = true;
+// Creation configs of the built-in types whose params are not filled in as given
+typedef struct {
+    LedState_t start_color;
+    LedState_t end_color;
+    uint32_t duration;
+} FadeConfig;
+
+typedef struct {
+    const LedState_t* colors;   // pattern_length colors to copy, or NULL for a comet
+    int pattern_length;
+    int offset;
+    uint32_t period;
+    LedState_t color;           // Comet head; comet_length 1 makes a dot
+    int comet_length;
+} ShiftConfig;
+
+typedef struct {
+    LedState_t color;
+    float spawn_probability;
+    uint32_t attack_ms;
+    uint32_t decay_ms;
+    uint32_t seed;
+} TwinkleEnvelopeConfig;
+
+typedef struct {
+    const ColorPalette* palette;
+    uint32_t cycle_period;
+    int offset;
+    uint32_t spread_q16;
+} PaletteCycleConfig;
+
+typedef struct {
+    const LedAnimation* animation;
+    uint32_t source_offset;
+    bool loop;
+} AnimationConfig;
+
+static bool blink_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const BlinkParams* blink = (const BlinkParams*)config;
+    if (blink->on_time + blink->off_time == 0) return false;
     
-    StaticParams* params = malloc(sizeof(StaticParams));
-    params->color = color;
-    pattern->params = params;
+    *(BlinkParams*)pattern->params = *blink;
+    pattern->duration = blink->repeat_count > 0 ? (blink->on_time + blink->off_time) * blink->repeat_count : 0;
+    return true;
+}
+
+static bool pulse_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const PulseParams* pulse = (const PulseParams*)config;
+    if (pulse->period == 0) return false;
     
-    return pattern_id;
+    *(PulseParams*)pattern->params = *pulse;
+    return true;
 }
 
-int led_pattern_blink(LEDController* controller, int edge, int start_idx, int end_idx, 
-                     LedState_t color, uint32_t on_time, uint32_t off_time, int repeats) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
+static bool fade_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const FadeConfig* fade = (const FadeConfig*)config;
+    FadeParams* params = (FadeParams*)pattern->params;
+    params->start_color = fade->start_color;
+    params->end_color = fade->end_color;
+    pattern->duration = fade->duration;
+    return true;
+}
+
+// Colors go straight into arena storage sized to the pattern
+static bool shift_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const ShiftConfig* shift = (const ShiftConfig*)config;
+    int length = shift->pattern_length;
+    if (length <= 0 || length > MAX_LEDS_PER_EDGE || shift->period == 0) return false;
     
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
+    ShiftParams* params = (ShiftParams*)pattern->params;
+    params->colors = led_pattern_storage(controller, pattern, (size_t)length * sizeof(LedState_t));
+    if (!params->colors) return false;
+    params->pattern_length = length;
+    params->period = shift->period;
+    params->offset = (shift->offset % length + length) % length;
+    
+    if (shift->colors) {
+        memcpy(params->colors, shift->colors, (size_t)length * sizeof(LedState_t));
+        return true;
+    }
     
-    pattern->type = PATTERN_BLINK;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = repeats > 0 ? (on_time + off_time) * repeats : 0;
-    pattern->active = true;
+    // Comet: bright head followed by fading tail, then black
+    for (int i = 0; i < length; i++) {
+        if (i >= shift->comet_length) {
+            params->colors[i] = led_color_create(0, 0, 0, 0);
+            continue;
+        }
+#if LED_FIXED_POINT
+        uint32_t intensity = ((uint32_t)(shift->comet_length - i) << 16) / (uint32_t)shift->comet_length;
+        params->colors[i] = led_color_scale_q16(shift->color, intensity);
+#else
+        float intensity = (float)(shift->comet_length - i) / (float)shift->comet_length;
+        params->colors[i] = led_color_scale(shift->color, intensity);
+#endif
+    }
+    return true;
+}
+
+static bool twinkle_init(LEDController* controller, Pattern* pattern, const void* config) {
+    TwinkleParams* params = (TwinkleParams*)pattern->params;
+    *params = *(const TwinkleParams*)config;
+    params->probability_q16 = probability_to_q16(params->probability);
+    return true;
+}
+
+// Level change per step for a ramp lasting ramp_ms; 0 ms is instant
+static uint8_t envelope_rate(uint32_t ramp_ms) {
+    if (ramp_ms <= TWINKLE_ENVELOPE_STEP_MS) return 255;
+    uint32_t rate = (255u * TWINKLE_ENVELOPE_STEP_MS + ramp_ms / 2) / ramp_ms;
+    return rate > 0 ? (uint8_t)rate : 1;
+}
+
+static bool twinkle_envelope_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const TwinkleEnvelopeConfig* twinkle = (const TwinkleEnvelopeConfig*)config;
+    int count = pattern->end_index - pattern->start_index + 1;
+    if (count < 0) count = 0;
+    if (count > MAX_LEDS_PER_EDGE) count = MAX_LEDS_PER_EDGE;
+    uint8_t* envelopes = led_pattern_storage(controller, pattern, 2 * (size_t)count);
+    if (!envelopes) return false;
+    
+    TwinkleEnvelopeParams* params = (TwinkleEnvelopeParams*)pattern->params;
+    params->count = count;
+    params->level = envelopes;
+    params->peak = envelopes + count;
+    params->color = twinkle->color;
+    params->spawn_q16 = probability_to_q16(twinkle->spawn_probability);
+    params->attack_rate = envelope_rate(twinkle->attack_ms);
+    params->decay_rate = envelope_rate(twinkle->decay_ms);
+    params->seed = twinkle->seed;
+    twinkle_envelope_reset(params);
+    return true;
+}
+
+// Color at each 1/PALETTE_CYCLE_LUT_SIZE of a cycle: the cycle runs from the first
+// palette color to the last, then wraps back to the first
+static void palette_cycle_build_lut(PaletteCycleParams* params, const ColorPalette* palette) {
+    uint32_t span = (uint32_t)(palette->count - 1);
+    
+    for (uint32_t k = 0; k < PALETTE_CYCLE_LUT_SIZE; k++) {
+#if LED_FIXED_POINT
+        uint32_t color_pos = (k << (16 - PALETTE_CYCLE_LUT_BITS)) * span;  // Q16.16 palette index
+        uint32_t color_idx = color_pos >> 16;
+        LedState_t color1 = palette->colors[color_idx % palette->count];
+        LedState_t color2 = palette->colors[(color_idx + 1) % palette->count];
+        params->lut[k] = led_color_interpolate_q16(color1, color2, color_pos & 0xFFFF);
+#else
+        float color_pos = (float)k / (float)PALETTE_CYCLE_LUT_SIZE * (float)span;
+        int color_idx = (int)color_pos;
+        LedState_t color1 = palette->colors[color_idx % palette->count];
+        LedState_t color2 = palette->colors[(color_idx + 1) % palette->count];
+        params->lut[k] = led_color_interpolate(color1, color2, color_pos - color_idx);
+#endif
+    }
+}
+
+static bool palette_cycle_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const PaletteCycleConfig* cycle = (const PaletteCycleConfig*)config;
+    if (cycle->palette->count < 1 || cycle->cycle_period == 0) return false;
     
-    BlinkParams* params = malloc(sizeof(BlinkParams));
-    params->on_color = color;
-    params->on_time = on_time;
-    params->off_time = off_time;
-    params->repeat_count = repeats;
-    pattern->params = params;
+    PaletteCycleParams* params = (PaletteCycleParams*)pattern->params;
+    params->lut = led_pattern_storage(controller, pattern, PALETTE_CYCLE_LUT_SIZE * sizeof(LedState_t));
+    if (!params->lut) return false;
+    palette_cycle_build_lut(params, cycle->palette);
+    params->cycle_period = cycle->cycle_period;
+    params->offset = cycle->offset;
+    params->spread_q16 = cycle->spread_q16;
+    return true;
+}
+
+static bool animation_init(LEDController* controller, Pattern* pattern, const void* config) {
+    const AnimationConfig* play = (const AnimationConfig*)config;
+    if (!play->animation || !play->animation->data || play->source_offset >= play->animation->led_count ||
+        pattern->start_index < 0 || pattern->end_index < pattern->start_index ||
+        pattern->end_index - pattern->start_index >= MAX_LEDS_PER_EDGE) {
+        return false;
+    }
     
-    return pattern_id;
+    AnimationParams* params = (AnimationParams*)pattern->params;
+    params->animation = play->animation;
+    params->source_offset = play->source_offset;
+    params->frame = led_pattern_storage(controller, pattern, animation_window(params, pattern) * sizeof(LedState_t));
+    if (!params->frame) return false;
+    params->loop = play->loop;
+    params->failed = false;
+    params->decoded_frame = -1;
+    return true;
 }
 
-int led_pattern_fade(LEDController* controller, int edge, int start_idx, int end_idx,
-                    LedState_t start_color, LedState_t end_color, uint32_t duration) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
+// Built-in types; init NULL takes the params struct itself as config
+static const LedPatternClass static_pattern_class = {
+    .name = "static", .params_size = sizeof(StaticParams),
+    .render = apply_static_pattern, .next_change = never_changes, .output_key = constant_output_key,
+};
+static const LedPatternClass blink_pattern_class = {
+    .name = "blink", .params_size = sizeof(BlinkParams), .init = blink_init,
+    .render = apply_blink_pattern, .next_change = blink_next_change, .output_key = blink_output_key,
+};
+static const LedPatternClass fade_pattern_class = {
+    .name = "fade", .params_size = sizeof(FadeParams), .init = fade_init,
+    .render = apply_fade_pattern, .next_change = fade_next_change, .output_key = fade_output_key,
+};
+static const LedPatternClass pulse_pattern_class = {
+    .name = "pulse", .params_size = sizeof(PulseParams), .init = pulse_init,
+    .render = apply_pulse_pattern,
+};
+static const LedPatternClass shift_pattern_class = {
+    .name = "shift", .params_size = sizeof(ShiftParams), .init = shift_init,
+    .render = apply_shift_pattern, .next_change = shift_next_change, .output_key = shift_output_key,
+};
+static const LedPatternClass gradient_pattern_class = {
+    .name = "gradient", .params_size = sizeof(GradientParams),
+    .render = apply_gradient_pattern, .next_change = never_changes, .output_key = constant_output_key,
+};
+static const LedPatternClass twinkle_pattern_class = {
+    .name = "twinkle", .params_size = sizeof(TwinkleParams), .init = twinkle_init,
+    .render = apply_twinkle_pattern, .next_change = twinkle_next_change, .output_key = twinkle_output_key,
+};
+static const LedPatternClass palette_cycle_pattern_class = {
+    .name = "palette_cycle", .params_size = sizeof(PaletteCycleParams), .init = palette_cycle_init,
+    .render = apply_palette_cycle_pattern,
+};
+static const LedPatternClass twinkle_envelope_pattern_class = {
+    .name = "twinkle_envelope", .params_size = sizeof(TwinkleEnvelopeParams), .init = twinkle_envelope_init,
+    .render = apply_twinkle_envelope_pattern, .next_change = twinkle_envelope_next_change,
+    .output_key = twinkle_envelope_output_key,
+};
+static const LedPatternClass animation_pattern_class = {
+    .name = "animation", .params_size = sizeof(AnimationParams), .init = animation_init,
+    .render = apply_animation_pattern, .next_change = animation_next_change, .output_key = animation_output_key,
+};
+
+_Static_assert(sizeof(PatternParams) <= LED_PATTERN_PARAMS_SIZE + sizeof(uint64_t),
+               "built-in params outgrew the slot");
+_Static_assert(PATTERN_CUSTOM_FIRST <= MAX_PATTERN_TYPES, "MAX_PATTERN_TYPES too small for the built-ins");
+
+// Indexed by type id; entries are only ever added
+static _Atomic(const LedPatternClass*) pattern_classes[MAX_PATTERN_TYPES] = {
+    [PATTERN_STATIC] = &static_pattern_class,
+    [PATTERN_BLINK] = &blink_pattern_class,
+    [PATTERN_FADE] = &fade_pattern_class,
+    [PATTERN_PULSE] = &pulse_pattern_class,
+    [PATTERN_SHIFT] = &shift_pattern_class,
+    [PATTERN_GRADIENT] = &gradient_pattern_class,
+    [PATTERN_TWINKLE] = &twinkle_pattern_class,
+    [PATTERN_PALETTE_CYCLE] = &palette_cycle_pattern_class,
+    [PATTERN_TWINKLE_ENVELOPE] = &twinkle_envelope_pattern_class,
+    [PATTERN_ANIMATION] = &animation_pattern_class,
+};
+static atomic_int pattern_type_count = PATTERN_CUSTOM_FIRST;
+
+int led_pattern_register(const LedPatternClass* pattern_class) {
+    if (!pattern_class || !pattern_class->render || pattern_class->params_size > LED_PATTERN_PARAMS_SIZE) {
+        return -1;
+    }
     
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
+    int type = atomic_fetch_add(&pattern_type_count, 1);
+    if (type >= MAX_PATTERN_TYPES) {
+        atomic_store(&pattern_type_count, MAX_PATTERN_TYPES);
+        return -1;
+    }
+    atomic_store_explicit(&pattern_classes[type], pattern_class, memory_order_release);
+    return type;
+}
+
+const LedPatternClass* led_pattern_class(int type) {
+    if (type < 0 || type >= MAX_PATTERN_TYPES) return NULL;
+    return atomic_load_explicit(&pattern_classes[type], memory_order_acquire);
+}
+
+int led_pattern_create(LEDController* controller, int type, int edge, int start_idx, int end_idx,
+                       const void* config) {
+    const LedPatternClass* pattern_class = led_pattern_class(type);
+    if (!pattern_class || (!config && pattern_class->params_size && !pattern_class->init)) {
+        batch_fail(controller);
+        return -1;
+    }
     
-    pattern->type = PATTERN_FADE;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = duration;
-    pattern->active = true;
+    int pattern_id;
+    Pattern* pattern = pattern_reserve(controller, type, pattern_class, edge, start_idx, end_idx, &pattern_id);
+    if (!pattern) return -1;
+    
+    memset(pattern->params, 0, pattern_class->params_size);
+    if (!pattern_class->init) {
+        if (pattern_class->params_size) memcpy(pattern->params, config, pattern_class->params_size);
+    } else if (!pattern_class->init(controller, pattern, config)) {
+        // Nothing to destroy yet; the slot takes any storage init claimed with it
+        batch_fail(controller);
+        pattern_release_slot(controller, pattern_id & PATTERN_HANDLE_SLOT_MASK);
+        return -1;
+    }
     
-    FadeParams* params = malloc(sizeof(FadeParams));
-    params->start_color = start_color;
-    params->end_color = end_color;
-    pattern->params = params;
+    return pattern_publish(controller, pattern_id);
+}
+
+void* led_pattern_storage(LEDController* controller, Pattern* pattern, size_t size) {
+    if (!controller || !pattern || pattern->storage) return NULL;
     
-    return pattern_id;
+    pattern->storage = pattern_memory_alloc(controller, size);
+    pattern->storage_size = pattern->storage ? size : 0;
+    if (!pattern->storage) {
+        printf("Error: Failed to allocate %u bytes of pattern storage\n", (unsigned)size);
+    }
+    return pattern->storage;
+}
+
+int led_pattern_static(LEDController* controller, int edge, int start_idx, int end_idx, LedState_t color) {
+    StaticParams config = { .color = color };
+    return led_pattern_create(controller, PATTERN_STATIC, edge, start_idx, end_idx, &config);
+}
+
+int led_pattern_blink(LEDController* controller, int edge, int start_idx, int end_idx, 
+                     LedState_t color, uint32_t on_time, uint32_t off_time, int repeats) {
+    BlinkParams config = { .on_color = color, .on_time = on_time, .off_time = off_time, .repeat_count = repeats };
+    return led_pattern_create(controller, PATTERN_BLINK, edge, start_idx, end_idx, &config);
+}
+
+int led_pattern_fade(LEDController* controller, int edge, int start_idx, int end_idx,
+                    LedState_t start_color, LedState_t end_color, uint32_t duration) {
+    FadeConfig config = { .start_color = start_color, .end_color = end_color, .duration = duration };
+    return led_pattern_create(controller, PATTERN_FADE, edge, start_idx, end_idx, &config);
 }
 
 int led_pattern_pulse(LEDController* controller, int edge, int start_idx, int end_idx,
                      LedState_t base_color, uint8_t peak_intensity, uint32_t period) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_PULSE;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Continuous
-    pattern->active = true;
-    
-    PulseParams* params = malloc(sizeof(PulseParams));
-    params->base_color = base_color;
-    params->peak_intensity = peak_intensity;
-    params->period = period;
-    pattern->params = params;
-    
-    return pattern_id;
+    PulseParams config = { .base_color = base_color, .peak_intensity = peak_intensity, .period = period };
+    return led_pattern_create(controller, PATTERN_PULSE, edge, start_idx, end_idx, &config);
 }
 
 // Improved shift pattern creation function
 int led_pattern_shift(LEDController* controller, int edge, int start_idx, int end_idx,
                      LedState_t* pattern_colors, int pattern_length, uint32_t period, int offset) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    if (!pattern_colors || pattern_length <= 0 || pattern_length > MAX_LEDS_PER_EDGE) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_SHIFT;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Continuous shift pattern
-    pattern->active = true;
-    
-    ShiftParams* params = malloc(sizeof(ShiftParams));
-    params->pattern_length = pattern_length;
-    params->period = period;
-    params->offset = offset;
-    
-    // Copy pattern colors
-    for (int i = 0; i < pattern_length; i++) {
-        params->pattern[i] = pattern_colors[i];
+    if (!pattern_colors) {
+        batch_fail(controller);
+        return -1;
     }
     
-    pattern->params = params;
-    
-    return pattern_id;
+    ShiftConfig config = { .colors = pattern_colors, .pattern_length = pattern_length,
+                           .offset = offset, .period = period };
+    return led_pattern_create(controller, PATTERN_SHIFT, edge, start_idx, end_idx, &config);
 }
 
 // Convenience function to create a simple comet-like shift pattern
 int led_pattern_shift_comet(LEDController* controller, int edge, int start_idx, int end_idx,
                            LedState_t color, int comet_length, uint32_t period) {
-    if (comet_length <= 0 || comet_length > MAX_LEDS_PER_EDGE) return -1;
-    
-    LedState_t pattern_colors[MAX_LEDS_PER_EDGE];
-    LedState_t black = led_color_create(0, 0, 0, 0);
-    
-    // Create comet pattern: bright head followed by fading tail
-    for (int i = 0; i < comet_length; i++) {
-        float intensity = (float)(comet_length - i) / (float)comet_length;
-        pattern_colors[i] = led_color_scale(color, intensity);
-    }
-    
-    // Fill the rest with black
-    for (int i = comet_length; i < MAX_LEDS_PER_EDGE; i++) {
-        pattern_colors[i] = black;
+    if (comet_length <= 0 || comet_length > MAX_LEDS_PER_EDGE) {
+        batch_fail(controller);
+        return -1;
     }
     
+    // Comet and as much black behind it, cut to the range
     int total_leds = end_idx - start_idx + 1;
-    int pattern_length = (total_leds > comet_length * 2) ? comet_length * 2 : total_leds;
-    
-    return led_pattern_shift(controller, edge, start_idx, end_idx, pattern_colors, pattern_length, period, 0);
+    ShiftConfig config = { .pattern_length = (total_leds > comet_length * 2) ? comet_length * 2 : total_leds,
+                           .period = period, .color = color, .comet_length = comet_length };
+    return led_pattern_create(controller, PATTERN_SHIFT, edge, start_idx, end_idx, &config);
 }
 
 // Convenience function to create a simple moving dot pattern
 int led_pattern_shift_dot(LEDController* controller, int edge, int start_idx, int end_idx,
                          LedState_t color, int spacing, uint32_t period) {
-    if (spacing <= 0 || spacing > MAX_LEDS_PER_EDGE) return -1;
-    
-    LedState_t pattern_colors[MAX_LEDS_PER_EDGE];
-    LedState_t black = led_color_create(0, 0, 0, 0);
-    
-    // Create dot pattern: one bright dot followed by spacing black LEDs
-    pattern_colors[0] = color;
-    for (int i = 1; i < spacing; i++) {
-        pattern_colors[i] = black;
-    }
-    
-    return led_pattern_shift(controller, edge, start_idx, end_idx, pattern_colors, spacing, period, 0);
+    // One bright dot followed by spacing - 1 black LEDs: a comet without a tail
+    ShiftConfig config = { .pattern_length = spacing, .period = period, .color = color, .comet_length = 1 };
+    return led_pattern_create(controller, PATTERN_SHIFT, edge, start_idx, end_idx, &config);
 }
 
 int led_pattern_gradient(LEDController* controller, int edge, int start_idx, int end_idx,
                         LedState_t start_color, LedState_t end_color) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_GRADIENT;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Static gradient pattern runs indefinitely
-    pattern->active = true;
-    
-    GradientParams* params = malloc(sizeof(GradientParams));
-    params->start_color = start_color;
-    params->end_color = end_color;
-    pattern->params = params;
-    
-    return pattern_id;
+    GradientParams config = { .start_color = start_color, .end_color = end_color };
+    return led_pattern_create(controller, PATTERN_GRADIENT, edge, start_idx, end_idx, &config);
 }
 
 int led_pattern_twinkle(LEDController* controller, int edge, int start_idx, int end_idx,
                        LedState_t color, float probability) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_TWINKLE;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Continuous twinkle pattern
-    pattern->active = true;
-    
-    TwinkleParams* params = malloc(sizeof(TwinkleParams));
-    params->color = color;
-    params->probability = probability;
-    pattern->params = params;
-    
-    return pattern_id;
+    if (!controller) return -1;
+    uint32_t seed = random_mix(atomic_fetch_add(&controller->seed_sequence, 1) + 1);
+    return led_pattern_twinkle_seeded(controller, edge, start_idx, end_idx, color, probability, seed);
+}
+
+int led_pattern_twinkle_seeded(LEDController* controller, int edge, int start_idx, int end_idx,
+                              LedState_t color, float probability, uint32_t seed) {
+    TwinkleParams config = { .color = color, .probability = probability, .seed = seed };
+    return led_pattern_create(controller, PATTERN_TWINKLE, edge, start_idx, end_idx, &config);
+}
+
+int led_pattern_twinkle_envelope(LEDController* controller, int edge, int start_idx, int end_idx,
+                                LedState_t color, float spawn_probability,
+                                uint32_t attack_ms, uint32_t decay_ms, uint32_t seed) {
+    TwinkleEnvelopeConfig config = { .color = color, .spawn_probability = spawn_probability,
+                                     .attack_ms = attack_ms, .decay_ms = decay_ms, .seed = seed };
+    return led_pattern_create(controller, PATTERN_TWINKLE_ENVELOPE, edge, start_idx, end_idx, &config);
 }
 
 int led_pattern_palette_cycle(LEDController* controller, int edge, int start_idx, int end_idx,
                              ColorPalette palette, uint32_t cycle_period, int offset) {
-    if (!controller || controller->pattern_count >= MAX_PATTERNS) return -1;
-    
-    int pattern_id = controller->pattern_count++;
-    Pattern* pattern = &controller->patterns[pattern_id];
-    
-    pattern->type = PATTERN_PALETTE_CYCLE;
-    pattern->edge = edge;
-    pattern->start_index = start_idx;
-    pattern->end_index = end_idx;
-    pattern->start_time = controller->current_time;
-    pattern->duration = 0; // Continuous palette cycle
-    pattern->active = true;
-    
-    PaletteCycleParams* params = malloc(sizeof(PaletteCycleParams));
-    params->palette = palette;
-    params->cycle_period = cycle_period;
-    params->offset = offset;
-    pattern->params = params;
-    
-    return pattern_id;
+    return led_pattern_palette_cycle_spread(controller, edge, start_idx, end_idx, palette, cycle_period,
+                                            offset, PALETTE_CYCLE_DEFAULT_SPREAD_Q16);
+}
+
+int led_pattern_palette_cycle_spread(LEDController* controller, int edge, int start_idx, int end_idx,
+                                     ColorPalette palette, uint32_t cycle_period, int offset,
+                                     uint32_t spread_q16) {
+    PaletteCycleConfig config = { .palette = &palette, .cycle_period = cycle_period,
+                                  .offset = offset, .spread_q16 = spread_q16 };
+    return led_pattern_create(controller, PATTERN_PALETTE_CYCLE, edge, start_idx, end_idx, &config);
+}
+
+int led_pattern_animation(LEDController* controller, int edge, int start_idx, int end_idx,
+                          const LedAnimation* animation, uint32_t source_offset, bool loop) {
+    AnimationConfig config = { .animation = animation, .source_offset = source_offset, .loop = loop };
+    return led_pattern_create(controller, PATTERN_ANIMATION, edge, start_idx, end_idx, &config);
 }
 //-----------------------------------Pattern creation functions-----------------------------------//
 
@@ -655,28 +1822,81 @@ uint32_t led_random_range(uint32_t min, uint32_t max) {
     return min + (rand() % (max - min + 1));
 }
 
+void led_random_seed(LedRandom* random, uint32_t seed) {
+    uint32_t state = random_mix(seed);
+    random->state = state ? state : 0x9E3779B9u;
+}
+
+uint32_t led_random_next(LedRandom* random) {
+    uint32_t x = random->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random->state = x;
+    return x;
+}
+
 //--------------------------------------- Pattern control functions------------------------------//
+// Each of these only queues the change; stale or unknown handles are ignored when it is applied
 void led_pattern_remove(LEDController* controller, int pattern_id) {
-    if (!controller || pattern_id >= controller->pattern_count) return;
-    
-    Pattern* pattern = &controller->patterns[pattern_id];
-    if (pattern->params) {
-        free(pattern->params);
-        pattern->params = NULL;
-    }
-    pattern->active = false;
+    command_submit(controller, PATTERN_COMMAND_REMOVE, pattern_id, 0);
 }
 
 void led_pattern_stop(LEDController* controller, int pattern_id) {
-    if (!controller || pattern_id >= controller->pattern_count) return;
-    controller->patterns[pattern_id].active = false;
+    command_submit(controller, PATTERN_COMMAND_STOP, pattern_id, 0);
 }
 
 void led_pattern_start(LEDController* controller, int pattern_id, uint32_t start_time) {
-    if (!controller || pattern_id >= controller->pattern_count) return;
+    command_submit(controller, PATTERN_COMMAND_START, pattern_id, (int32_t)start_time);
+}
+
+void led_pattern_set_blend(LEDController* controller, int pattern_id, BlendMode mode) {
+    command_submit(controller, PATTERN_COMMAND_SET_BLEND, pattern_id, (int32_t)mode);
+}
+
+void led_pattern_set_z_order(LEDController* controller, int pattern_id, int z_order) {
+    command_submit(controller, PATTERN_COMMAND_SET_Z_ORDER, pattern_id, z_order);
+}
+
+void led_pattern_set_segments(LEDController* controller, int pattern_id, const LedSegment* segments, int count) {
+    if (!controller) return;
+    if (count < 0 || count > LED_PATTERN_MAX_SEGMENTS || (count > 0 && !segments)) {
+        batch_fail(controller);
+        return;
+    }
+    for (int s = 0; s < count; s++) {
+        if (segments[s].edge >= MAX_EDGES || segments[s].direction > SEGMENT_MIRROR ||
+            segments[s].start > segments[s].end || segments[s].end >= MAX_LEDS_PER_EDGE) {
+            batch_fail(controller);
+            return;
+        }
+    }
     
-    Pattern* pattern = &controller->patterns[pattern_id];
-    pattern->start_time = start_time;
-    pattern->active = true;
+    // The render task takes its own copy; ours lives in the arena (or heap) until then
+    size_t size = (size_t)count * sizeof(LedSegment);
+    LedSegment* copy = NULL;
+    if (count > 0) {
+        copy = pattern_memory_alloc(controller, size);
+        if (!copy) {
+            printf("Error: Failed to allocate %d segments\n", count);
+            batch_fail(controller);
+            return;
+        }
+        memcpy(copy, segments, size);
+    }
+    if (!command_submit_data(controller, PATTERN_COMMAND_SET_SEGMENTS, pattern_id, count, copy)) {
+        pattern_memory_free(controller, copy, size);
+    }
+}
+
+BaseType_t led_timeline_play(LEDController* controller, const LedTimelineEvent* events, int count) {
+    if (!led_timeline_validate(events, count)) {
+        batch_fail(controller);
+        return pdFAIL;
+    }
+    return command_submit_data(controller, PATTERN_COMMAND_TIMELINE_PLAY, -1, count, events) ? pdPASS : pdFAIL;
+}
+
+void led_timeline_stop(LEDController* controller) {
+    command_submit(controller, PATTERN_COMMAND_TIMELINE_STOP, -1, 0);
 }
-//--------------------------------------- Pattern control functions------------------------------//
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include <string.h>
 #include <math.h>
 #include "framebuffer.h"
+#include "led_command_queue.h"
+#include "led_arena.h"
+#include "led_animation.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,8 +20,26 @@ extern "C" {
 #define MAX_LEDS_PER_EDGE 256
 #define MAX_PATTERNS 16
 #define MAX_PALETTE_COLORS 32
+#define MAX_PATTERN_TYPES 32    // Built-in and registered
 #define M_PI 3.14159265358979323846
 
+// Integer Q16.16 color and pattern math instead of per-LED float math (0 = float)
+#ifndef LED_FIXED_POINT
+#define LED_FIXED_POINT 1
+#endif
+#define LED_Q16_ONE 65536u
+
+// Skip rendering and display refresh when no edge's output changed since the last
+// frame. Either way only changed edges are redrawn and repacked; the rest is copied.
+#ifndef LED_SKIP_UNCHANGED_FRAMES
+#define LED_SKIP_UNCHANGED_FRAMES 1
+#endif
+
+// Segments one pattern can be shown on, see led_pattern_set_segments
+#ifndef LED_PATTERN_MAX_SEGMENTS
+#define LED_PATTERN_MAX_SEGMENTS 8
+#endif
+
 // Forward declarations
 typedef struct LEDController LEDController;
 typedef struct Pattern Pattern;
@@ -33,24 +54,47 @@ typedef enum {
     PATTERN_SHIFT,
     PATTERN_GRADIENT,
     PATTERN_TWINKLE,
-    PATTERN_PALETTE_CYCLE
+    PATTERN_PALETTE_CYCLE,
+    PATTERN_TWINKLE_ENVELOPE,
+    PATTERN_ANIMATION,
+    PATTERN_CUSTOM_FIRST        // Types from led_pattern_register start here
 } PatternType;
 
 typedef enum {
     BLEND_ADD,
     BLEND_MAX,
     BLEND_AVERAGE,
-    BLEND_MULTIPLY
+    BLEND_MULTIPLY,
+    BLEND_REPLACE       // Overwrite whatever lower layers left behind
 } BlendMode;
 
+typedef enum {
+    SEGMENT_FORWARD,    // Segment LED start + i shows span LED i
+    SEGMENT_REVERSE,    // Segment LED end - i shows span LED i
+    SEGMENT_MIRROR      // Forward from start and from end, meeting in the middle
+} SegmentDirection;
+
 // Structure definitions
 
 
+// A range of LEDs a pattern is copied onto
+typedef struct {
+    uint8_t edge;
+    uint8_t direction;      // SegmentDirection
+    uint16_t start;         // First and last LED on the edge
+    uint16_t end;
+} LedSegment;
+
 struct ColorPalette {
     LedState_t colors[MAX_PALETTE_COLORS];
     int count;
 };
 
+// Small per-pattern xorshift32 generator; never touches the libc rand() state
+typedef struct {
+    uint32_t state;     // Never 0
+} LedRandom;
+
 // Pattern parameter structures
 typedef struct {
     LedState_t color;
@@ -74,10 +118,12 @@ typedef struct {
     uint32_t period;
 } PulseParams;
 
+// Arrays below point into pattern storage (see led_pattern_storage), sized for
+// the pattern at creation, and are released with its slot
 typedef struct {
-    LedState_t pattern[MAX_LEDS_PER_EDGE];
+    LedState_t* colors;         // pattern_length colors, rotated one step per period
     int pattern_length;
-    int offset;
+    int offset;                 // 0..pattern_length-1
     uint32_t period;
 } ShiftParams;
 
@@ -89,37 +135,240 @@ typedef struct {
 typedef struct {
     LedState_t color;
     float probability;
+    uint32_t probability_q16;   // probability as a Q16.16 fraction
+    uint32_t seed;              // Output is a pure function of seed and time / 100 ms
 } TwinkleParams;
 
+// Stateful twinkle: LEDs light up at random, ramp to a random peak over attack_ms
+// and fade out over decay_ms. The envelopes advance in fixed steps drawn from the
+// pattern's own generator, so output depends only on the seed and elapsed time.
+#define TWINKLE_ENVELOPE_STEP_MS 20
+#define TWINKLE_ENVELOPE_MAX_CATCH_UP 512   // Steps replayed after a long sleep
+
+typedef struct {
+    LedState_t color;
+    uint32_t spawn_q16;         // Chance per step that an idle LED starts, Q16.16
+    uint8_t attack_rate;        // Level gained per step
+    uint8_t decay_rate;         // Level lost per step
+    uint32_t seed;
+    LedRandom random;
+    uint32_t step;              // Steps applied to level/peak so far
+    int count;                  // LEDs with an envelope
+    uint8_t* level;             // Current brightness per LED, 0 = idle
+    uint8_t* peak;              // Target while rising, 0 once decaying
+} TwinkleEnvelopeParams;
+
+// Palette cycles expand their palette once, at creation, into a table of
+// 1 << PALETTE_CYCLE_LUT_BITS interpolated colors covering one cycle
+#define PALETTE_CYCLE_LUT_BITS 8
+#define PALETTE_CYCLE_LUT_SIZE (1 << PALETTE_CYCLE_LUT_BITS)
+// Cycle fraction between neighbouring LEDs used by led_pattern_palette_cycle:
+// a tenth, in Q16.16, rounded so every tenth LED lands back on the first color
+#define PALETTE_CYCLE_DEFAULT_SPREAD_Q16 ((LED_Q16_ONE + 5) / 10)
+
 typedef struct {
-    ColorPalette palette;
+    LedState_t* lut;            // PALETTE_CYCLE_LUT_SIZE colors
     uint32_t cycle_period;
     int offset;
+    uint32_t spread_q16;        // Cycle fraction between neighbouring LEDs, Q16.16
 } PaletteCycleParams;
 
+// Plays LEDs [source_offset, source_offset + span) of a precomputed animation,
+// decoding one delta per frame into `frame` (seeks restart at the nearest keyframe)
+typedef struct {
+    const LedAnimation* animation;
+    uint32_t source_offset;
+    bool loop;                  // Otherwise hold the last frame
+    bool failed;                // Animation data turned out corrupt; renders nothing
+    int32_t decoded_frame;      // Frame held in `frame`, -1 if none
+    LedState_t* frame;          // One color per LED of the window
+} AnimationParams;
+
+// Bytes of parameters a pattern type can keep in the slot; anything bigger
+// belongs in led_pattern_storage
+#ifndef LED_PATTERN_PARAMS_SIZE
+#define LED_PATTERN_PARAMS_SIZE 64
+#endif
+
+// Bytes of per-LED pattern data kept inside the controller. The default holds a
+// short run for every slot (a comet tail, a segment list); runs that do not fit,
+// such as whole-edge shift colors, come from the heap when the pattern is created.
+#ifndef LED_PATTERN_ARENA_SIZE
+#define LED_PATTERN_ARENA_SIZE 4096
+#endif
+#define LED_PATTERN_ARENA_GROUPS LED_ARENA_GROUPS_FOR(LED_PATTERN_ARENA_SIZE)
+
+// Storage for any pattern's parameters, kept inside its slot so creating and
+// removing patterns needs no allocation; per-LED arrays are pattern storage
+typedef union {
+    StaticParams static_params;
+    BlinkParams blink;
+    FadeParams fade;
+    PulseParams pulse;
+    ShiftParams shift;
+    GradientParams gradient;
+    TwinkleParams twinkle;
+    PaletteCycleParams palette_cycle;
+    TwinkleEnvelopeParams twinkle_envelope;
+    AnimationParams animation;
+    uint8_t custom[LED_PATTERN_PARAMS_SIZE];
+    uint64_t align;
+} PatternParams;
+
+// What a pattern type does, as a table of functions the engine calls directly.
+// Built-in types are registered the same way; an application can add its own
+// with led_pattern_register and create them with led_pattern_create. They get
+// the same scheduling, dirty tracking, blending and z-order as built-ins.
+typedef struct {
+    const char* name;
+    size_t params_size;         // Bytes at pattern->params, at most LED_PATTERN_PARAMS_SIZE
+    // Fill in pattern->params (zeroed) from the config handed to led_pattern_create.
+    // Runs in the creating task before the render task sees the pattern; per-LED
+    // state can be claimed with led_pattern_storage. Return false to drop the
+    // pattern. NULL copies params_size bytes of config.
+    bool (*init)(LEDController* controller, Pattern* pattern, const void* config);
+    // Draw the pattern's range at pattern time `time` into frame with
+    // led_pattern_fill, led_pattern_blend_run or led_pattern_put_led, which apply
+    // its blend mode (render task). A pattern with segments is drawn through a
+    // copy of its Pattern onto a scratch span, so keep state behind params.
+    void (*render)(LedEdgeConfigState_t* frame, Pattern* pattern, uint32_t time);
+    // ms after `time` until the output next changes: 0 = continuously, LED_NEVER =
+    // only on creation or restart. NULL is continuously.
+    uint32_t (*next_change)(const Pattern* pattern, uint32_t time);
+    // Value that changes exactly when the output changes, so unchanged edges skip
+    // the frame. NULL treats every frame as a change.
+    uint32_t (*output_key)(const Pattern* pattern, uint32_t time);
+    // Release what init acquired besides led_pattern_storage, which goes with
+    // the slot. Runs in the render task after removal, in the creating task
+    // when a batch is dropped, or in led_controller_destroy for patterns still
+    // live or queued. May be NULL.
+    void (*destroy)(Pattern* pattern);
+} LedPatternClass;
+
+// Timeline: a script of scene changes evaluated by the render task against its
+// own frame clock, so each change lands on its intended time with no extra task.
+// Timeline time starts at 0 on the frame that picks up led_timeline_play.
+#define LED_TIMELINE_MAX_EVENTS 128
+#define LED_TIMELINE_ALL_EDGES 0xFF
+
+typedef enum {
+    TIMELINE_SET,       // Replace the pattern the timeline runs on `edge`
+    TIMELINE_CLEAR,     // Remove it (LED_TIMELINE_ALL_EDGES: from every edge)
+    TIMELINE_JUMP,      // Continue at event `target`; its at_ms becomes this event's time
+    TIMELINE_REPEAT,    // Like TIMELINE_JUMP `arg` times, then carry on with the next event
+    TIMELINE_END        // Stop; patterns the timeline set keep running
+} LedTimelineOp;
+
+// TIMELINE_SET parameters by pattern:
+//   PATTERN_STATIC            color
+//   PATTERN_BLINK             color, period_ms = on + off, arg = repeats (0 = forever)
+//   PATTERN_FADE              color to color2 over period_ms
+//   PATTERN_PULSE             color, arg = peak intensity, period_ms
+//   PATTERN_SHIFT             comet of color, arg = comet length, period_ms per step
+//   PATTERN_GRADIENT          color to color2
+//   PATTERN_TWINKLE           color, arg = probability in 1/1000
+//   PATTERN_PALETTE_CYCLE     rainbow of arg colors (0 = 12), period_ms per cycle
+//   PATTERN_TWINKLE_ENVELOPE  color, arg = spawn probability in 1/1000, period_ms = attack = decay
+typedef struct {
+    uint32_t at_ms;         // Timeline time the event fires at; never decreases except across jumps
+    uint8_t op;             // LedTimelineOp
+    uint8_t edge;
+    uint8_t pattern;        // PatternType
+    uint8_t reserved;
+    uint16_t start_index;
+    uint16_t count;         // LEDs from start_index, 0 = to the end of the edge
+    LedState_t color;
+    LedState_t color2;
+    uint32_t period_ms;
+    uint16_t arg;
+    uint16_t target;        // Event index for TIMELINE_JUMP / TIMELINE_REPEAT
+} LedTimelineEvent;
+
+typedef struct {
+    const LedTimelineEvent* events;     // NULL when no timeline is playing
+    uint16_t count;
+    uint16_t next;                      // Next event to fire
+    uint32_t base_time;                 // Controller time at timeline time 0
+    int edge_pattern[MAX_EDGES];        // Pattern the timeline set on each edge, -1 if none
+    uint16_t repeat_left[LED_TIMELINE_MAX_EVENTS];  // Per REPEAT event: jumps left + 1, 0 = not armed
+} LedTimeline;
+
+// Pattern handles are (generation << PATTERN_HANDLE_SLOT_BITS) | slot, so a handle
+// kept after its pattern was removed never reaches the slot's next occupant
+#define PATTERN_HANDLE_SLOT_BITS 8
+#define PATTERN_HANDLE_SLOT_MASK ((1 << PATTERN_HANDLE_SLOT_BITS) - 1)
+#define PATTERN_GENERATION_MASK 0x7FFF
+
 struct Pattern {
     PatternType type;
+    const LedPatternClass* pattern_class;   // Functions of `type`
     int edge;
     int start_index;
     int end_index;
     uint32_t start_time;
     uint32_t duration;
     bool active;
-    void* params;
+    BlendMode blend_mode;   // How this layer combines with the layers below it
+    int z_order;            // Lower values are composited first
+    uint32_t output_key;    // Changes whenever the pattern's output changes
+    bool output_valid;      // output_key has been computed since creation/restart
+    bool in_use;            // Slot holds a live pattern (render task only)
+    uint16_t generation;    // Bumped every time the slot is released
+    void* params;           // Points at param_storage
+    void* storage;          // Arena run the params point into, NULL if none
+    size_t storage_size;
+    uint8_t* coverage;      // Scratch evaluation only: set for every LED drawn, else NULL
+    int segment_count;      // 0: drawn on its own edge and range (render task only)
+    LedSegment segments[LED_PATTERN_MAX_SEGMENTS];
+    PatternParams param_storage;
 };
 
+// Pattern creation and control functions may be called from any task. They only
+// reserve a free slot and queue a command; the render task applies queued
+// commands at the start of its next frame, so it never sees a half-built pattern.
 struct LEDController {
     Pattern patterns[MAX_PATTERNS];
-    int pattern_count;
+    int pattern_count;      // Live patterns (render task only)
+    LedIndexStack free_slots;           // Slots no pattern holds or has reserved
+    atomic_ushort slot_links[MAX_PATTERNS];
+    LedCommandQueue commands;           // Pattern changes waiting for the next frame
+    LedArena arena;                     // Per-LED pattern data, claimed at creation
+    _Alignas(8) uint8_t arena_memory[LED_PATTERN_ARENA_GROUPS * LED_ARENA_MAX_ALLOC];
+    atomic_uint arena_used[LED_PATTERN_ARENA_GROUPS];
+    atomic_uint seed_sequence; // Default seeds for random patterns, in creation order
+    LedTimeline timeline;   // Render task only
     uint32_t current_time;
+    uint32_t dirty_edges;   // Bit per edge whose output changed since the last frame
+    uint32_t next_change_in; // ms after current_time until some output changes, LED_NEVER if none
+    
+    // Segmented patterns are evaluated once into this one-edge frame (render task only)
+    LedEdgeConfigState_t scratch_frame;
+    uint32_t scratch_length;
+    LedPixel_t* scratch_rows[1];
+    LedPixel_t scratch_pixels[MAX_LEDS_PER_EDGE];
+    uint8_t scratch_coverage[MAX_LEDS_PER_EDGE];
+    LedState_t scratch_line[MAX_LEDS_PER_EDGE];        // One segment's LEDs in order
+#if FRAMEBUFFER_INDEXED
+    LedState_t scratch_palette[FRAMEBUFFER_PALETTE_SIZE];
+#endif
 };
 
+// No further output change is scheduled
+#define LED_NEVER UINT32_MAX
+
 // Core controller functions
 LEDController* led_controller_create(int num_edges, int* leds_per_edge);
 void led_controller_destroy(LEDController* controller);
-void led_controller_update(LEDController* controller, uint32_t time);
+// Returns true when a new frame was published, false when nothing changed
+bool led_controller_update(LEDController* controller, uint32_t time);
 void led_controller_clear(LEDController* controller);
 void led_controller_task(void *param);
+// ms from `now` until the next render pass is due: the earliest pattern output
+// change, but no sooner than min_period_ms after the last pass. LED_NEVER when
+// the scene is static and only a pattern change can alter it.
+uint32_t led_controller_frame_delay_ms(LEDController* controller, uint32_t now, uint32_t min_period_ms);
+// Wake the render task early, e.g. after patterns were added or changed
+void led_controller_wake(void);
 // Matrix operations
 void led_matrix_init(LedEdgeConfigState_t* matrix, int num_edges, int* leds_per_edge);
 void led_matrix_clear(LedEdgeConfigState_t* matrix);
@@ -132,11 +381,15 @@ LedState_t led_color_create(uint8_t r, uint8_t g, uint8_t b, uint8_t intensity);
 LedState_t led_color_interpolate(LedState_t start, LedState_t end, float t);
 LedState_t led_color_blend(LedState_t c1, LedState_t c2, BlendMode mode);
 LedState_t led_color_scale(LedState_t color, float scale);
+// Fixed-point variants; t_q16 and scale_q16 are Q16.16 fractions in [0, LED_Q16_ONE]
+LedState_t led_color_interpolate_q16(LedState_t start, LedState_t end, uint32_t t_q16);
+LedState_t led_color_scale_q16(LedState_t color, uint32_t scale_q16);
 
 // Pattern creation functions
 int led_pattern_static(LEDController* controller, int edge, int start_idx, int end_idx, LedState_t color);
 int led_pattern_blink(LEDController* controller, int edge, int start_idx, int end_idx, 
                      LedState_t color, uint32_t on_time, uint32_t off_time, int repeats);
+// Fades over duration ms and expires after it; duration 0 holds end_color for good
 int led_pattern_fade(LEDController* controller, int edge, int start_idx, int end_idx,
                     LedState_t start_color, LedState_t end_color, uint32_t duration);
 int led_pattern_pulse(LEDController* controller, int edge, int start_idx, int end_idx,
@@ -147,8 +400,24 @@ int led_pattern_gradient(LEDController* controller, int edge, int start_idx, int
                         LedState_t start_color, LedState_t end_color);
 int led_pattern_twinkle(LEDController* controller, int edge, int start_idx, int end_idx,
                        LedState_t color, float probability);
+int led_pattern_twinkle_seeded(LEDController* controller, int edge, int start_idx, int end_idx,
+                              LedState_t color, float probability, uint32_t seed);
+// spawn_probability is per LED per TWINKLE_ENVELOPE_STEP_MS
+int led_pattern_twinkle_envelope(LEDController* controller, int edge, int start_idx, int end_idx,
+                                LedState_t color, float spawn_probability,
+                                uint32_t attack_ms, uint32_t decay_ms, uint32_t seed);
 int led_pattern_palette_cycle(LEDController* controller, int edge, int start_idx, int end_idx,
                              ColorPalette palette, uint32_t cycle_period, int offset);
+// Same with spread_q16 of the cycle between neighbouring LEDs instead of
+// PALETTE_CYCLE_DEFAULT_SPREAD_Q16 (LED_Q16_ONE / span: one cycle across the span)
+int led_pattern_palette_cycle_spread(LEDController* controller, int edge, int start_idx, int end_idx,
+                                     ColorPalette palette, uint32_t cycle_period, int offset,
+                                     uint32_t spread_q16);
+// Play an opened animation on the range, timed by the controller clock. An
+// animation rendered from E edges of L LEDs has edge e at source_offset e * L.
+// The animation must stay open while the pattern exists.
+int led_pattern_animation(LEDController* controller, int edge, int start_idx, int end_idx,
+                          const LedAnimation* animation, uint32_t source_offset, bool loop);
 
 // Convenience shift pattern functions
 int led_pattern_shift_comet(LEDController* controller, int edge, int start_idx, int end_idx,
@@ -156,16 +425,60 @@ int led_pattern_shift_comet(LEDController* controller, int edge, int start_idx,
 int led_pattern_shift_dot(LEDController* controller, int edge, int start_idx, int end_idx,
                          LedState_t color, int spacing, uint32_t period);
 
+// Pattern types. Register before creating patterns of the type; pattern_class
+// must stay valid for good (e.g. static const). Returns the type id for
+// led_pattern_create, or -1 if the table is full or pattern_class is malformed.
+int led_pattern_register(const LedPatternClass* pattern_class);
+const LedPatternClass* led_pattern_class(int type);   // NULL if not registered
+// Create a pattern of any registered type; config goes to its init
+int led_pattern_create(LEDController* controller, int type, int edge, int start_idx, int end_idx,
+                       const void* config);
+// For init: `size` bytes that live as long as the pattern, from the arena or,
+// when it has no room (see LED_PATTERN_ARENA_SIZE), the heap. NULL when the
+// pattern already has storage or the heap is out of memory too (logged).
+void* led_pattern_storage(LEDController* controller, Pattern* pattern, size_t size);
+
+// For render: write the pattern's colors through its blend mode; LEDs outside
+// the edge are skipped
+void led_pattern_fill(LedEdgeConfigState_t* frame, Pattern* pattern, LedState_t color);
+void led_pattern_blend_run(LedEdgeConfigState_t* frame, Pattern* pattern, int start,
+                           const LedState_t* colors, int count);
+void led_pattern_put_led(LedEdgeConfigState_t* frame, Pattern* pattern, int index, LedState_t color);
+
 // Utility functions
 ColorPalette led_palette_rainbow(int steps);
 ColorPalette led_palette_create(LedState_t* colors, int count);
 float led_ease_in_out(float t);
 uint32_t led_random_range(uint32_t min, uint32_t max);
+void led_random_seed(LedRandom* random, uint32_t seed);
+uint32_t led_random_next(LedRandom* random);
+
+// Group the calling task's pattern changes so they land on the same frame.
+// Batches nest; only the outermost commit publishes. If any change in the batch
+// failed (no free slot or command node) the whole batch is dropped, patterns it
+// created are released, and commit returns pdFAIL.
+void led_batch_begin(LEDController* controller);
+BaseType_t led_batch_commit(LEDController* controller);
+
+// Start playing events[0..count) from the next frame, replacing any timeline
+// already playing. The events must stay valid while they play (e.g. static const).
+// pdFAIL if the script is malformed or the change could not be queued.
+BaseType_t led_timeline_play(LEDController* controller, const LedTimelineEvent* events, int count);
+// Stop the timeline and remove the patterns it set
+void led_timeline_stop(LEDController* controller);
 
 // Pattern control functions
 void led_pattern_remove(LEDController* controller, int pattern_id);
 void led_pattern_stop(LEDController* controller, int pattern_id);
 void led_pattern_start(LEDController* controller, int pattern_id, uint32_t start_time);
+void led_pattern_set_blend(LEDController* controller, int pattern_id, BlendMode mode);
+void led_pattern_set_z_order(LEDController* controller, int pattern_id, int z_order);
+// Show the pattern on up to LED_PATTERN_MAX_SEGMENTS segments instead of its own
+// edge: its range is evaluated once per frame, exactly as it would be drawn there,
+// and the LEDs it drew are blended into every segment with its blend mode. A
+// segment longer than the range (mirrored: twice the range) leaves the rest as
+// it was. The segments are copied; count 0 puts the pattern back on its own edge.
+void led_pattern_set_segments(LEDController* controller, int pattern_id, const LedSegment* segments, int count);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,81 @@
+#include "host_output.h"
+#include "framebuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static LedTopologyMap topology_map;
+static LedPackConfig pack_config;
+static uint8_t* wire_buffer = NULL;
+static size_t wire_buffer_size = 0;
+static size_t wire_length = 0;
+static bool wire_current = false;   // wire_buffer holds the last frame acquired
+static HostOutputStats stats;
+
+bool host_output_init(const LedTopology* topology, LedWireFormat format) {
+    host_output_deinit();
+    if (!led_topology_build_map(topology, &topology_map)) return false;
+
+    pack_config.format = format;
+    pack_config.channel_lut = NULL;
+    wire_buffer_size = topology_map.physical_count * led_pack_bytes_per_pixel(format);
+    wire_buffer = calloc(1, wire_buffer_size ? wire_buffer_size : 1);
+    if (!wire_buffer) {
+        led_topology_free_map(&topology_map);
+        return false;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.checksum = FNV_OFFSET_BASIS;
+    wire_current = false;
+    return true;
+}
+
+void host_output_deinit(void) {
+    led_topology_free_map(&topology_map);
+    free(wire_buffer);
+    wire_buffer = NULL;
+    wire_buffer_size = 0;
+    wire_length = 0;
+    wire_current = false;
+}
+
+bool host_output_present(void) {
+    if (!wire_buffer) return false;
+
+    bool is_new = false;
+    uint32_t changed_edges = 0;
+    LedEdgeConfigState_t* frame = framebuffer_acquire_changes(&is_new, &changed_edges);
+    if (!is_new || !frame) return false;
+
+    // Repack only the channels with a changed edge, like the display task
+    uint8_t bytes_per_pixel = led_pack_bytes_per_pixel(pack_config.format);
+    for (int c = 0; c < topology_map.channel_count; c++) {
+        if (wire_current && !(topology_map.channel_edges[c] & changed_edges)) continue;
+        size_t offset = topology_map.channel_offset[c] * bytes_per_pixel;
+        led_pack_gather(frame, topology_map.source + topology_map.channel_offset[c],
+                        topology_map.channel_length[c], &pack_config, wire_buffer + offset,
+                        wire_buffer_size - offset);
+        stats.channels_packed++;
+    }
+    wire_length = topology_map.physical_count * bytes_per_pixel;
+    wire_current = true;
+
+    for (size_t i = 0; i < wire_length; i++) {
+        stats.checksum = (stats.checksum ^ wire_buffer[i]) * FNV_PRIME;
+    }
+    stats.frames_sent++;
+    stats.bytes_sent += wire_length;
+    return true;
+}
+
+const uint8_t* host_output_last_frame(size_t* length) {
+    if (length) *length = wire_length;
+    return wire_buffer;
+}
+
+void host_output_get_stats(HostOutputStats* out) {
+    if (out) *out = stats;
+}
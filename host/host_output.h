@@ -0,0 +1,36 @@
+#ifndef HOST_OUTPUT_H
+#define HOST_OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "led_pack.h"
+#include "led_topology.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Null LED sink: frames go through the same acquire + topology gather + pack path
+// as the firmware's display task, then are hashed instead of transmitted
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t channels_packed;   // Channels repacked; ones with no changed edge are kept
+    uint64_t bytes_sent;
+    uint32_t checksum;      // FNV-1a over every byte sent, for regression comparisons
+} HostOutputStats;
+
+bool host_output_init(const LedTopology* topology, LedWireFormat format);
+void host_output_deinit(void);
+
+// Display-task step: pick up the newest frame and send it if it is new
+bool host_output_present(void);
+
+const uint8_t* host_output_last_frame(size_t* length);
+void host_output_get_stats(HostOutputStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_OUTPUT_H
@@ -0,0 +1,230 @@
+#include "host_port.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "render_engine.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// ---- globals the firmware defines in main.c ----
+
+TaskHandle_t physical_led_task_handle = NULL;
+TaskHandle_t render_engine_task_handle = NULL;
+LEDController* led_controller = NULL;
+
+// ---- virtual clock ----
+
+static uint32_t clock_ms;
+
+static void fire_due_timers(void);
+
+void host_clock_set_ms(uint32_t time_ms) {
+    clock_ms = time_ms;
+    fire_due_timers();
+}
+
+void host_clock_advance_ms(uint32_t delta_ms) {
+    clock_ms += delta_ms;
+    fire_due_timers();
+}
+
+uint32_t host_clock_ms(void) { return clock_ms; }
+
+uint32_t get_current_time_ms(void) { return clock_ms; }
+int64_t esp_timer_get_time(void) { return (int64_t)clock_ms * 1000; }
+TickType_t xTaskGetTickCount(void) { return clock_ms / portTICK_PERIOD_MS; }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+
+void vTaskDelay(TickType_t ticks) {
+    host_clock_advance_ms(ticks * portTICK_PERIOD_MS);
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t period) {
+    *previous_wake += period;
+    uint32_t wake_ms = *previous_wake * portTICK_PERIOD_MS;
+    if ((int32_t)(wake_ms - clock_ms) > 0) host_clock_set_ms(wake_ms);
+}
+
+// ---- one-shot timers ----
+
+struct host_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed;
+    int64_t deadline_us;
+    struct host_timer* next;
+};
+
+static struct host_timer* timers = NULL;
+
+static void fire_due_timers(void) {
+    int64_t now_us = esp_timer_get_time();
+    for (struct host_timer* timer = timers; timer; timer = timer->next) {
+        if (timer->armed && timer->deadline_us <= now_us) {
+            timer->armed = false;
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    if (!args || !args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    struct host_timer* timer = calloc(1, sizeof(*timer));
+    if (!timer) return ESP_ERR_NO_MEM;
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->next = timers;
+    timers = timer;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = true;
+    timer->deadline_us = esp_timer_get_time() + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    for (struct host_timer** link = &timers; *link; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            free(timer);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+// ---- heap ----
+
+static HostHeapStats heap_stats;
+
+void* pvPortMalloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) {
+        heap_stats.allocations++;
+        heap_stats.bytes_allocated += size;
+    }
+    return ptr;
+}
+
+void vPortFree(void* ptr) {
+    if (ptr) heap_stats.frees++;
+    free(ptr);
+}
+
+void host_heap_get_stats(HostHeapStats* stats) { *stats = heap_stats; }
+void host_heap_reset_stats(void) { heap_stats = (HostHeapStats){0}; }
+
+// ---- tasks and notifications ----
+
+struct host_task {
+    const char* name;
+    uint32_t value;
+    bool pending;
+};
+
+TaskHandle_t host_task_create(const char* name) {
+    TaskHandle_t task = calloc(1, sizeof(*task));
+    if (task) task->name = name;
+    return task;
+}
+
+void host_task_delete(TaskHandle_t task) {
+    free(task);
+}
+
+uint32_t host_task_take_notification(TaskHandle_t task) {
+    if (!task || !task->pending) return 0;
+    task->pending = false;
+    return task->value;
+}
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stack_depth,
+                       void* param, UBaseType_t priority, TaskHandle_t* handle) {
+    // Task bodies are endless loops; host programs drive the work themselves
+    TaskHandle_t created = host_task_create(name);
+    if (handle) *handle = created;
+    return created ? pdPASS : pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task) host_task_delete(task);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) return pdFAIL;
+    switch (action) {
+        case eSetBits: task->value |= value; break;
+        case eIncrement: task->value++; break;
+        case eSetValueWithOverwrite: task->value = value; break;
+        case eSetValueWithoutOverwrite:
+            if (task->pending) return pdFAIL;
+            task->value = value;
+            break;
+        case eNoAction: break;
+    }
+    task->pending = true;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+// Waiting from host code never blocks: it consumes whatever is latched on the
+// render task's handle, or times out immediately
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                           uint32_t* value, TickType_t ticks_to_wait) {
+    TaskHandle_t self = physical_led_task_handle;
+    if (!self || !self->pending) return pdFALSE;
+    if (value) *value = self->value;
+    self->value &= ~clear_on_exit;
+    self->pending = false;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    TaskHandle_t self = render_engine_task_handle;
+    if (!self || !self->pending) return 0;
+    uint32_t value = self->value;
+    self->value = clear_on_exit ? 0 : value - 1;
+    self->pending = self->value != 0;
+    return value;
+}
+
+// ---- semaphores ----
+
+struct host_mutex {
+    pthread_mutex_t lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    SemaphoreHandle_t mutex = malloc(sizeof(*mutex));
+    if (mutex) pthread_mutex_init(&mutex->lock, NULL);
+    return mutex;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex) {
+    if (!mutex) return;
+    pthread_mutex_destroy(&mutex->lock);
+    free(mutex);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks_to_wait) {
+    if (ticks_to_wait == 0) return pthread_mutex_trylock(&mutex->lock) == 0 ? pdTRUE : pdFALSE;
+    return pthread_mutex_lock(&mutex->lock) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    return pthread_mutex_unlock(&mutex->lock) == 0 ? pdTRUE : pdFALSE;
+}
@@ -0,0 +1,38 @@
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deterministic virtual clock behind get_current_time_ms, esp_timer_get_time and
+// the tick count; it only moves when told to (or through vTaskDelay*)
+void host_clock_set_ms(uint32_t time_ms);
+void host_clock_advance_ms(uint32_t delta_ms);
+uint32_t host_clock_ms(void);
+
+// pvPortMalloc/vPortFree accounting
+typedef struct {
+    uint32_t allocations;
+    uint32_t frees;
+    size_t bytes_allocated;
+} HostHeapStats;
+
+void host_heap_get_stats(HostHeapStats* stats);
+void host_heap_reset_stats(void);
+
+// Task handles that notifications can be sent to without a scheduler
+TaskHandle_t host_task_create(const char* name);
+void host_task_delete(TaskHandle_t task);
+// Value latched by xTaskNotify/xTaskNotifyGive since the last call, 0 if none
+uint32_t host_task_take_notification(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_PORT_H
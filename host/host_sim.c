@@ -0,0 +1,93 @@
+#include "host_sim.h"
+#include "host_port.h"
+#include "host_output.h"
+#include "freertos/task.h"
+#include "main.h"
+
+const LedTopology host_sim_default_topology = {
+    .num_edges = 4,
+    .serpentine = false,
+    .edges = {
+        { .length = 15, .start_offset = 0,  .channel = 0 },
+        { .length = 15, .start_offset = 15, .channel = 0 },
+        { .length = 15, .start_offset = 30, .channel = 0 },
+        { .length = 15, .start_offset = 45, .channel = 0 },
+    },
+};
+
+static HostSimStats sim_stats;
+
+LEDController* host_sim_init(const LedTopology* topology) {
+    host_sim_deinit();
+    host_clock_set_ms(0);
+
+    int leds_per_edge[MAX_EDGES];
+    led_topology_edge_lengths(topology, leds_per_edge);
+    led_controller = led_controller_create(topology->num_edges, leds_per_edge);
+    if (!led_controller) return NULL;
+
+    if (!host_output_init(topology, LED_WIRE_GRB)) {
+        host_sim_deinit();
+        return NULL;
+    }
+    render_engine_task_handle = host_task_create("render_engine");
+    physical_led_task_handle = host_task_create("physical_led_update");
+
+    sim_stats = (HostSimStats){0};
+    return led_controller;
+}
+
+void host_sim_deinit(void) {
+    if (led_controller) {
+        led_controller_destroy(led_controller);
+        led_controller = NULL;
+    }
+    host_output_deinit();
+    host_task_delete(render_engine_task_handle);
+    host_task_delete(physical_led_task_handle);
+    render_engine_task_handle = NULL;
+    physical_led_task_handle = NULL;
+}
+
+bool host_sim_step(uint32_t period_ms) {
+    host_clock_advance_ms(period_ms);
+    sim_stats.frames_stepped++;
+
+    // Render task body
+    if (led_controller_update(led_controller, get_current_time_ms())) {
+        sim_stats.frames_rendered++;
+        xTaskNotify(physical_led_task_handle, LED_FRAME_READY_NOTIFICATION, eSetValueWithOverwrite);
+    }
+
+    // Display task body
+    if (!host_task_take_notification(physical_led_task_handle)) return false;
+    if (!host_output_present()) return false;
+    sim_stats.frames_sent++;
+    return true;
+}
+
+void host_sim_run(uint32_t duration_ms, uint32_t period_ms) {
+    uint32_t end = host_clock_ms() + duration_ms;
+    while ((int32_t)(end - host_clock_ms()) > 0) {
+        host_sim_step(period_ms);
+    }
+}
+
+void host_sim_run_adaptive(uint32_t duration_ms) {
+    uint32_t end = host_clock_ms() + duration_ms;
+    for (;;) {
+        uint32_t remaining = end - host_clock_ms();
+        uint32_t delay = led_controller_frame_delay_ms(led_controller, host_clock_ms(), LED_MIN_FRAME_PERIOD_MS);
+        // A pattern change notifies the render task, which wakes at once
+        if (host_task_take_notification(render_engine_task_handle)) delay = 0;
+        if ((int32_t)remaining <= 0 || delay >= remaining) {
+            host_clock_advance_ms((int32_t)remaining > 0 ? remaining : 0);
+            return;
+        }
+        host_sim_step(delay);
+    }
+}
+
+void host_sim_get_stats(HostSimStats* stats) {
+    if (stats) *stats = sim_stats;
+}
@@ -0,0 +1,40 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "render_engine.h"
+#include "led_topology.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Render task + display task pair driven frame by frame on the virtual clock
+typedef struct {
+    uint32_t frames_stepped;
+    uint32_t frames_rendered;   // led_controller_update published a frame
+    uint32_t frames_sent;       // Display step packed and sent a new frame
+} HostSimStats;
+
+// 4 edges x 15 LEDs on one chain, as on the board
+extern const LedTopology host_sim_default_topology;
+
+// Creates led_controller for the topology and hooks up the null output
+LEDController* host_sim_init(const LedTopology* topology);
+void host_sim_deinit(void);
+
+// Advance the clock by period_ms, then run one render and one display step
+bool host_sim_step(uint32_t period_ms);
+void host_sim_run(uint32_t duration_ms, uint32_t period_ms);
+// Like the firmware render task: sleep until the controller's next frame is due
+// (at most LED_MAX_FPS), or until duration_ms runs out on a static scene
+void host_sim_run_adaptive(uint32_t duration_ms);
+
+void host_sim_get_stats(HostSimStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SIM_H
@@ -0,0 +1,168 @@
+// Renders a scene with the engine on the host and stores it as a precomputed
+// animation for PATTERN_ANIMATION (see led_animation.h):
+//     led_anim_encode <out.leda> [--edges N] [--leds N] [--duration ms]
+//                     [--period ms] [--keyframe N] [--loop]
+// The file holds edge e's LEDs at source offset e * leds; flash it with
+//     parttool.py write_partition --partition-name anim --input out.leda
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+#include "host_sim.h"
+#include "led_animation.h"
+#include "led_frame_codec.h"
+#include "main.h"
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static bool buffer_reserve(Buffer* buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) return true;
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+    while (capacity < buffer->size + extra) capacity *= 2;
+    uint8_t* data = realloc(buffer->data, capacity);
+    if (!data) return false;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+// The look to precompute: layered gradient, comet and envelope twinkle per edge
+static void build_scene(LEDController* controller, int edges, int leds) {
+    for (int e = 0; e < edges; e++) {
+        int last = leds - 1;
+        led_pattern_gradient(controller, e, 0, last,
+                             led_color_create(255, 32 * e, 0, 160), led_color_create(0, 64, 255, 160));
+        int comet = led_pattern_shift_comet(controller, e, 0, last,
+                                            led_color_create(255, 255, 255, 255), 6 + e, 40);
+        led_pattern_set_blend(controller, comet, BLEND_ADD);
+        led_pattern_set_z_order(controller, comet, 1);
+        int twinkle = led_pattern_twinkle_envelope(controller, e, 0, last, led_color_create(255, 200, 120, 255),
+                                                   0.02f, 200, 600, 0x5EED0000u + e);
+        led_pattern_set_blend(controller, twinkle, BLEND_MAX);
+        led_pattern_set_z_order(controller, twinkle, 2);
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s <out.leda> [--edges N] [--leds N] [--duration ms] "
+                    "[--period ms] [--keyframe N] [--loop]\n", name);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+    int edges = 4;
+    int leds = 15;
+    uint32_t duration_ms = 10000;
+    uint32_t period_ms = 20;
+    uint32_t keyframe_interval = 50;
+    uint16_t flags = 0;
+
+    for (int i = 2; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--edges") == 0 && has_value) {
+            edges = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--leds") == 0 && has_value) {
+            leds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && has_value) {
+            duration_ms = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--period") == 0 && has_value) {
+            period_ms = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--keyframe") == 0 && has_value) {
+            keyframe_interval = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            flags |= LED_ANIMATION_FLAG_LOOP;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (edges < 1 || edges > MAX_EDGES || leds < 1 || leds > MAX_LEDS_PER_EDGE ||
+        period_ms == 0 || keyframe_interval == 0 || duration_ms < period_ms) {
+        fprintf(stderr, "invalid options\n");
+        return 2;
+    }
+
+    // One chain, edges back to back
+    LedTopology topology = { .num_edges = (uint8_t)edges };
+    for (int e = 0; e < edges; e++) {
+        topology.edges[e].length = (uint16_t)leds;
+        topology.edges[e].start_offset = (uint16_t)(e * leds);
+    }
+    LEDController* controller = host_sim_init(&topology);
+    if (!controller) {
+        fprintf(stderr, "failed to create controller\n");
+        return 1;
+    }
+    build_scene(controller, edges, leds);
+
+    uint32_t led_count = (uint32_t)(edges * leds);
+    uint32_t frame_count = duration_ms / period_ms;
+    LedState_t* frame = calloc(led_count, sizeof(LedState_t));
+    LedState_t* previous = calloc(led_count, sizeof(LedState_t));
+    uint8_t* index = calloc(frame_count, sizeof(uint32_t));
+    Buffer frames = { 0 };
+    if (!frame || !previous || !index) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint32_t keyframe_bytes = 0;
+    for (uint32_t f = 0; f < frame_count; f++) {
+        // Frame f is what the display shows at pattern time f * period_ms
+        host_sim_step(f == 0 ? 0 : period_ms);
+        for (int e = 0; e < edges; e++) {
+            for (int i = 0; i < leds; i++) {
+                frame[e * leds + i] = led_matrix_get_led(currentLedConfigState, e, i);
+            }
+        }
+
+        bool keyframe = f % keyframe_interval == 0;
+        if (!buffer_reserve(&frames, LED_CODEC_MAX_ENCODED_SIZE(led_count))) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        size_t size = led_frame_encode(frame, keyframe ? NULL : previous, led_count,
+                                       frames.data + frames.size, frames.capacity - frames.size);
+        led_animation_write_index(&index[f * sizeof(uint32_t)], (uint32_t)frames.size, keyframe);
+        frames.size += size;
+        if (keyframe) keyframe_bytes += size;
+
+        LedState_t* swap = previous;
+        previous = frame;
+        frame = swap;
+    }
+
+    uint8_t header[LED_ANIMATION_HEADER_SIZE];
+    led_animation_write_header(header, (uint16_t)led_count, flags, frame_count, period_ms,
+                               keyframe_interval, (uint32_t)frames.size);
+
+    FILE* out = fopen(path, "wb");
+    if (!out || fwrite(header, 1, sizeof(header), out) != sizeof(header) ||
+        fwrite(index, sizeof(uint32_t), frame_count, out) != frame_count ||
+        fwrite(frames.data, 1, frames.size, out) != frames.size || fclose(out) != 0) {
+        fprintf(stderr, "failed to write %s\n", path);
+        return 1;
+    }
+
+    size_t raw = (size_t)frame_count * led_count * sizeof(LedState_t);
+    size_t total = sizeof(header) + frame_count * sizeof(uint32_t) + frames.size;
+    printf("%s: %u frames of %u LEDs every %u ms, keyframe every %u\n",
+           path, frame_count, led_count, period_ms, keyframe_interval);
+    printf("size: %zu bytes (%.1f%% of %zu raw; keyframes %u bytes)\n",
+           total, 100.0 * total / raw, raw, keyframe_bytes);
+
+    free(frames.data);
+    free(index);
+    free(frame);
+    free(previous);
+    host_sim_deinit();
+    return 0;
+}
@@ -0,0 +1,541 @@
+// Per-kernel microbenchmarks: every pattern type rendered through the controller,
+// one look on four edges as four patterns or one segmented pattern, the color math
+// (Q16.16 or float, as built), led_color_blend / led_span_blend in every mode and
+// led_pack_frame, across span sizes, plus whole-frame clear and blend on 8 edges of
+// 256 LEDs in the layout built (flat, or per edge in led_bench_per_edge), as CSV or JSON. cycles_per_led is in time
+// stamp counter cycles where the CPU has one, 0 otherwise.
+//     led_bench [--json] [--min-ms N]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+#include "host_port.h"
+#include "render_engine.h"
+#include "led_swar.h"
+#include "led_pack.h"
+#include "main.h"
+
+#define BENCH_FRAME_PERIOD_MS 20
+#define BENCH_RUNS 5            // Median of this many timed runs
+#define BENCH_LONG_DURATION (1u << 30)
+
+static const int bench_spans[] = { 15, 30, 60, 120, MAX_LEDS_PER_EDGE };
+#define BENCH_SPAN_COUNT (sizeof(bench_spans) / sizeof(bench_spans[0]))
+
+typedef struct {
+    const char* kernel;
+    const char* mode;
+    int span;
+    uint32_t frames;
+    double ns_per_frame;
+    double ns_per_led;
+    double allocs_per_frame;
+} BenchResult;
+
+static double cycles_per_ns = 0.0;  // 0: no cycle counter
+
+static bool output_json = false;
+static bool first_result = true;
+static double min_run_ns = 20e6;
+
+// ---- allocation counting (GNU ld --wrap) ----
+
+#ifdef HOST_WRAP_MALLOC
+static uint32_t wrapped_allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) { wrapped_allocations++; return __real_malloc(size); }
+void* __wrap_calloc(size_t count, size_t size) { wrapped_allocations++; return __real_calloc(count, size); }
+void* __wrap_realloc(void* ptr, size_t size) { wrapped_allocations++; return __real_realloc(ptr, size); }
+#endif
+
+static uint32_t allocation_count(void) {
+    HostHeapStats heap;
+    host_heap_get_stats(&heap);
+#ifdef HOST_WRAP_MALLOC
+    return heap.allocations + wrapped_allocations;
+#else
+    return heap.allocations;
+#endif
+}
+
+// ---- timing ----
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Cycle counter ticks per ns, measured against the monotonic clock
+static void calibrate_cycles(void) {
+#ifdef BENCH_HAVE_TSC
+    double start_ns = now_ns();
+    uint64_t start_cycles = __rdtsc();
+    while (now_ns() - start_ns < 20e6) {
+    }
+    cycles_per_ns = (double)(__rdtsc() - start_cycles) / (now_ns() - start_ns);
+#endif
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef void (*bench_fn)(void* context, uint32_t iterations);
+
+// Median ns per iteration; iterations are scaled until one run takes min_run_ns
+static double time_kernel(bench_fn fn, void* context, uint32_t* iterations_out, double* allocs_out) {
+    uint32_t iterations = 16;
+    fn(context, iterations); // Warm up
+    for (;;) {
+        double start = now_ns();
+        fn(context, iterations);
+        double elapsed = now_ns() - start;
+        if (elapsed >= min_run_ns || iterations >= (1u << 26)) break;
+        iterations *= 2;
+    }
+
+    double samples[BENCH_RUNS];
+    uint32_t allocs_before = allocation_count();
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        double start = now_ns();
+        fn(context, iterations);
+        samples[r] = (now_ns() - start) / iterations;
+    }
+    uint32_t allocs = allocation_count() - allocs_before;
+
+    qsort(samples, BENCH_RUNS, sizeof(double), compare_double);
+    *iterations_out = iterations;
+    *allocs_out = (double)allocs / ((double)iterations * BENCH_RUNS);
+    return samples[BENCH_RUNS / 2];
+}
+
+// ---- output ----
+
+static void print_header(void) {
+    if (output_json) {
+        printf("{\n  \"fixed_point\": %d,\n  \"skip_unchanged_frames\": %d,\n  \"indexed_framebuffer\": %d,\n"
+               "  \"results\": [\n", LED_FIXED_POINT, LED_SKIP_UNCHANGED_FRAMES, FRAMEBUFFER_INDEXED);
+    } else {
+        printf("kernel,mode,span,frames,ns_per_frame,ns_per_led,cycles_per_led,allocs_per_frame\n");
+    }
+}
+
+static void print_result(const BenchResult* r) {
+    if (output_json) {
+        printf("%s    {\"kernel\": \"%s\", \"mode\": \"%s\", \"span\": %d, \"frames\": %u, "
+               "\"ns_per_frame\": %.1f, \"ns_per_led\": %.3f, \"cycles_per_led\": %.2f, "
+               "\"allocs_per_frame\": %.4f}",
+               first_result ? "" : ",\n", r->kernel, r->mode, r->span, r->frames,
+               r->ns_per_frame, r->ns_per_led, r->ns_per_led * cycles_per_ns, r->allocs_per_frame);
+    } else {
+        printf("%s,%s,%d,%u,%.1f,%.3f,%.2f,%.4f\n", r->kernel, r->mode, r->span, r->frames,
+               r->ns_per_frame, r->ns_per_led, r->ns_per_led * cycles_per_ns, r->allocs_per_frame);
+    }
+    first_result = false;
+}
+
+static void print_footer(void) {
+    if (output_json) printf("\n  ]\n}\n");
+}
+
+// ---- pattern kernels, through led_controller_update ----
+
+typedef enum {
+    KERNEL_NONE = -1,
+    KERNEL_STATIC = PATTERN_STATIC,
+    KERNEL_BLINK = PATTERN_BLINK,
+    KERNEL_FADE = PATTERN_FADE,
+    KERNEL_PULSE = PATTERN_PULSE,
+    KERNEL_SHIFT = PATTERN_SHIFT,
+    KERNEL_GRADIENT = PATTERN_GRADIENT,
+    KERNEL_TWINKLE = PATTERN_TWINKLE,
+    KERNEL_PALETTE_CYCLE = PATTERN_PALETTE_CYCLE,
+    KERNEL_TWINKLE_ENVELOPE = PATTERN_TWINKLE_ENVELOPE,
+    KERNEL_CUSTOM_FILL,         // Registered at startup, see bench_fill_class
+} BenchKernel;
+
+static const char* kernel_names[] = {
+    "apply_static_pattern", "apply_blink_pattern", "apply_fade_pattern", "apply_pulse_pattern",
+    "apply_shift_pattern", "apply_gradient_pattern", "apply_twinkle_pattern", "apply_palette_cycle_pattern",
+    "apply_twinkle_envelope_pattern", "custom_fill_pattern",
+};
+
+// A registered copy of PATTERN_STATIC, to compare against the built-in
+static void bench_fill_render(LedEdgeConfigState_t* frame, Pattern* pattern, uint32_t time) {
+    led_pattern_fill(frame, pattern, *(const LedState_t*)pattern->params);
+}
+
+static uint32_t bench_fill_next_change(const Pattern* pattern, uint32_t time) {
+    return LED_NEVER;
+}
+
+static uint32_t bench_fill_output_key(const Pattern* pattern, uint32_t time) {
+    return 0;
+}
+
+static const LedPatternClass bench_fill_class = {
+    .name = "bench_fill", .params_size = sizeof(LedState_t), .render = bench_fill_render,
+    .next_change = bench_fill_next_change, .output_key = bench_fill_output_key,
+};
+static int bench_fill_type = -1;
+
+static int create_pattern(LEDController* controller, BenchKernel kernel, int edge, int span) {
+    LedState_t color = led_color_create(200, 120, 40, 230);
+    LedState_t other = led_color_create(10, 80, 250, 255);
+    int end = span - 1;
+
+    switch (kernel) {
+        case KERNEL_STATIC:
+            return led_pattern_static(controller, edge, 0, end, color);
+        case KERNEL_BLINK:
+            return led_pattern_blink(controller, edge, 0, end, color, 30, 30, 0);
+        case KERNEL_FADE:
+            return led_pattern_fade(controller, edge, 0, end, color, other, BENCH_LONG_DURATION);
+        case KERNEL_PULSE:
+            return led_pattern_pulse(controller, edge, 0, end, color, 255, 1000);
+        case KERNEL_SHIFT:
+            return led_pattern_shift_comet(controller, edge, 0, end, color, span / 4 > 0 ? span / 4 : 1, 20);
+        case KERNEL_GRADIENT:
+            return led_pattern_gradient(controller, edge, 0, end, color, other);
+        case KERNEL_TWINKLE:
+            return led_pattern_twinkle(controller, edge, 0, end, color, 0.3f);
+        case KERNEL_PALETTE_CYCLE:
+            return led_pattern_palette_cycle(controller, edge, 0, end, led_palette_rainbow(12), 2000, 0);
+        case KERNEL_TWINKLE_ENVELOPE:
+            return led_pattern_twinkle_envelope(controller, edge, 0, end, color, 0.05f, 200, 600, 1);
+        case KERNEL_CUSTOM_FILL:
+            return led_pattern_create(controller, bench_fill_type, edge, 0, end, &color);
+        default:
+            return -1;
+    }
+}
+
+static void run_frames(void* context, uint32_t iterations) {
+    LEDController* controller = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        host_clock_advance_ms(BENCH_FRAME_PERIOD_MS);
+        led_controller_update(controller, get_current_time_ms());
+    }
+}
+
+static LEDController* bench_controller(int span) {
+    host_clock_set_ms(0);
+    int leds_per_edge[1] = { span };
+    return led_controller_create(1, leds_per_edge);
+}
+
+static void bench_patterns(void) {
+    if (bench_fill_type < 0) bench_fill_type = led_pattern_register(&bench_fill_class);
+
+    for (size_t s = 0; s < BENCH_SPAN_COUNT; s++) {
+        int span = bench_spans[s];
+        uint32_t frames;
+        double allocs;
+
+        // Baseline: clear + swap with no layers, subtracted from every kernel
+        LEDController* controller = bench_controller(span);
+        double baseline = time_kernel(run_frames, controller, &frames, &allocs);
+        led_controller_destroy(controller);
+
+        BenchResult base = { "frame_baseline", "-", span, frames, baseline, baseline / span, allocs };
+        print_result(&base);
+
+        for (int k = KERNEL_STATIC; k <= KERNEL_CUSTOM_FILL; k++) {
+            controller = bench_controller(span);
+            if (create_pattern(controller, (BenchKernel)k, 0, span) < 0) {
+                fprintf(stderr, "failed to create %s\n", kernel_names[k]);
+                led_controller_destroy(controller);
+                continue;
+            }
+            double ns = time_kernel(run_frames, controller, &frames, &allocs) - baseline;
+            if (ns < 0) ns = 0;
+            led_controller_destroy(controller);
+
+            BenchResult result = { kernel_names[k], "replace", span, frames, ns, ns / span, allocs };
+            print_result(&result);
+        }
+    }
+}
+
+// ---- one look on four edges: a pattern per edge, or one with a segment per edge ----
+
+#define BENCH_SEGMENT_EDGES 4
+
+static void bench_segments(void) {
+    static const BenchKernel kernels[] = { KERNEL_PALETTE_CYCLE, KERNEL_TWINKLE_ENVELOPE };
+    for (size_t s = 0; s < BENCH_SPAN_COUNT; s++) {
+        int span = bench_spans[s];
+        int leds_per_edge[BENCH_SEGMENT_EDGES];
+        LedSegment segments[BENCH_SEGMENT_EDGES];
+        for (int e = 0; e < BENCH_SEGMENT_EDGES; e++) {
+            leds_per_edge[e] = span;
+            segments[e] = (LedSegment){ (uint8_t)e, SEGMENT_FORWARD, 0, (uint16_t)(span - 1) };
+        }
+        
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            for (int shared = 0; shared < 2; shared++) {
+                host_clock_set_ms(0);
+                LEDController* controller = led_controller_create(BENCH_SEGMENT_EDGES, leds_per_edge);
+                if (shared) {
+                    int id = create_pattern(controller, kernels[k], 0, span);
+                    led_pattern_set_segments(controller, id, segments, BENCH_SEGMENT_EDGES);
+                } else {
+                    for (int e = 0; e < BENCH_SEGMENT_EDGES; e++) create_pattern(controller, kernels[k], e, span);
+                }
+                
+                uint32_t frames;
+                double allocs;
+                double ns = time_kernel(run_frames, controller, &frames, &allocs);
+                led_controller_destroy(controller);
+                
+                BenchResult result = { kernel_names[kernels[k]], shared ? "segments_x4" : "patterns_x4",
+                                       span, frames, ns, ns / (span * BENCH_SEGMENT_EDGES), allocs };
+                print_result(&result);
+            }
+        }
+    }
+}
+
+// ---- color math: Q16.16 in the default build, float in led_bench_float ----
+
+typedef struct {
+    LedState_t colors[MAX_LEDS_PER_EDGE];
+    LedState_t out[MAX_LEDS_PER_EDGE];
+    int span;
+} ColorMathContext;
+
+// A fraction per LED, as a gradient or fade would ask for
+static void run_interpolate(void* context, uint32_t iterations) {
+    ColorMathContext* c = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int l = 0; l < c->span; l++) {
+#if LED_FIXED_POINT
+            c->out[l] = led_color_interpolate_q16(c->colors[l], c->out[l], (uint32_t)l * (LED_Q16_ONE / MAX_LEDS_PER_EDGE));
+#else
+            c->out[l] = led_color_interpolate(c->colors[l], c->out[l], (float)l / MAX_LEDS_PER_EDGE);
+#endif
+        }
+        __asm__ volatile("" : : "r"(c->out) : "memory");
+    }
+}
+
+static void run_scale(void* context, uint32_t iterations) {
+    ColorMathContext* c = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int l = 0; l < c->span; l++) {
+#if LED_FIXED_POINT
+            c->out[l] = led_color_scale_q16(c->colors[l], (uint32_t)l * (LED_Q16_ONE / MAX_LEDS_PER_EDGE));
+#else
+            c->out[l] = led_color_scale(c->colors[l], (float)l / MAX_LEDS_PER_EDGE);
+#endif
+        }
+        __asm__ volatile("" : : "r"(c->out) : "memory");
+    }
+}
+
+static void bench_color_math(void) {
+    static ColorMathContext c;
+    const char* mode = LED_FIXED_POINT ? "q16" : "float";
+    uint32_t seed = 777;
+    for (int l = 0; l < MAX_LEDS_PER_EDGE; l++) {
+        seed = seed * 1664525u + 1013904223u;
+        c.colors[l] = led_color_create(seed >> 24, seed >> 16, seed >> 8, seed >> 4);
+        c.out[l] = led_color_create(seed >> 8, seed >> 24, seed >> 16, 255);
+    }
+
+    for (size_t s = 0; s < BENCH_SPAN_COUNT; s++) {
+        c.span = bench_spans[s];
+        uint32_t frames;
+        double allocs;
+        double ns = time_kernel(run_interpolate, &c, &frames, &allocs);
+        BenchResult interpolate = { "led_color_interpolate", mode, c.span, frames, ns, ns / c.span, allocs };
+        print_result(&interpolate);
+
+        ns = time_kernel(run_scale, &c, &frames, &allocs);
+        BenchResult scale = { "led_color_scale", mode, c.span, frames, ns, ns / c.span, allocs };
+        print_result(&scale);
+    }
+}
+
+// ---- led_color_blend and led_span_blend ----
+
+typedef struct {
+    LedState_t dest[MAX_LEDS_PER_EDGE];
+    LedState_t src[MAX_LEDS_PER_EDGE];
+    int span;
+    BlendMode mode;
+} BlendContext;
+
+static void run_blend(void* context, uint32_t iterations) {
+    BlendContext* b = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int l = 0; l < b->span; l++) {
+            b->dest[l] = led_color_blend(b->dest[l], b->src[l], b->mode);
+        }
+        // Keep the compiler from hoisting the loop out
+        __asm__ volatile("" : : "r"(b->dest) : "memory");
+    }
+}
+
+static void run_span_blend(void* context, uint32_t iterations) {
+    BlendContext* b = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        led_span_blend(b->dest, b->src, b->span, b->mode);
+        __asm__ volatile("" : : "r"(b->dest) : "memory");
+    }
+}
+
+static void bench_blend(void) {
+    static const char* mode_names[] = { "add", "max", "average", "multiply", "replace" };
+    static BlendContext b;
+
+    for (size_t s = 0; s < BENCH_SPAN_COUNT; s++) {
+        for (int m = BLEND_ADD; m <= BLEND_REPLACE; m++) {
+            b.span = bench_spans[s];
+            b.mode = (BlendMode)m;
+            uint32_t seed = 12345;
+            for (int l = 0; l < MAX_LEDS_PER_EDGE; l++) {
+                seed = seed * 1664525u + 1013904223u;
+                b.dest[l] = led_color_create(seed >> 24, seed >> 16, seed >> 8, 255);
+                b.src[l] = led_color_create(seed >> 8, seed >> 24, seed >> 16, seed >> 4);
+            }
+
+            uint32_t frames;
+            double allocs;
+            double ns = time_kernel(run_blend, &b, &frames, &allocs);
+            BenchResult result = { "led_color_blend", mode_names[m], b.span, frames, ns, ns / b.span, allocs };
+            print_result(&result);
+
+            ns = time_kernel(run_span_blend, &b, &frames, &allocs);
+            BenchResult span_result = { "led_span_blend", mode_names[m], b.span, frames, ns, ns / b.span, allocs };
+            print_result(&span_result);
+        }
+    }
+}
+
+// ---- whole-frame clear and blend, flat or per-edge layout as built ----
+
+#define BENCH_FRAME_EDGES 8
+#define BENCH_FRAME_LEDS 256
+
+static void run_frame_clear(void* context, uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        framebuffer_clear_next();
+        __asm__ volatile("" : : "r"(nextLedConfigState) : "memory");
+    }
+}
+
+static void run_frame_blend(void* context, uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        led_matrix_blend(nextLedConfigState, currentLedConfigState, BLEND_ADD);
+        __asm__ volatile("" : : "r"(nextLedConfigState) : "memory");
+    }
+}
+
+static void bench_frame_layout(void) {
+    const char* layout = FRAMEBUFFER_FLAT_LAYOUT ? "flat" : "per_edge";
+    int leds_per_edge[BENCH_FRAME_EDGES];
+    for (int e = 0; e < BENCH_FRAME_EDGES; e++) leds_per_edge[e] = BENCH_FRAME_LEDS;
+    host_clock_set_ms(0);
+    LEDController* controller = led_controller_create(BENCH_FRAME_EDGES, leds_per_edge);
+    if (!controller) return;
+
+    // Something to blend: a different color on every LED of the source frame
+    for (int e = 0; e < BENCH_FRAME_EDGES; e++) {
+        for (int l = 0; l < BENCH_FRAME_LEDS; l++) {
+            led_matrix_set_led(currentLedConfigState, e, l, led_color_create(l, e * 32, 255 - l, 128));
+        }
+    }
+
+    const int total = BENCH_FRAME_EDGES * BENCH_FRAME_LEDS;
+    uint32_t frames;
+    double allocs;
+    double ns = time_kernel(run_frame_clear, NULL, &frames, &allocs);
+    BenchResult clear = { "framebuffer_clear_next_8x256", layout, BENCH_FRAME_LEDS, frames, ns, ns / total, allocs };
+    print_result(&clear);
+
+    ns = time_kernel(run_frame_blend, NULL, &frames, &allocs);
+    BenchResult blend = { "led_matrix_blend_8x256_add", layout, BENCH_FRAME_LEDS, frames, ns, ns / total, allocs };
+    print_result(&blend);
+    led_controller_destroy(controller);
+}
+
+// ---- led_pack_frame, on a rendered frame ----
+
+typedef struct {
+    const LedEdgeConfigState_t* frame;
+    LedPackConfig config;
+    uint8_t out[MAX_LEDS_PER_EDGE * 4];
+} PackContext;
+
+static void run_pack(void* context, uint32_t iterations) {
+    PackContext* p = context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        led_pack_frame(p->frame, &p->config, p->out, sizeof(p->out));
+        __asm__ volatile("" : : "r"(p->out) : "memory");
+    }
+}
+
+// Two looks: a gradient with a comet over it (a color per LED) and a static fill
+// with a blink over part of it (two colors)
+static void bench_pack(void) {
+    static const char* scene_names[] = { "gradient", "static" };
+    static PackContext p;
+    p.config.format = LED_WIRE_GRB;
+    p.config.channel_lut = NULL;
+
+    for (size_t s = 0; s < BENCH_SPAN_COUNT; s++) {
+        for (int scene = 0; scene < 2; scene++) {
+            int span = bench_spans[s];
+            LEDController* controller = bench_controller(span);
+            int top = create_pattern(controller, scene ? KERNEL_STATIC : KERNEL_GRADIENT, 0, span);
+            top = scene ? led_pattern_blink(controller, 0, 0, span / 2, led_color_create(255, 0, 0, 255), 1000, 1000, 0)
+                        : create_pattern(controller, KERNEL_SHIFT, 0, span);
+            led_pattern_set_blend(controller, top, BLEND_ADD);
+            host_clock_advance_ms(BENCH_FRAME_PERIOD_MS);
+            led_controller_update(controller, get_current_time_ms());
+            p.frame = framebuffer_acquire(NULL);
+
+            uint32_t frames;
+            double allocs;
+            double ns = time_kernel(run_pack, &p, &frames, &allocs);
+            BenchResult result = { "led_pack_frame", scene_names[scene], span, frames, ns, ns / span, allocs };
+            print_result(&result);
+            led_controller_destroy(controller);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            output_json = true;
+        } else if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            min_run_ns = strtod(argv[++i], NULL) * 1e6;
+        } else {
+            fprintf(stderr, "usage: %s [--json] [--min-ms N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    calibrate_cycles();
+    print_header();
+    bench_patterns();
+    bench_segments();
+    bench_color_math();
+    bench_blend();
+    bench_frame_layout();
+    bench_pack();
+    print_footer();
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Runs the main.c demo sequence on the host and prints a frame checksum, so a
+// change to the render or pack path can be checked for output differences.
+//     led_host_demo            frames scheduled like the firmware render task
+//     led_host_demo <ms>       fixed frame period
+//     --capture <file>         also record every rendered frame (see led_replay)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+#include "host_sim.h"
+#include "host_output.h"
+#include "led_capture.h"
+#include "main.h"
+
+static void run(uint32_t duration_ms, uint32_t period_ms) {
+    if (period_ms) {
+        host_sim_run(duration_ms, period_ms);
+    } else {
+        host_sim_run_adaptive(duration_ms);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t period_ms = 0;
+    const char* capture_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else {
+            period_ms = (uint32_t)strtoul(argv[i], NULL, 0);
+        }
+    }
+
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller) {
+        fprintf(stderr, "failed to create controller\n");
+        return 1;
+    }
+
+    FILE* capture = NULL;
+    if (capture_path) {
+        capture = fopen(capture_path, "wb");
+        LedCaptureSink sink = led_capture_file_sink(capture);
+        if (!capture || led_capture_start(nextLedConfigState, &sink) != pdPASS) {
+            fprintf(stderr, "failed to capture to %s\n", capture_path);
+            return 1;
+        }
+    }
+
+    // DEMO 1: individual edge control
+    led_pattern_static(controller, 0, 0, 14, led_color_create(255, 0, 0, 200));
+    run(2000, period_ms);
+    led_pattern_blink(controller, 1, 0, 14, led_color_create(0, 255, 0, 200), 500, 500, 0);
+    run(2000, period_ms);
+    led_pattern_pulse(controller, 2, 0, 14, led_color_create(0, 0, 255, 200), 200, 3000);
+    run(2000, period_ms);
+    led_pattern_palette_cycle(controller, 3, 0, 14, led_palette_rainbow(12), 5000, 0);
+    run(5000, period_ms);
+
+    // Layers: a comet over a gradient, and a fade
+    led_pattern_gradient(controller, 0, 0, 14, led_color_create(255, 0, 0, 255), led_color_create(0, 0, 255, 255));
+    int comet = led_pattern_shift_comet(controller, 0, 0, 14, led_color_create(255, 255, 255, 255), 4, 100);
+    led_pattern_set_blend(controller, comet, BLEND_ADD);
+    led_pattern_set_z_order(controller, comet, 1);
+    led_pattern_fade(controller, 1, 0, 14, led_color_create(0, 0, 0, 0), led_color_create(0, 255, 255, 255), 3000);
+    run(5000, period_ms);
+
+    HostSimStats sim;
+    HostOutputStats output;
+    FramebufferStats_t framebuffer;
+    host_sim_get_stats(&sim);
+    host_output_get_stats(&output);
+    framebuffer_get_stats(&framebuffer);
+
+    printf("frames stepped:   %u\n", sim.frames_stepped);
+    printf("frames rendered:  %u\n", sim.frames_rendered);
+    printf("frames sent:      %u (%llu bytes)\n", output.frames_sent, (unsigned long long)output.bytes_sent);
+    printf("frames dropped:   %u\n", framebuffer.frames_dropped);
+    printf("output checksum:  %08x\n", output.checksum);
+
+    if (capture) {
+        printf("frames captured:  %u\n", led_capture_frames());
+        led_capture_stop();
+        fclose(capture);
+    }
+
+    host_sim_deinit();
+    return 0;
+}
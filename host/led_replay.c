@@ -0,0 +1,191 @@
+// Feeds a frame capture (see led_capture.h) back through the framebuffer and the
+// display task's gather + pack path, and prints the same output checksum that
+// led_host_demo reports for the run that was captured:
+//     led_replay <capture.ledc> [--compare golden.ledc]
+// With --compare, the frames are also checked against a golden capture and the
+// first difference is reported; the exit status is 1 if any frame differs.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_output.h"
+#include "framebuffer.h"
+#include "led_capture.h"
+#include "render_engine.h"
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    uint8_t* data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc(length ? (size_t)length : 1);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+static bool open_capture(const char* path, LedCaptureReader* reader, uint8_t** data) {
+    size_t size = 0;
+    *data = read_file(path, &size);
+    if (!*data) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    if (led_capture_reader_open(reader, *data, size) != pdPASS) {
+        fprintf(stderr, "%s is not a capture\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool same_layout(const LedCaptureReader* a, const LedCaptureReader* b) {
+    if (a->num_edges != b->num_edges) return false;
+    for (int e = 0; e < a->num_edges; e++) {
+        if (led_capture_reader_edge_length(a, e) != led_capture_reader_edge_length(b, e)) return false;
+    }
+    return true;
+}
+
+// Reports the first differing LED of a frame; false if the frames are equal
+static bool report_difference(const LedCaptureReader* reader, uint32_t frame_index, uint32_t time_ms,
+                              const LedState_t* frame, const LedState_t* golden) {
+    uint32_t led = 0;
+    for (int e = 0; e < reader->num_edges; e++) {
+        for (uint16_t i = 0; i < led_capture_reader_edge_length(reader, e); i++, led++) {
+            if (memcmp(&frame[led], &golden[led], sizeof(LedState_t)) == 0) continue;
+            printf("frame %u (%u ms): edge %d LED %u is %02x%02x%02x/%02x, golden %02x%02x%02x/%02x\n",
+                   frame_index, time_ms, e, i,
+                   frame[led].r, frame[led].g, frame[led].b, frame[led].intensity,
+                   golden[led].r, golden[led].g, golden[led].b, golden[led].intensity);
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    const char* golden_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            golden_path = argv[++i];
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <capture.ledc> [--compare golden.ledc]\n", argv[0]);
+        return 2;
+    }
+
+    LedCaptureReader reader;
+    LedCaptureReader golden_reader;
+    uint8_t* data = NULL;
+    uint8_t* golden_data = NULL;
+    if (!open_capture(path, &reader, &data)) return 1;
+    if (golden_path) {
+        if (!open_capture(golden_path, &golden_reader, &golden_data)) return 1;
+        if (!same_layout(&reader, &golden_reader)) {
+            printf("edge layout differs from %s\n", golden_path);
+            return 1;
+        }
+    }
+
+    // Edges back to back on one chain, like host_sim_default_topology
+    LedTopology topology = { .num_edges = reader.num_edges };
+    uint32_t lengths[MAX_EDGES];
+    for (int e = 0; e < reader.num_edges && e < MAX_EDGES; e++) {
+        lengths[e] = led_capture_reader_edge_length(&reader, e);
+        topology.edges[e].length = (uint16_t)lengths[e];
+        topology.edges[e].start_offset = (uint16_t)(e ? topology.edges[e - 1].start_offset + lengths[e - 1] : 0);
+    }
+    if (reader.num_edges > MAX_EDGES || framebuffer_init(reader.num_edges, lengths) != pdPASS ||
+        !host_output_init(&topology, LED_WIRE_GRB)) {
+        fprintf(stderr, "unsupported layout\n");
+        return 1;
+    }
+
+    LedState_t* frame = calloc(reader.total_leds ? reader.total_leds : 1, sizeof(LedState_t));
+    LedState_t* golden = calloc(reader.total_leds ? reader.total_leds : 1, sizeof(LedState_t));
+    if (!frame || !golden) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint32_t frames = 0;
+    uint32_t first_ms = 0;
+    uint32_t last_ms = 0;
+    uint32_t frames_differing = 0;
+    int status = 0;
+    int result;
+    while ((result = led_capture_reader_next(&reader, frame, &last_ms)) == 1) {
+        if (frames == 0) first_ms = last_ms;
+
+        // Same hand-off as the render task: fill the back buffer, publish, present
+        const LedState_t* src = frame;
+        led_matrix_clear(nextLedConfigState);
+        for (int e = 0; e < reader.num_edges; e++) {
+            for (uint32_t i = 0; i < lengths[e]; i++) {
+                led_matrix_set_led(nextLedConfigState, e, (int)i, *src++);
+            }
+        }
+        framebuffer_swap();
+        host_output_present();
+
+        if (golden_path) {
+            uint32_t golden_ms = 0;
+            int golden_result = led_capture_reader_next(&golden_reader, golden, &golden_ms);
+            if (golden_result != 1) {
+                printf("golden ends after %u frames\n", frames);
+                status = 1;
+                golden_path = NULL;
+            } else if (golden_ms != last_ms) {
+                if (frames_differing++ == 0) {
+                    printf("frame %u: rendered at %u ms, golden at %u ms\n", frames, last_ms, golden_ms);
+                }
+            } else if (frames_differing == 0 ? report_difference(&reader, frames, last_ms, frame, golden)
+                                             : memcmp(frame, golden, reader.total_leds * sizeof(LedState_t)) != 0) {
+                frames_differing++;
+            }
+        }
+        frames++;
+    }
+    if (result < 0) {
+        printf("corrupt record after %u frames\n", frames);
+        status = 1;
+    }
+    if (golden_path && status == 0 && led_capture_reader_next(&golden_reader, golden, NULL) != 0) {
+        printf("golden has more than %u frames\n", frames);
+        status = 1;
+    }
+    if (frames_differing) {
+        printf("%u of %u frames differ\n", frames_differing, frames);
+        status = 1;
+    }
+
+    HostOutputStats output;
+    host_output_get_stats(&output);
+    size_t raw = (size_t)frames * reader.total_leds * sizeof(LedState_t);
+    printf("frames replayed:  %u (%u..%u ms)\n", frames, first_ms, last_ms);
+    printf("stream size:      %zu bytes (%.1f%% of %zu raw)\n",
+           reader.size, raw ? 100.0 * reader.size / raw : 0.0, raw);
+    printf("output checksum:  %08x\n", output.checksum);
+
+    free(frame);
+    free(golden);
+    free(data);
+    free(golden_data);
+    host_output_deinit();
+    framebuffer_cleanup();
+    return status;
+}
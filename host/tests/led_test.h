@@ -0,0 +1,29 @@
+#ifndef LED_TEST_H
+#define LED_TEST_H
+
+// Minimal assertions for the host tests: failures are counted and reported,
+// and led_test_result() turns them into the process exit status for ctest
+#include <stdio.h>
+
+static int led_test_failures;
+
+#define TEST_EXPECT(cond, ...) do { \
+    if (!(cond)) { \
+        if (led_test_failures++ < 20) { \
+            fprintf(stderr, "%s:%d: expected %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+        } \
+    } \
+} while (0)
+
+static inline int led_test_result(const char* name) {
+    if (led_test_failures) {
+        fprintf(stderr, "%s: %d failure(s)\n", name, led_test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif // LED_TEST_H
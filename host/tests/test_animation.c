@@ -0,0 +1,268 @@
+// Frame codec and animation images: frames must decode back to what was encoded,
+// whole or through a window, and truncated or corrupt frames, headers and index
+// entries must be refused rather than read past the data
+#include <stdlib.h>
+#include <string.h>
+#include "host_sim.h"
+#include "render_engine.h"
+#include "led_animation.h"
+#include "led_frame_codec.h"
+#include "led_test.h"
+
+#define CODEC_MAX_LEDS 300
+#define ANIM_LEDS 90
+#define ANIM_FRAMES 40
+#define ANIM_KEYFRAME 8
+
+static uint32_t rng = 0x19;
+
+static uint32_t next_random(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static int same_leds(const LedState_t* a, const LedState_t* b, uint32_t count) {
+    return memcmp(a, b, count * sizeof(LedState_t)) == 0;
+}
+
+// Next frame from the previous one: stretches left alone, filled with one color,
+// or made up of different colors, so every op and run length comes up
+static void next_frame(const LedState_t* previous, LedState_t* frame, uint32_t count) {
+    uint32_t i = 0;
+    while (i < count) {
+        uint32_t run = 1 + next_random() % 90;
+        if (run > count - i) run = count - i;
+        uint32_t kind = next_random() % 3;
+        LedState_t color = { (uint8_t)next_random(), (uint8_t)next_random(), (uint8_t)next_random(),
+                             (uint8_t)next_random() };
+        for (uint32_t j = i; j < i + run; j++) {
+            if (kind == 0) frame[j] = previous[j];
+            else if (kind == 1) frame[j] = color;
+            else frame[j] = (LedState_t){ (uint8_t)next_random(), (uint8_t)j, color.b, color.intensity };
+        }
+        i += run;
+    }
+}
+
+// ---- codec ----
+
+static void check_round_trip(const LedState_t* frame, const LedState_t* previous, uint32_t count) {
+    static uint8_t encoded[LED_CODEC_MAX_ENCODED_SIZE(CODEC_MAX_LEDS)];
+    static LedState_t decoded[CODEC_MAX_LEDS + 2];     // Room for guards around a window
+    bool keyframe = previous == NULL;
+
+    size_t size = led_frame_encode(frame, previous, count, encoded, sizeof(encoded));
+    TEST_EXPECT(size > 0 && size <= LED_CODEC_MAX_ENCODED_SIZE(count), "%u LEDs: encoded to %zu bytes", count, size);
+    TEST_EXPECT(led_frame_encode(frame, previous, count, encoded, size - 1) == 0,
+                "%u LEDs: encoded into %zu bytes of %zu", count, size - 1, size);
+    size = led_frame_encode(frame, previous, count, encoded, sizeof(encoded));
+
+    // Whole frame
+    if (previous) memcpy(decoded, previous, count * sizeof(LedState_t));
+    else memset(decoded, 0xEE, sizeof(decoded));
+    TEST_EXPECT(led_frame_decode(encoded, size, count, keyframe, decoded, 0, count) == (int)size,
+                "%u LEDs: encoding not consumed", count);
+    TEST_EXPECT(same_leds(decoded, frame, count), "%u LEDs: %s decoded differently", count,
+                keyframe ? "keyframe" : "delta");
+
+    // A window, with guards either side that must stay untouched
+    uint32_t start = next_random() % count;
+    uint32_t length = 1 + next_random() % (count - start);
+    LedState_t guard = { 0xDE, 0xAD, 0xBE, 0xEF };
+    decoded[0] = guard;
+    decoded[length + 1] = guard;
+    if (previous) memcpy(&decoded[1], &previous[start], length * sizeof(LedState_t));
+    TEST_EXPECT(led_frame_decode(encoded, size, count, keyframe, &decoded[1], start, length) == (int)size,
+                "%u LEDs: window [%u, +%u) not consumed", count, start, length);
+    TEST_EXPECT(same_leds(&decoded[1], &frame[start], length), "%u LEDs: window [%u, +%u) differs",
+                count, start, length);
+    TEST_EXPECT(same_leds(&decoded[0], &guard, 1) && same_leds(&decoded[length + 1], &guard, 1),
+                "%u LEDs: window [%u, +%u) wrote outside itself", count, start, length);
+
+    // Every truncation is refused
+    for (size_t cut = 0; cut < size; cut++) {
+        TEST_EXPECT(led_frame_decode(encoded, cut, count, keyframe, decoded, 0, count) < 0,
+                    "%u LEDs: %zu of %zu bytes decoded", count, cut, size);
+    }
+}
+
+static void test_codec(void) {
+    static const uint32_t counts[] = { 1, 2, 63, 64, 65, 128, 257, CODEC_MAX_LEDS };
+    static LedState_t frames[2][CODEC_MAX_LEDS];
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint32_t count = counts[c];
+        memset(frames, 0, sizeof(frames));
+        for (int f = 0; f < 50; f++) {
+            LedState_t* previous = frames[f & 1];
+            LedState_t* frame = frames[(f + 1) & 1];
+            next_frame(previous, frame, count);
+            check_round_trip(frame, NULL, count);
+            check_round_trip(frame, previous, count);
+        }
+    }
+}
+
+static void test_codec_corrupt(void) {
+    LedState_t window[8];
+    uint8_t skip[] = { LED_CODEC_OP_SKIP | 7 };
+    TEST_EXPECT(led_frame_decode(skip, sizeof(skip), 8, true, window, 0, 8) < 0, "keyframe with a skip decoded");
+    TEST_EXPECT(led_frame_decode(skip, sizeof(skip), 8, false, window, 0, 8) == 1, "delta skip refused");
+
+    uint8_t long_run[] = { LED_CODEC_OP_REPEAT | 8, 1, 2, 3, 4 };
+    TEST_EXPECT(led_frame_decode(long_run, sizeof(long_run), 8, true, window, 0, 8) < 0,
+                "run past the end of the frame decoded");
+    uint8_t short_frame[] = { LED_CODEC_OP_REPEAT | 6, 1, 2, 3, 4 };
+    TEST_EXPECT(led_frame_decode(short_frame, sizeof(short_frame), 8, true, window, 0, 8) < 0,
+                "frame covering too few LEDs decoded");
+    uint8_t bad_op[] = { LED_CODEC_OP_MASK | 7, 1, 2, 3, 4 };
+    TEST_EXPECT(led_frame_decode(bad_op, sizeof(bad_op), 8, false, window, 0, 8) < 0, "unknown op decoded");
+}
+
+// ---- animation images ----
+
+typedef struct {
+    uint8_t data[LED_ANIMATION_HEADER_SIZE + ANIM_FRAMES * 4 + ANIM_FRAMES * LED_CODEC_MAX_ENCODED_SIZE(ANIM_LEDS)];
+    size_t size;
+    uint32_t frames_size;
+    LedState_t frames[ANIM_FRAMES][ANIM_LEDS];
+} AnimationImage;
+
+static AnimationImage image;
+
+static void build_image(void) {
+    uint8_t* index = image.data + LED_ANIMATION_HEADER_SIZE;
+    uint8_t* frames = index + ANIM_FRAMES * 4;
+    static const LedState_t black[ANIM_LEDS];
+    uint32_t offset = 0;
+    for (int f = 0; f < ANIM_FRAMES; f++) {
+        next_frame(f ? image.frames[f - 1] : black, image.frames[f], ANIM_LEDS);
+        bool keyframe = f % ANIM_KEYFRAME == 0;
+        led_animation_write_index(&index[f * 4], offset, keyframe);
+        offset += (uint32_t)led_frame_encode(image.frames[f], keyframe ? NULL : image.frames[f - 1], ANIM_LEDS,
+                                             frames + offset, LED_CODEC_MAX_ENCODED_SIZE(ANIM_LEDS));
+    }
+    image.frames_size = offset;
+    image.size = LED_ANIMATION_HEADER_SIZE + ANIM_FRAMES * 4 + offset;
+    led_animation_write_header(image.data, ANIM_LEDS, 0, ANIM_FRAMES, 20, ANIM_KEYFRAME, offset);
+}
+
+static void test_animation_frames(void) {
+    LedAnimation animation;
+    TEST_EXPECT(led_animation_open(&animation, image.data, image.size) == pdPASS, "image refused");
+    if (!animation.data) return;
+
+    LedState_t decoded[ANIM_LEDS];
+    for (uint32_t f = 0; f < ANIM_FRAMES; f++) {
+        const uint8_t* data;
+        size_t size;
+        bool keyframe;
+        TEST_EXPECT(led_animation_frame(&animation, f, &data, &size, &keyframe), "frame %u missing", f);
+        TEST_EXPECT(keyframe == (f % ANIM_KEYFRAME == 0), "frame %u keyframe flag", f);
+        TEST_EXPECT(led_frame_decode(data, size, ANIM_LEDS, keyframe, decoded, 0, ANIM_LEDS) == (int)size,
+                    "frame %u not decoded", f);
+        TEST_EXPECT(same_leds(decoded, image.frames[f], ANIM_LEDS), "frame %u differs", f);
+    }
+    const uint8_t* data;
+    size_t size;
+    bool keyframe;
+    TEST_EXPECT(!led_animation_frame(&animation, ANIM_FRAMES, &data, &size, &keyframe), "frame past the end");
+    led_animation_close(&animation);
+}
+
+// Opens a copy of the image with one field rewritten
+static BaseType_t open_patched(size_t at, const uint8_t* bytes, size_t length, size_t size) {
+    static uint8_t copy[sizeof(image.data)];
+    memcpy(copy, image.data, image.size);
+    memcpy(&copy[at], bytes, length);
+    LedAnimation animation;
+    return led_animation_open(&animation, copy, size);
+}
+
+static BaseType_t open_with_u16(size_t at, uint16_t value) {
+    uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    return open_patched(at, bytes, sizeof(bytes), image.size);
+}
+
+static BaseType_t open_with_u32(size_t at, uint32_t value) {
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    return open_patched(at, bytes, sizeof(bytes), image.size);
+}
+
+static uint32_t frame_offset(uint32_t frame) {
+    const uint8_t* entry = &image.data[LED_ANIMATION_HEADER_SIZE + frame * 4];
+    uint32_t value = (uint32_t)entry[0] | ((uint32_t)entry[1] << 8) | ((uint32_t)entry[2] << 16) |
+                     ((uint32_t)entry[3] << 24);
+    return value & LED_ANIMATION_OFFSET_MASK;
+}
+
+static BaseType_t open_with_index(uint32_t frame, uint32_t offset, bool keyframe) {
+    uint8_t entry[4];
+    led_animation_write_index(entry, offset, keyframe);
+    return open_patched(LED_ANIMATION_HEADER_SIZE + frame * 4, entry, sizeof(entry), image.size);
+}
+
+static void test_animation_corrupt(void) {
+    LedAnimation animation;
+    for (size_t size = 0; size < image.size; size++) {
+        TEST_EXPECT(led_animation_open(&animation, image.data, size) == pdFAIL, "image cut to %zu bytes opened", size);
+    }
+
+    // Header fields, by offset (see led_animation_write_header)
+    TEST_EXPECT(open_with_u32(0, 0x4144454Du) == pdFAIL, "bad magic opened");
+    TEST_EXPECT(open_with_u16(4, LED_ANIMATION_VERSION + 1) == pdFAIL, "newer version opened");
+    TEST_EXPECT(open_with_u16(6, LED_ANIMATION_HEADER_SIZE - 1) == pdFAIL, "short header opened");
+    TEST_EXPECT(open_with_u16(6, 0xFFFF) == pdFAIL, "header past the end opened");
+    TEST_EXPECT(open_with_u16(8, 0) == pdFAIL, "no LEDs opened");
+    TEST_EXPECT(open_with_u32(12, 0) == pdFAIL, "no frames opened");
+    TEST_EXPECT(open_with_u32(12, 0x40000000u) == pdFAIL, "index past the end opened");
+    TEST_EXPECT(open_with_u32(16, 0) == pdFAIL, "frame period 0 opened");
+    TEST_EXPECT(open_with_u32(20, 0) == pdFAIL, "keyframe interval 0 opened");
+    TEST_EXPECT(open_with_u32(24, image.frames_size + 1) == pdFAIL, "frames past the end opened");
+
+    // Index entries
+    TEST_EXPECT(open_with_index(0, 0, false) == pdFAIL, "delta first frame opened");
+    TEST_EXPECT(open_with_index(ANIM_KEYFRAME, frame_offset(ANIM_KEYFRAME), false) == pdFAIL,
+                "missing keyframe opened");
+    TEST_EXPECT(open_with_index(ANIM_FRAMES - 1, image.frames_size + 1, false) == pdFAIL,
+                "offset past the frames opened");
+    TEST_EXPECT(open_with_index(ANIM_FRAMES - 1, frame_offset(ANIM_FRAMES - 2) - 1, false) == pdFAIL,
+                "offset going back opened");
+    TEST_EXPECT(open_with_u16(8, ANIM_LEDS) == pdPASS, "unchanged image refused");
+}
+
+// A frame that does not decode stops the pattern instead of drawing garbage
+static void test_animation_pattern(void) {
+    static uint8_t copy[sizeof(image.data)];
+    memcpy(copy, image.data, image.size);
+    LedAnimation animation;
+    led_animation_open(&animation, copy, image.size);
+    const uint8_t* data;
+    size_t size;
+    bool keyframe;
+    led_animation_frame(&animation, 3, &data, &size, &keyframe);
+    copy[data - copy] = LED_CODEC_OP_MASK;
+
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller) return;
+    int id = led_pattern_animation(controller, 0, 0, ANIM_LEDS - 1, &animation, 0, false);
+    TEST_EXPECT(id >= 0, "animation pattern refused");
+    host_sim_run(20 * ANIM_FRAMES, 20);
+    if (id >= 0) {
+        const AnimationParams* params = (const AnimationParams*)controller->patterns[id & PATTERN_HANDLE_SLOT_MASK].params;
+        TEST_EXPECT(params->failed, "corrupt frame played");
+    }
+    host_sim_deinit();
+    led_animation_close(&animation);
+}
+
+int main(void) {
+    test_codec();
+    test_codec_corrupt();
+    build_image();
+    test_animation_frames();
+    test_animation_corrupt();
+    test_animation_pattern();
+    return led_test_result("test_animation");
+}
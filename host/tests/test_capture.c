@@ -0,0 +1,263 @@
+// Frame capture streams: frames recorded to a sink or the RAM ring must read back
+// exactly, and streams cut short or with a corrupt header or record must be
+// refused by the reader rather than decoded past the data
+#include <stdlib.h>
+#include <string.h>
+#include "framebuffer.h"
+#include "render_engine.h"
+#include "led_capture.h"
+#include "led_frame_codec.h"
+#include "led_test.h"
+
+#define CAPTURE_EDGES 3
+#define CAPTURE_FRAMES (2 * LED_CAPTURE_KEYFRAME_INTERVAL + 20)
+#define CAPTURE_LEDS (40 + 17 + 64)
+#define RING_CAPACITY 4096
+#define STREAM_MAX (1 << 16)    // Largest stream the corruption tests copy
+
+static uint32_t edge_lengths[CAPTURE_EDGES] = { 40, 17, 64 };
+static LedState_t frames[CAPTURE_FRAMES][CAPTURE_LEDS];
+
+static uint32_t rng = 0x20;
+
+static uint32_t next_random(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Growing memory sink, optionally refusing writes past a limit
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    size_t limit;               // 0: no limit
+} MemorySink;
+
+static bool memory_write(void* context, const void* data, size_t size) {
+    MemorySink* sink = (MemorySink*)context;
+    if (sink->limit && sink->size + size > sink->limit) return false;
+    if (sink->size + size > sink->capacity) {
+        size_t capacity = sink->capacity ? sink->capacity * 2 : 4096;
+        while (capacity < sink->size + size) capacity *= 2;
+        uint8_t* grown = realloc(sink->data, capacity);
+        if (!grown) return false;
+        sink->data = grown;
+        sink->capacity = capacity;
+    }
+    memcpy(sink->data + sink->size, data, size);
+    sink->size += size;
+    return true;
+}
+
+static LedCaptureSink memory_sink(MemorySink* sink) {
+    return (LedCaptureSink){ .write = memory_write, .context = sink };
+}
+
+// Mostly unchanged LEDs with a moving block and some noise, like rendered output
+static void build_frames(void) {
+    for (int f = 0; f < CAPTURE_FRAMES; f++) {
+        for (int i = 0; i < CAPTURE_LEDS; i++) {
+            LedState_t color = f ? frames[f - 1][i] : (LedState_t){ 10, 20, 30, 255 };
+            if (i >= f % CAPTURE_LEDS && i < f % CAPTURE_LEDS + 8) color = (LedState_t){ 255, (uint8_t)f, 0, 200 };
+            if (next_random() % 16 == 0) color.r = (uint8_t)next_random();
+            frames[f][i] = color;
+        }
+    }
+}
+
+// Frame f into a cleared back buffer, edge after edge, and through the capture hook
+static void capture_frame(int f) {
+    const LedState_t* src = frames[f];
+    framebuffer_clear_next();
+    for (int e = 0; e < CAPTURE_EDGES; e++) {
+        for (uint32_t i = 0; i < edge_lengths[e]; i++) led_matrix_set_led(nextLedConfigState, e, (int)i, *src++);
+    }
+    led_capture_frame(nextLedConfigState, (uint32_t)f * 20);
+}
+
+// Frames the last read_stream decoded, before any error
+static int frames_read;
+
+// Reads a stream through, checking each frame against the one its time stamps;
+// returns the frames read, or -1 if the reader refused the stream
+static int read_stream(const uint8_t* data, size_t size, int first_frame) {
+    LedCaptureReader reader;
+    frames_read = 0;
+    if (led_capture_reader_open(&reader, data, size) != pdPASS) return -1;
+    TEST_EXPECT(reader.num_edges == CAPTURE_EDGES && reader.total_leds == CAPTURE_LEDS,
+                "%d edges, %u LEDs", reader.num_edges, reader.total_leds);
+    for (int e = 0; e < CAPTURE_EDGES; e++) {
+        TEST_EXPECT(led_capture_reader_edge_length(&reader, e) == edge_lengths[e], "edge %d length", e);
+    }
+
+    static LedState_t frame[CAPTURE_LEDS];
+    int count = 0;
+    int result;
+    uint32_t time_ms;
+    while ((result = led_capture_reader_next(&reader, frame, &time_ms)) == 1) {
+        int f = (int)(time_ms / 20);
+        TEST_EXPECT(f == first_frame + count, "frame %d stamped %u ms", first_frame + count, time_ms);
+        if (f >= 0 && f < CAPTURE_FRAMES) {
+            TEST_EXPECT(memcmp(frame, frames[f], sizeof(frame)) == 0, "frame %d read back differently", f);
+        }
+        frames_read = ++count;
+    }
+    return result < 0 ? -1 : count;
+}
+
+static void test_round_trip(MemorySink* stream) {
+    LedCaptureSink sink = memory_sink(stream);
+    TEST_EXPECT(led_capture_start(nextLedConfigState, &sink) == pdPASS, "capture not started");
+    for (int f = 0; f < CAPTURE_FRAMES; f++) capture_frame(f);
+    TEST_EXPECT(led_capture_frames() == CAPTURE_FRAMES, "%u frames captured", led_capture_frames());
+    led_capture_stop();
+    TEST_EXPECT(!led_capture_active(), "capture still running");
+
+    int count = read_stream(stream->data, stream->size, 0);
+    TEST_EXPECT(count == CAPTURE_FRAMES, "%d frames read", count);
+}
+
+// The ring keeps the newest records; a dump starts at its oldest keyframe
+static void test_ring(void) {
+    LedCaptureRing ring;
+    TEST_EXPECT(led_capture_ring_init(&ring, RING_CAPACITY) == pdPASS, "ring not created");
+    LedCaptureSink ring_sink = led_capture_ring_sink(&ring);
+    TEST_EXPECT(led_capture_start(nextLedConfigState, &ring_sink) == pdPASS, "ring capture not started");
+    for (int f = 0; f < CAPTURE_FRAMES; f++) capture_frame(f);
+    led_capture_stop();
+    TEST_EXPECT(ring.records_dropped > 0, "ring of %d bytes kept all %d frames", RING_CAPACITY, CAPTURE_FRAMES);
+
+    MemorySink dump = { 0 };
+    LedCaptureSink dump_sink = memory_sink(&dump);
+    uint32_t written = led_capture_ring_dump(&ring, &dump_sink);
+    int first = CAPTURE_FRAMES - (int)written;
+    TEST_EXPECT(written > 0 && first % LED_CAPTURE_KEYFRAME_INTERVAL == 0, "%u frames dumped", written);
+    TEST_EXPECT(read_stream(dump.data, dump.size, first) == (int)written, "dump read back differently");
+    free(dump.data);
+    led_capture_ring_deinit(&ring);
+}
+
+// A sink that stops taking records stops the capture; so does a new layout
+static void test_capture_stops(void) {
+    MemorySink limited = { .limit = 2048 };
+    LedCaptureSink sink = memory_sink(&limited);
+    TEST_EXPECT(led_capture_start(nextLedConfigState, &sink) == pdPASS, "capture not started");
+    for (int f = 0; f < CAPTURE_FRAMES && led_capture_active(); f++) capture_frame(f);
+    TEST_EXPECT(!led_capture_active(), "capture ran on into a full sink");
+    int count = read_stream(limited.data, limited.size, 0);
+    TEST_EXPECT(count > 0 && count == (int)led_capture_frames(), "%d frames read of %u", count, led_capture_frames());
+    free(limited.data);
+
+    MemorySink stream = { 0 };
+    sink = memory_sink(&stream);
+    TEST_EXPECT(led_capture_start(nextLedConfigState, &sink) == pdPASS, "capture not started");
+    uint32_t other_lengths[CAPTURE_EDGES] = { 40, 17, 63 };
+    LedEdgeConfigState_t other = *nextLedConfigState;
+    other.num_led_per_edge = other_lengths;
+    led_capture_frame(&other, 0);
+    TEST_EXPECT(!led_capture_active(), "capture kept running after the layout changed");
+    free(stream.data);
+
+    LedEdgeConfigState_t empty = { .num_edges = 0 };
+    TEST_EXPECT(led_capture_start(NULL, &sink) == pdFAIL, "capture started without a layout");
+    TEST_EXPECT(led_capture_start(&empty, &sink) == pdFAIL, "capture started without edges");
+    LedCaptureSink no_write = { 0 };
+    TEST_EXPECT(led_capture_start(nextLedConfigState, &no_write) == pdFAIL, "capture started without a sink");
+}
+
+// ---- corrupt streams ----
+
+static uint8_t* patched(const MemorySink* stream, size_t at, uint32_t value, size_t bytes) {
+    static uint8_t copy[STREAM_MAX];
+    memcpy(copy, stream->data, stream->size);
+    for (size_t i = 0; i < bytes; i++) copy[at + i] = (uint8_t)(value >> (8 * i));
+    return copy;
+}
+
+static void test_corrupt_header(const MemorySink* stream) {
+    size_t header_size = LED_CAPTURE_HEADER_SIZE(CAPTURE_EDGES);
+    LedCaptureReader reader;
+    for (size_t size = 0; size < header_size; size++) {
+        TEST_EXPECT(led_capture_reader_open(&reader, stream->data, size) == pdFAIL,
+                    "header cut to %zu bytes opened", size);
+    }
+
+    // Header fields, by offset (see LED_CAPTURE_HEADER_SIZE)
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 0, 0x4344454Du, 4), stream->size) == pdFAIL,
+                "bad magic opened");
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 4, LED_CAPTURE_VERSION + 1, 2), stream->size) == pdFAIL,
+                "newer version opened");
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 6, header_size - 1, 2), stream->size) == pdFAIL,
+                "header shorter than its edges opened");
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 6, 0xFFFF, 2), stream->size) == pdFAIL,
+                "header past the end opened");
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 8, 0, 1), stream->size) == pdFAIL,
+                "no edges opened");
+    TEST_EXPECT(led_capture_reader_open(&reader, patched(stream, 8, CAPTURE_EDGES + 1, 1), stream->size) == pdFAIL,
+                "more edges than the header holds opened");
+}
+
+// Bytes of the record at `at`, its header included
+static size_t record_size(const uint8_t* data, size_t at) {
+    const uint8_t* entry = &data[at + 4];
+    uint32_t value = (uint32_t)entry[0] | ((uint32_t)entry[1] << 8) | ((uint32_t)entry[2] << 16) |
+                     ((uint32_t)entry[3] << 24);
+    return LED_CAPTURE_RECORD_HEADER_SIZE + (value & LED_CAPTURE_SIZE_MASK);
+}
+
+static void test_corrupt_records(const MemorySink* stream) {
+    size_t header_size = LED_CAPTURE_HEADER_SIZE(CAPTURE_EDGES);
+    size_t first_record = record_size(stream->data, header_size);
+    size_t second = header_size + first_record;
+
+    // Cut anywhere in the first few records: whole records read, then an error,
+    // except at a record boundary where the stream just ends
+    size_t boundary = header_size;
+    int records = 0;
+    for (size_t size = header_size; size <= second + 3 * LED_CAPTURE_RECORD_HEADER_SIZE; size++) {
+        if (size == boundary + record_size(stream->data, boundary)) {
+            boundary = size;
+            records++;
+        }
+        int count = read_stream(stream->data, size, 0);
+        TEST_EXPECT(count == (size == boundary ? records : -1) && frames_read == records,
+                    "stream cut to %zu bytes: %d frames", size, frames_read);
+    }
+
+    // A delta first: the first record dropped from the stream
+    static uint8_t spliced[STREAM_MAX];
+    memcpy(spliced, stream->data, header_size);
+    memcpy(spliced + header_size, stream->data + second, stream->size - second);
+    TEST_EXPECT(read_stream(spliced, stream->size - first_record, 1) == -1, "stream starting on a delta read");
+
+    // Record sizes that do not match the frame
+    uint32_t entry = (uint32_t)(first_record - LED_CAPTURE_RECORD_HEADER_SIZE) | LED_CAPTURE_KEYFRAME;
+    TEST_EXPECT(read_stream(patched(stream, header_size + 4, entry + 1, 4), second + 1, 0) == -1,
+                "record longer than its frame read");
+    TEST_EXPECT(read_stream(patched(stream, header_size + 4, entry - 1, 4), stream->size, 0) == -1,
+                "record shorter than its frame read");
+    TEST_EXPECT(read_stream(patched(stream, header_size + 4, LED_CAPTURE_KEYFRAME | LED_CAPTURE_SIZE_MASK, 4),
+                            stream->size, 0) == -1, "record past the end read");
+    TEST_EXPECT(read_stream(patched(stream, header_size + LED_CAPTURE_RECORD_HEADER_SIZE, LED_CODEC_OP_MASK, 1),
+                            stream->size, 0) == -1, "record with a bad op read");
+}
+
+int main(void) {
+    build_frames();
+    if (framebuffer_init(CAPTURE_EDGES, edge_lengths) != pdPASS) return 1;
+
+    MemorySink stream = { 0 };
+    test_round_trip(&stream);
+    test_ring();
+    test_capture_stops();
+    TEST_EXPECT(stream.size <= STREAM_MAX, "stream of %zu bytes", stream.size);
+    if (stream.size <= STREAM_MAX) {
+        test_corrupt_header(&stream);
+        test_corrupt_records(&stream);
+    }
+    free(stream.data);
+    framebuffer_cleanup();
+    return led_test_result("test_capture");
+}
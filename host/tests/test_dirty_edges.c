@@ -0,0 +1,104 @@
+// Partial frames: with one edge per output channel, frames must only redraw and
+// repack what changed, yet every packed frame must match a full pack of the frame
+// shown, also when the display misses frames, and an edge whose patterns never
+// change must keep its first pixels even when a layer on it is redrawn
+//     test_dirty_edges [frames]
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+#include "host_sim.h"
+#include "host_output.h"
+#include "framebuffer.h"
+#include "render_engine.h"
+#include "led_test.h"
+
+#define DIRTY_EDGES 4
+#define DIRTY_LEDS 20
+#define DIRTY_FRAMES 3000u
+#define DIRTY_STEP_MS 10
+
+static const LedTopology topology = {
+    .num_edges = DIRTY_EDGES,
+    .edges = {
+        { .length = DIRTY_LEDS, .channel = 0 },
+        { .length = DIRTY_LEDS, .channel = 1 },
+        { .length = DIRTY_LEDS, .channel = 2 },
+        { .length = DIRTY_LEDS, .channel = 3, .reversed = true },
+    },
+};
+
+static uint8_t expected[DIRTY_EDGES * DIRTY_LEDS * 3];
+
+// Edge 0 static, edges 1 and 2 comets stepping at different times, so a missed
+// frame's changes are often on another channel than the next frame's. Edge 3 has
+// a static background and an added layer also shown on edge 1, so each step of
+// that comet redraws it unchanged.
+static void create_scene(LEDController* controller) {
+    led_pattern_static(controller, 0, 0, DIRTY_LEDS - 1, led_color_create(30, 60, 90, 255));
+    led_pattern_shift_comet(controller, 1, 0, DIRTY_LEDS - 1, led_color_create(200, 0, 0, 255), 3, 30);
+    led_pattern_shift_comet(controller, 2, 0, DIRTY_LEDS - 1, led_color_create(0, 200, 0, 255), 4, 40);
+    led_pattern_static(controller, 3, 0, DIRTY_LEDS - 1, led_color_create(10, 10, 10, 255));
+
+    int shared = led_pattern_static(controller, 3, 2, 9, led_color_create(40, 40, 40, 255));
+    LedSegment segments[] = {
+        { 3, SEGMENT_FORWARD, 2, 9 },
+        { 1, SEGMENT_FORWARD, 12, 19 },
+    };
+    led_pattern_set_segments(controller, shared, segments, 2);
+    led_pattern_set_blend(controller, shared, BLEND_ADD);
+    led_pattern_set_z_order(controller, shared, 1);
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : DIRTY_FRAMES;
+
+    LEDController* controller = host_sim_init(&topology);
+    if (!controller) return 1;
+    LedTopologyMap map;
+    if (!led_topology_build_map(&topology, &map)) return 1;
+    const LedPackConfig pack_config = { .format = LED_WIRE_GRB };
+
+    create_scene(controller);
+    LedState_t edge3[DIRTY_LEDS];
+    bool have_edge3 = false;
+    uint32_t presented = 0;
+
+    for (uint32_t f = 0; f < frames && led_test_failures == 0; f++) {
+        host_clock_advance_ms(DIRTY_STEP_MS);
+        led_controller_update(controller, host_clock_ms());
+        // Every fourth frame is never picked up (with edge 2's steps on it and some
+        // of edge 1's right after): its changes must reach the next one
+        if (f % 4 == 0) continue;
+        if (!host_output_present()) continue;
+        presented++;
+
+        LedEdgeConfigState_t* frame = currentLedConfigState;
+        size_t length = 0;
+        const uint8_t* wire = host_output_last_frame(&length);
+        size_t full = led_pack_gather(frame, map.source, map.physical_count, &pack_config,
+                                      expected, sizeof(expected));
+        TEST_EXPECT(length == full && memcmp(wire, expected, full) == 0,
+                    "frame %u: packed bytes differ from a full pack", f);
+
+        for (int i = 0; i < DIRTY_LEDS; i++) {
+            LedState_t color = led_matrix_get_led(frame, 3, i);
+            if (!have_edge3) edge3[i] = color;
+            TEST_EXPECT(memcmp(&color, &edge3[i], sizeof(color)) == 0,
+                        "frame %u: edge 3 LED %d went from %d,%d,%d to %d,%d,%d", f, i,
+                        edge3[i].r, edge3[i].g, edge3[i].b, color.r, color.g, color.b);
+        }
+        have_edge3 = true;
+    }
+
+    HostOutputStats stats;
+    host_output_get_stats(&stats);
+    TEST_EXPECT(stats.frames_sent == presented, "%u frames sent, %u presented", stats.frames_sent, presented);
+    TEST_EXPECT(presented > 0 && stats.channels_packed >= DIRTY_EDGES, "%u channels packed", stats.channels_packed);
+    // Each comet (edge 3 along with edge 1's) steps on some frames, edge 0 only once
+    TEST_EXPECT(stats.channels_packed < 3 * stats.frames_sent, "%u channels packed over %u frames",
+                stats.channels_packed, stats.frames_sent);
+
+    led_topology_free_map(&map);
+    host_sim_deinit();
+    return led_test_result("test_dirty_edges");
+}
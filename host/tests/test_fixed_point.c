@@ -0,0 +1,208 @@
+// Q16.16 color and pattern math against the float math it replaced (the
+// LED_FIXED_POINT=0 expressions, restated here): every channel must be within
+// 1 LSB across the input range
+#include <math.h>
+#include <stdlib.h>
+#include "host_sim.h"
+#include "render_engine.h"
+#include "led_test.h"
+
+static int worst_error;
+
+static void expect_close(const char* what, int got, int want, int a, int b) {
+    int error = abs(got - want);
+    if (error > worst_error) worst_error = error;
+    TEST_EXPECT(error <= 1, "%s(%d, %d): %d, float gives %d", what, a, b, got, want);
+}
+
+static void expect_color_close(const char* what, LedState_t got, LedState_t want, int a, int b) {
+    expect_close(what, got.r, want.r, a, b);
+    expect_close(what, got.g, want.g, a, b);
+    expect_close(what, got.b, want.b, a, b);
+    expect_close(what, got.intensity, want.intensity, a, b);
+}
+
+// ---- float reference ----
+
+static uint8_t float_lerp(uint8_t start, uint8_t end, float t) {
+    return (uint8_t)(start + t * (end - start));
+}
+
+static LedState_t float_interpolate(LedState_t start, LedState_t end, float t) {
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    return (LedState_t){ float_lerp(start.r, end.r, t), float_lerp(start.g, end.g, t),
+                         float_lerp(start.b, end.b, t), float_lerp(start.intensity, end.intensity, t) };
+}
+
+static LedState_t float_scale(LedState_t color, float scale) {
+    if (scale < 0.0f) scale = 0.0f;
+    if (scale > 1.0f) scale = 1.0f;
+    return (LedState_t){ (uint8_t)(color.r * scale), (uint8_t)(color.g * scale),
+                         (uint8_t)(color.b * scale), (uint8_t)(color.intensity * scale) };
+}
+
+// ---- color math ----
+
+static void test_interpolate(void) {
+    // Every start/end pair at every 1/256, on a different channel each
+    for (int start = 0; start < 256; start++) {
+        for (int end = 0; end < 256; end++) {
+            LedState_t a = { (uint8_t)start, (uint8_t)end, (uint8_t)(255 - start), (uint8_t)(start ^ end) };
+            LedState_t b = { (uint8_t)end, (uint8_t)start, (uint8_t)(255 - end), (uint8_t)(end ^ 0x5A) };
+            for (uint32_t t_q16 = 0; t_q16 <= LED_Q16_ONE; t_q16 += 256) {
+                expect_color_close("interpolate", led_color_interpolate_q16(a, b, t_q16),
+                                   float_interpolate(a, b, (float)t_q16 / LED_Q16_ONE), start * 256 + end, (int)t_q16);
+            }
+        }
+    }
+    // Every Q16 fraction on the widest ranges, both ways
+    LedState_t dark = { 0, 255, 0, 1 };
+    LedState_t light = { 255, 0, 254, 255 };
+    for (uint32_t t_q16 = 0; t_q16 <= LED_Q16_ONE; t_q16++) {
+        float t = (float)t_q16 / LED_Q16_ONE;
+        expect_color_close("interpolate", led_color_interpolate_q16(dark, light, t_q16),
+                           float_interpolate(dark, light, t), 0, (int)t_q16);
+        expect_color_close("interpolate", led_color_interpolate_q16(light, dark, t_q16),
+                           float_interpolate(light, dark, t), 1, (int)t_q16);
+    }
+}
+
+static void test_scale(void) {
+    for (int value = 0; value < 256; value++) {
+        LedState_t color = { (uint8_t)value, (uint8_t)(255 - value), (uint8_t)(value ^ 0xA5), (uint8_t)(value / 2) };
+        for (uint32_t scale_q16 = 0; scale_q16 <= LED_Q16_ONE; scale_q16++) {
+            expect_color_close("scale", led_color_scale_q16(color, scale_q16),
+                               float_scale(color, (float)scale_q16 / LED_Q16_ONE), value, (int)scale_q16);
+        }
+    }
+}
+
+// ---- patterns, rendered straight through their class into a one-edge frame ----
+
+static LedState_t frame_pixels[MAX_LEDS_PER_EDGE];
+static LedState_t* frame_rows[1] = { frame_pixels };
+static uint32_t frame_length = MAX_LEDS_PER_EDGE;
+static LedEdgeConfigState_t frame = {
+    .num_edges = 1, .num_led_per_edge = &frame_length, .data = frame_rows,
+};
+
+static Pattern* pattern_of(LEDController* controller, int id) {
+    TEST_EXPECT(id >= 0, "pattern not created");
+    return id >= 0 ? &controller->patterns[id & PATTERN_HANDLE_SLOT_MASK] : NULL;
+}
+
+static void render(Pattern* pattern, uint32_t time) {
+    pattern->pattern_class->render(&frame, pattern, time);
+}
+
+static void test_fade(LEDController* controller) {
+    static const uint32_t durations[] = { 1, 3, 255, 1000, 4099, 65535 };
+    LedState_t from = { 255, 0, 30, 255 };
+    LedState_t to = { 0, 255, 200, 0 };
+    for (size_t d = 0; d < sizeof(durations) / sizeof(durations[0]); d++) {
+        int id = led_pattern_fade(controller, 0, 0, 0, from, to, durations[d]);
+        Pattern* pattern = pattern_of(controller, id);
+        if (!pattern) continue;
+        uint32_t step = durations[d] / 4096 + 1;
+        for (uint32_t time = 0; time <= durations[d] + 1; time += step) {
+            render(pattern, time);
+            float t = (float)time / (float)durations[d];
+            expect_color_close("fade", frame_pixels[0], float_interpolate(from, to, t > 1.0f ? 1.0f : t),
+                               (int)durations[d], (int)time);
+        }
+        led_pattern_remove(controller, id);
+        led_controller_update(controller, 0);
+    }
+}
+
+static void test_pulse(LEDController* controller) {
+    static const uint32_t periods[] = { 1, 7, 256, 1000, 3001 };
+    static const uint8_t peaks[] = { 1, 128, 255 };
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        for (size_t k = 0; k < sizeof(peaks) / sizeof(peaks[0]); k++) {
+            int id = led_pattern_pulse(controller, 0, 0, 0, (LedState_t){ 10, 20, 30, 40 }, peaks[k], periods[p]);
+            Pattern* pattern = pattern_of(controller, id);
+            if (!pattern) continue;
+            for (uint32_t time = 0; time < 2 * periods[p]; time++) {
+                render(pattern, time);
+                float phase = (float)(time % periods[p]) / (float)periods[p];
+                float factor = (sinf(2.0f * M_PI * phase) + 1.0f) / 2.0f;
+                expect_close("pulse", frame_pixels[0].intensity, (uint8_t)(peaks[k] * factor),
+                             (int)periods[p], (int)time);
+            }
+            led_pattern_remove(controller, id);
+            led_controller_update(controller, 0);
+        }
+    }
+}
+
+static void test_gradient(LEDController* controller) {
+    LedState_t from = { 0, 255, 7, 255 };
+    LedState_t to = { 255, 0, 250, 3 };
+    for (int count = 2; count <= MAX_LEDS_PER_EDGE; count++) {
+        int id = led_pattern_gradient(controller, 0, 0, count - 1, from, to);
+        Pattern* pattern = pattern_of(controller, id);
+        if (!pattern) continue;
+        render(pattern, 0);
+        for (int i = 0; i < count; i++) {
+            float t = (float)i / (float)(count - 1);
+            expect_color_close("gradient", frame_pixels[i], float_interpolate(from, to, t), count, i);
+        }
+        led_pattern_remove(controller, id);
+        led_controller_update(controller, 0);
+    }
+}
+
+static void test_comet(LEDController* controller) {
+    LedState_t color = { 255, 200, 99, 255 };
+    for (int length = 1; length <= 64; length++) {
+        int id = led_pattern_shift_comet(controller, 0, 0, MAX_LEDS_PER_EDGE - 1, color, length, 100);
+        Pattern* pattern = pattern_of(controller, id);
+        if (!pattern) continue;
+        const ShiftParams* params = (const ShiftParams*)pattern->params;
+        for (int i = 0; i < length; i++) {
+            float intensity = (float)(length - i) / (float)length;
+            expect_color_close("comet", params->colors[i], float_scale(color, intensity), length, i);
+        }
+        led_pattern_remove(controller, id);
+        led_controller_update(controller, 0);
+    }
+}
+
+static void test_palette_lut(LEDController* controller) {
+    for (int count = 1; count <= MAX_PALETTE_COLORS; count++) {
+        ColorPalette palette = led_palette_rainbow(count);
+        for (int c = 0; c < count; c++) palette.colors[c].intensity = (uint8_t)(255 - c * 7);
+        int id = led_pattern_palette_cycle(controller, 0, 0, 15, palette, 1000, 0);
+        Pattern* pattern = pattern_of(controller, id);
+        if (!pattern) continue;
+        const PaletteCycleParams* params = (const PaletteCycleParams*)pattern->params;
+        for (int k = 0; k < PALETTE_CYCLE_LUT_SIZE; k++) {
+            float color_pos = (float)k / (float)PALETTE_CYCLE_LUT_SIZE * (float)(count - 1);
+            int color_idx = (int)color_pos;
+            LedState_t want = float_interpolate(palette.colors[color_idx % count],
+                                                palette.colors[(color_idx + 1) % count], color_pos - color_idx);
+            expect_color_close("palette", params->lut[k], want, count, k);
+        }
+        led_pattern_remove(controller, id);
+        led_controller_update(controller, 0);
+    }
+}
+
+int main(void) {
+    test_interpolate();
+    test_scale();
+
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller) return 1;
+    test_fade(controller);
+    test_pulse(controller);
+    test_gradient(controller);
+    test_comet(controller);
+    test_palette_lut(controller);
+    host_sim_deinit();
+
+    printf("largest difference: %d LSB\n", worst_error);
+    return led_test_result("test_fixed_point");
+}
@@ -0,0 +1,80 @@
+// Pattern parameters that cannot be rendered are refused when the pattern is
+// created, directly or from a timeline, without using up a slot; degenerate ones
+// that can be rendered settle instead of redrawing every frame
+#include "host_port.h"
+#include "host_sim.h"
+#include "render_engine.h"
+#include "led_timeline.h"
+#include "led_test.h"
+
+static const LedState_t color = { 255, 100, 0, 255 };
+
+static void test_zero_periods(LEDController* controller) {
+    LedState_t colors[3] = { color, color, color };
+    TEST_EXPECT(led_pattern_pulse(controller, 0, 0, 14, color, 255, 0) < 0, "pulse with period 0 created");
+    TEST_EXPECT(led_pattern_blink(controller, 0, 0, 14, color, 0, 0, 0) < 0, "blink with period 0 created");
+    TEST_EXPECT(led_pattern_shift(controller, 0, 0, 14, colors, 3, 0, 0) < 0, "shift with period 0 created");
+    TEST_EXPECT(led_pattern_palette_cycle(controller, 0, 0, 14, led_palette_rainbow(4), 0, 0) < 0,
+                "palette cycle with period 0 created");
+
+    // None of them kept a slot
+    int ids[MAX_PATTERNS];
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        ids[i] = led_pattern_pulse(controller, i % 4, 0, 14, color, 255, 1000);
+        TEST_EXPECT(ids[i] >= 0, "slot %d lost", i);
+    }
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        if (ids[i] >= 0) led_pattern_remove(controller, ids[i]);
+    }
+    host_sim_step(20);
+    host_sim_step(20);
+}
+
+static void test_timeline_periods(LEDController* controller) {
+    static const uint8_t periodic[] = { PATTERN_BLINK, PATTERN_PULSE, PATTERN_SHIFT, PATTERN_PALETTE_CYCLE };
+    for (size_t i = 0; i < sizeof(periodic) / sizeof(periodic[0]); i++) {
+        LedTimelineEvent events[2] = {
+            { .at_ms = 0, .op = TIMELINE_SET, .edge = 0, .pattern = periodic[i], .color = color, .arg = 3 },
+            { .at_ms = 100, .op = TIMELINE_END },
+        };
+        TEST_EXPECT(!led_timeline_validate(events, 2), "timeline pattern %d with period 0 accepted", periodic[i]);
+        TEST_EXPECT(led_timeline_play(controller, events, 2) == pdFAIL, "timeline pattern %d played", periodic[i]);
+
+        events[0].period_ms = 500;
+        TEST_EXPECT(led_timeline_validate(events, 2), "timeline pattern %d with a period refused", periodic[i]);
+    }
+}
+
+// A zero-length fade is finished from the start: drawn once, then left alone
+static void test_zero_fade(LEDController* controller) {
+    LedState_t end = { 0, 0, 255, 200 };
+    int id = led_pattern_fade(controller, 1, 0, 14, color, end, 0);
+    TEST_EXPECT(id >= 0, "fade with duration 0 refused");
+    host_sim_step(20);
+    host_sim_step(20);
+
+    HostSimStats before, after;
+    host_sim_get_stats(&before);
+    host_sim_run(1000, 20);
+    host_sim_get_stats(&after);
+    TEST_EXPECT(after.frames_rendered == before.frames_rendered, "%u frames rendered for a finished fade",
+                after.frames_rendered - before.frames_rendered);
+    TEST_EXPECT(led_controller_frame_delay_ms(controller, host_clock_ms(), 20) == LED_NEVER,
+                "finished fade still schedules frames");
+    led_pattern_remove(controller, id);
+    host_sim_step(20);
+}
+
+int main(void) {
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller) return 1;
+    test_zero_periods(controller);
+    test_timeline_periods(controller);
+    test_zero_fade(controller);
+
+    // A pulse still renders through its init
+    TEST_EXPECT(led_pattern_pulse(controller, 0, 0, 14, color, 255, 1000) >= 0, "pulse refused");
+    host_sim_run(2000, 20);
+    host_sim_deinit();
+    return led_test_result("test_pattern_config");
+}
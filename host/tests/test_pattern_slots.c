@@ -0,0 +1,223 @@
+// Pattern slot soak: a million create/remove cycles over the arena-backed pattern
+// types must leave the free slot list, command pool and arena exactly as full as
+// they started, and a handle must stop reaching its slot once it is removed
+//     test_pattern_slots [cycles]
+#include <stdlib.h>
+#include "host_port.h"
+#include "host_sim.h"
+#include "render_engine.h"
+#include "led_test.h"
+
+#define SOAK_CYCLES 1000000u
+#define SOAK_FRAME_MS 20
+#define SOAK_FULL_CHECK_EVERY 65536u
+
+static uint32_t now_ms;
+
+static void frame(LEDController* controller) {
+    now_ms += SOAK_FRAME_MS;
+    led_controller_update(controller, now_ms);
+}
+
+// Entries on an index stack; pops them all and pushes them back (single-threaded here)
+static int stack_count(LedIndexStack* stack, atomic_ushort* links) {
+    uint16_t indices[LED_COMMAND_POOL_SIZE > MAX_PATTERNS ? LED_COMMAND_POOL_SIZE : MAX_PATTERNS];
+    int count = 0;
+    while (led_index_stack_pop(stack, links, &indices[count])) count++;
+    for (int i = count - 1; i >= 0; i--) led_index_stack_push(stack, links, indices[i]);
+    return count;
+}
+
+static int free_slots(LEDController* controller) {
+    return stack_count(&controller->free_slots, controller->slot_links);
+}
+
+static int free_commands(LEDController* controller) {
+    return stack_count(&controller->commands.free_nodes, controller->commands.links);
+}
+
+static int arena_chunks_used(LEDController* controller) {
+    return (int)led_arena_chunks_used(&controller->arena);
+}
+
+// One pattern of a type picked by cycle, most of them holding an arena run
+static int create_pattern(LEDController* controller, uint32_t cycle) {
+    LedState_t color = { 200, 40, 10 };
+    int edge = cycle % 4;
+    switch (cycle % 5) {
+    case 0:
+        return led_pattern_static(controller, edge, 0, 14, color);
+    case 1:
+        return led_pattern_shift_comet(controller, edge, 0, 14, color, 5, 400);
+    case 2:
+        return led_pattern_palette_cycle(controller, edge, 0, 14, led_palette_rainbow(6), 1000, 0);
+    case 3:
+        return led_pattern_twinkle_envelope(controller, edge, 0, 14, color, 0.1f, 40, 200, cycle);
+    default:
+        return led_pattern_pulse(controller, edge, 0, 14, color, 255, 500);
+    }
+}
+
+// Every slot can be taken at once, one more is refused, and all come back
+static void check_full_table(LEDController* controller) {
+    int ids[MAX_PATTERNS];
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        ids[i] = led_pattern_static(controller, i % 4, 0, 14, (LedState_t){ 1, 2, 3 });
+        TEST_EXPECT(ids[i] >= 0, "slot %d of %d refused", i, MAX_PATTERNS);
+    }
+    TEST_EXPECT(led_pattern_static(controller, 0, 0, 14, (LedState_t){ 1, 2, 3 }) < 0,
+                "pattern %d accepted", MAX_PATTERNS + 1);
+    frame(controller);
+    TEST_EXPECT(controller->pattern_count == MAX_PATTERNS, "%d live", controller->pattern_count);
+
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        if (ids[i] >= 0) led_pattern_remove(controller, ids[i]);
+    }
+    frame(controller);
+    TEST_EXPECT(controller->pattern_count == 0, "%d live", controller->pattern_count);
+}
+
+// Every slot with a short comet fits the default arena, one run each
+static void check_small_runs(LEDController* controller) {
+    int ids[MAX_PATTERNS];
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        ids[i] = led_pattern_shift_comet(controller, i % 4, 0, 14, (LedState_t){ 1, 2, 3 }, 5, 100);
+        TEST_EXPECT(ids[i] >= 0, "comet %d of %d refused", i, MAX_PATTERNS);
+    }
+    TEST_EXPECT(arena_chunks_used(controller) == MAX_PATTERNS, "%d chunks used by %d comets",
+                arena_chunks_used(controller), MAX_PATTERNS);
+    frame(controller);
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        if (ids[i] >= 0) led_pattern_remove(controller, ids[i]);
+    }
+    frame(controller);
+    TEST_EXPECT(arena_chunks_used(controller) == 0, "%d chunks used", arena_chunks_used(controller));
+}
+
+// Every slot at once with the largest run a built-in type takes, each shown on
+// the most segments: what the arena cannot hold comes from the heap
+static void check_large_runs(LEDController* controller) {
+    static LedState_t colors[MAX_LEDS_PER_EDGE];
+    LedSegment segments[LED_PATTERN_MAX_SEGMENTS];
+    for (int s = 0; s < LED_PATTERN_MAX_SEGMENTS; s++) {
+        segments[s] = (LedSegment){ .edge = s % 4, .start = 0, .end = 14, .direction = SEGMENT_FORWARD };
+    }
+
+    int ids[MAX_PATTERNS];
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        ids[i] = led_pattern_shift(controller, i % 4, 0, MAX_LEDS_PER_EDGE - 1, colors, MAX_LEDS_PER_EDGE, 100, 0);
+        TEST_EXPECT(ids[i] >= 0, "full-edge shift %d of %d refused", i, MAX_PATTERNS);
+        if (ids[i] >= 0) led_pattern_set_segments(controller, ids[i], segments, LED_PATTERN_MAX_SEGMENTS);
+    }
+    frame(controller);
+    for (int i = 0; i < MAX_PATTERNS; i++) {
+        Pattern* pattern = &controller->patterns[ids[i] & PATTERN_HANDLE_SLOT_MASK];
+        TEST_EXPECT(ids[i] < 0 || pattern->segment_count == LED_PATTERN_MAX_SEGMENTS,
+                    "pattern %d shown on %d segments", i, ids[i] < 0 ? 0 : pattern->segment_count);
+        if (ids[i] >= 0) led_pattern_remove(controller, ids[i]);
+    }
+    frame(controller);
+    TEST_EXPECT(arena_chunks_used(controller) == 0, "%d chunks used", arena_chunks_used(controller));
+}
+
+// A type whose destroy counts calls, with storage too big for the arena
+static int destroyed;
+
+static bool counted_init(LEDController* controller, Pattern* pattern, const void* config) {
+    return led_pattern_storage(controller, pattern, LED_ARENA_MAX_ALLOC + 1) != NULL;
+}
+
+static void counted_render(LedEdgeConfigState_t* frame, Pattern* pattern, uint32_t time) {
+}
+
+static void counted_destroy(Pattern* pattern) {
+    destroyed++;
+}
+
+static const LedPatternClass counted_class = {
+    .name = "counted",
+    .init = counted_init,
+    .render = counted_render,
+    .destroy = counted_destroy,
+};
+
+// Destroying the controller releases every live pattern and every one still
+// queued, through its type's destroy
+static void check_destroy(void) {
+    int type = led_pattern_register(&counted_class);
+    TEST_EXPECT(type >= 0, "counted type refused");
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller || type < 0) return;
+
+    LedSegment segments[] = { { 1, SEGMENT_FORWARD, 0, 14 } };
+    int live = led_pattern_create(controller, type, 0, 0, 14, NULL);
+    led_pattern_create(controller, type, 1, 0, 14, NULL);
+    led_pattern_create(controller, type, 2, 0, 14, NULL);
+    frame(controller);
+    TEST_EXPECT(controller->pattern_count == 3, "%d live", controller->pattern_count);
+
+    led_pattern_create(controller, type, 3, 0, 14, NULL);
+    led_pattern_create(controller, type, 3, 0, 14, NULL);
+    led_pattern_set_segments(controller, live, segments, 1);
+    host_sim_deinit();
+    TEST_EXPECT(destroyed == 5, "%d of 5 patterns destroyed", destroyed);
+}
+
+int main(int argc, char** argv) {
+    uint32_t cycles = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : SOAK_CYCLES;
+
+    LEDController* controller = host_sim_init(&host_sim_default_topology);
+    if (!controller) return 1;
+
+    const int slots_at_start = free_slots(controller);
+    const int commands_at_start = free_commands(controller);
+    TEST_EXPECT(slots_at_start == MAX_PATTERNS, "%d free slots", slots_at_start);
+    TEST_EXPECT(arena_chunks_used(controller) == 0, "%d chunks used", arena_chunks_used(controller));
+
+    check_small_runs(controller);
+    check_large_runs(controller);
+
+    HostHeapStats heap_before, heap_after;
+    host_heap_get_stats(&heap_before);
+
+    for (uint32_t cycle = 0; cycle < cycles && led_test_failures == 0; cycle++) {
+        int id = create_pattern(controller, cycle);
+        TEST_EXPECT(id >= 0, "cycle %u: create failed", cycle);
+        if (id < 0) break;
+        frame(controller);
+        TEST_EXPECT(controller->pattern_count == 1, "cycle %u: %d live", cycle, controller->pattern_count);
+
+        led_pattern_remove(controller, id);
+        frame(controller);
+        TEST_EXPECT(controller->pattern_count == 0, "cycle %u: %d live", cycle, controller->pattern_count);
+
+        // The slot's next occupant must not answer to the removed handle
+        int next = led_pattern_static(controller, 0, 0, 14, (LedState_t){ 9, 9, 9 });
+        TEST_EXPECT(next >= 0 && next != id, "cycle %u: handle %d reissued", cycle, id);
+        led_pattern_stop(controller, id);
+        led_pattern_remove(controller, id);
+        frame(controller);
+        Pattern* occupant = &controller->patterns[next & PATTERN_HANDLE_SLOT_MASK];
+        TEST_EXPECT(controller->pattern_count == 1 && occupant->in_use && occupant->active,
+                    "cycle %u: stale handle %d reached pattern %d", cycle, id, next);
+        led_pattern_remove(controller, next);
+        frame(controller);
+
+        TEST_EXPECT(free_slots(controller) == slots_at_start, "cycle %u: %d free slots", cycle,
+                    free_slots(controller));
+        TEST_EXPECT(free_commands(controller) == commands_at_start, "cycle %u: %d free commands", cycle,
+                    free_commands(controller));
+        TEST_EXPECT(arena_chunks_used(controller) == 0, "cycle %u: %d arena chunks used", cycle,
+                    arena_chunks_used(controller));
+
+        if (cycle % SOAK_FULL_CHECK_EVERY == 0) check_full_table(controller);
+    }
+
+    host_heap_get_stats(&heap_after);
+    TEST_EXPECT(heap_after.allocations == heap_before.allocations,
+                "%u heap allocations", heap_after.allocations - heap_before.allocations);
+
+    host_sim_deinit();
+    check_destroy();
+    return led_test_result("test_pattern_slots");
+}
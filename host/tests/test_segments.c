@@ -0,0 +1,167 @@
+// A segmented pattern against the same pattern drawn directly: for every built-in
+// type and blend mode, forward segments must match a direct copy on each edge, and
+// reversed and mirrored segments the matching rearrangement of those LEDs, over a
+// background that shows every LED the pattern did not draw
+//     test_segments [cases]
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+#include "render_engine.h"
+#include "led_test.h"
+
+#define SEG_EDGES 4
+#define SEG_LEDS 60
+#define SEG_FRAMES 6
+#define SEG_CASES 4000u
+#define SEG_TYPES 9
+
+static const char* mode_names[] = { "add", "max", "average", "multiply", "replace" };
+
+static uint32_t rng = 11;
+
+static uint32_t next_random(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// One case: a pattern type and range, where its segments go, and how it is drawn
+typedef struct {
+    int type;
+    int start, count;           // Pattern range on its edge
+    int reverse_start;          // Reversed segment on edge 3, count LEDs
+    int mirror_start, mirror_count;     // Mirrored segment on edge 0
+    BlendMode mode;
+    uint32_t seed;
+    LedState_t background;
+    uint32_t times[SEG_FRAMES];
+} SegmentCase;
+
+typedef LedState_t SceneFrames[SEG_FRAMES][SEG_EDGES][SEG_LEDS];
+
+static SceneFrames direct, segmented;
+
+static int create_pattern(LEDController* controller, const SegmentCase* test, int edge) {
+    LedState_t a = led_color_create(200, 40, 90, 230);
+    LedState_t b = led_color_create(10, 180, 60, 255);
+    int start = test->start;
+    int end = test->start + test->count - 1;
+    switch (test->type) {
+    case 0: return led_pattern_static(controller, edge, start, end, a);
+    case 1: return led_pattern_blink(controller, edge, start, end, a, 300, 200, 0);
+    case 2: return led_pattern_fade(controller, edge, start, end, a, b, 4000);
+    case 3: return led_pattern_pulse(controller, edge, start, end, a, 200, 1500);
+    case 4: return led_pattern_shift_comet(controller, edge, start, end, a, 1 + test->seed % 6, 40);
+    case 5: return led_pattern_gradient(controller, edge, start, end, a, b);
+    case 6: return led_pattern_twinkle_seeded(controller, edge, start, end, a, 0.3f, test->seed);
+    case 7: return led_pattern_palette_cycle(controller, edge, start, end, led_palette_rainbow(6), 3000, 2);
+    default: return led_pattern_twinkle_envelope(controller, edge, start, end, b, 0.2f, 100, 300, test->seed);
+    }
+}
+
+static void place(LEDController* controller, int id, BlendMode mode) {
+    led_pattern_set_blend(controller, id, mode);
+    led_pattern_set_z_order(controller, id, 1);
+}
+
+// Direct: the pattern on edges 1 and 2, edge 0 left as background.
+// Segmented: one pattern on edge 0, shown on the four segments.
+static void render_scene(const SegmentCase* test, bool segments, SceneFrames frames) {
+    int leds_per_edge[SEG_EDGES] = { SEG_LEDS, SEG_LEDS, SEG_LEDS, SEG_LEDS };
+    host_clock_set_ms(0);
+    LEDController* controller = led_controller_create(SEG_EDGES, leds_per_edge);
+    TEST_EXPECT(controller != NULL, "controller not created");
+    if (!controller) return;
+    for (int edge = 0; edge < SEG_EDGES; edge++) {
+        led_pattern_static(controller, edge, 0, SEG_LEDS - 1, test->background);
+    }
+
+    led_batch_begin(controller);
+    if (!segments) {
+        place(controller, create_pattern(controller, test, 1), test->mode);
+        place(controller, create_pattern(controller, test, 2), test->mode);
+    } else {
+        int id = create_pattern(controller, test, 0);
+        int end = test->start + test->count - 1;
+        LedSegment list[] = {
+            { 1, SEGMENT_FORWARD, test->start, end },
+            { 2, SEGMENT_FORWARD, test->start, end },
+            { 3, SEGMENT_REVERSE, test->reverse_start, test->reverse_start + test->count - 1 },
+            { 0, SEGMENT_MIRROR, test->mirror_start, test->mirror_start + test->mirror_count - 1 },
+        };
+        led_pattern_set_segments(controller, id, list, 4);
+        place(controller, id, test->mode);
+    }
+    TEST_EXPECT(led_batch_commit(controller) == pdPASS, "type %d: scene not created", test->type);
+
+    led_controller_update(controller, 0);
+    for (int f = 0; f < SEG_FRAMES; f++) {
+        host_clock_set_ms(test->times[f]);
+        led_controller_update(controller, test->times[f]);
+        LedEdgeConfigState_t* frame = framebuffer_acquire(NULL);
+        for (int edge = 0; edge < SEG_EDGES; edge++) {
+            for (int i = 0; i < SEG_LEDS; i++) frames[f][edge][i] = led_matrix_get_led(frame, edge, i);
+        }
+    }
+    led_controller_destroy(controller);
+}
+
+// What the segmented scene should show, from the direct one
+static void expected_frame(const SegmentCase* test, LedState_t (*drawn)[SEG_LEDS],
+                           LedState_t (*want)[SEG_LEDS]) {
+    for (int edge = 0; edge < SEG_EDGES; edge++) {
+        memcpy(want[edge], drawn[0], sizeof(want[edge]));       // Background only
+    }
+    memcpy(want[1], drawn[1], sizeof(want[1]));
+    memcpy(want[2], drawn[2], sizeof(want[2]));
+    for (int i = 0; i < test->count; i++) {
+        want[3][test->reverse_start + test->count - 1 - i] = drawn[1][test->start + i];
+    }
+    int mirror = test->mirror_count;
+    for (int i = 0; i < mirror; i++) {
+        int source = i < mirror - 1 - i ? i : mirror - 1 - i;
+        want[0][test->mirror_start + i] = drawn[1][test->start + source];
+    }
+}
+
+static void check_case(uint32_t index, const SegmentCase* test) {
+    render_scene(test, false, direct);
+    render_scene(test, true, segmented);
+
+    for (int f = 0; f < SEG_FRAMES; f++) {
+        LedState_t want[SEG_EDGES][SEG_LEDS];
+        expected_frame(test, direct[f], want);
+        for (int edge = 0; edge < SEG_EDGES; edge++) {
+            for (int i = 0; i < SEG_LEDS; i++) {
+                LedState_t w = want[edge][i];
+                LedState_t g = segmented[f][edge][i];
+                TEST_EXPECT(memcmp(&w, &g, sizeof(w)) == 0,
+                            "case %u type %d %s frame %d edge %d LED %d: %d,%d,%d,%d drawn as %d,%d,%d,%d",
+                            index, test->type, mode_names[test->mode], f, edge, i,
+                            w.r, w.g, w.b, w.intensity, g.r, g.g, g.b, g.intensity);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t cases = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : SEG_CASES;
+
+    for (uint32_t c = 0; c < cases && led_test_failures == 0; c++) {
+        SegmentCase test = { .type = (int)(c % SEG_TYPES) };
+        test.count = 1 + (int)(next_random() % 20);
+        test.start = (int)(next_random() % 30);
+        test.reverse_start = (int)(next_random() % (SEG_LEDS - test.count + 1));
+        test.mirror_count = 2 * test.count - (int)(next_random() % 2);
+        test.mirror_start = (int)(next_random() % (SEG_LEDS - test.mirror_count + 1));
+        test.mode = (BlendMode)(next_random() % 5);
+        test.seed = next_random();
+        test.background = led_color_create(next_random() & 0xFF, next_random() & 0xFF, next_random() & 0xFF,
+                                           128 + next_random() % 128);
+        uint32_t time = 0;
+        for (int f = 0; f < SEG_FRAMES; f++) test.times[f] = (time += next_random() % 700);
+        check_case(c, &test);
+    }
+    return led_test_result("test_segments");
+}
@@ -0,0 +1,145 @@
+// SWAR span kernels against the scalar paths they replace, bit for bit: every
+// blend mode for every pair of byte operands in every lane, intensity scaling for
+// every value and scale, and spans that must not touch the LEDs around them
+#include <string.h>
+#include "render_engine.h"
+#include "led_swar.h"
+#include "led_test.h"
+
+#define SPAN 256
+
+static const char* mode_names[] = { "add", "max", "average", "multiply", "replace" };
+
+static int same_color(LedState_t a, LedState_t b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.intensity == b.intensity;
+}
+
+// Lanes of LED i against lanes of operand x: each lane runs through every (i, x) pair
+static LedState_t below_color(int i) {
+    return (LedState_t){ (uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i ^ 0x55), (uint8_t)(i ^ 0xAA) };
+}
+
+static LedState_t above_color(int x) {
+    return (LedState_t){ (uint8_t)x, (uint8_t)(x ^ 0x0F), (uint8_t)(255 - x), (uint8_t)(x ^ 0xF0) };
+}
+
+static void test_blend_modes(void) {
+    LedState_t dst[SPAN], src[SPAN], want[SPAN];
+    for (int m = BLEND_ADD; m <= BLEND_REPLACE; m++) {
+        BlendMode mode = (BlendMode)m;
+        for (int x = 0; x < 256; x++) {
+            LedState_t color = above_color(x);
+
+            // One color over a span
+            for (int i = 0; i < SPAN; i++) {
+                dst[i] = below_color(i);
+                want[i] = led_color_blend(dst[i], color, mode);
+            }
+            led_span_blend_color(dst, SPAN, color, mode);
+            for (int i = 0; i < SPAN; i++) {
+                TEST_EXPECT(same_color(dst[i], want[i]), "led_span_blend_color %s: LED %d under %d",
+                            mode_names[m], i, x);
+            }
+
+            // A color per LED
+            for (int i = 0; i < SPAN; i++) {
+                dst[i] = below_color(x);
+                src[i] = above_color(i);
+                want[i] = led_color_blend(dst[i], src[i], mode);
+            }
+            led_span_blend(dst, src, SPAN, mode);
+            for (int i = 0; i < SPAN; i++) {
+                TEST_EXPECT(same_color(dst[i], want[i]), "led_span_blend %s: LED %d over %d",
+                            mode_names[m], i, x);
+            }
+
+            // Single words
+            for (int i = 0; i < SPAN; i++) {
+                uint32_t word = led_swar_blend(led_swar_load(below_color(i)), led_swar_load(color), mode);
+                TEST_EXPECT(same_color(led_swar_store(word), led_color_blend(below_color(i), color, mode)),
+                            "led_swar_blend %s: %d, %d", mode_names[m], i, x);
+            }
+        }
+    }
+}
+
+// c * scale / 255 per channel, as led_pack did it per byte
+static void test_scale(void) {
+    for (int scale = 0; scale < 256; scale++) {
+        for (int i = 0; i < 256; i++) {
+            LedState_t color = below_color(i);
+            LedState_t got = led_swar_store(led_swar_scale(led_swar_load(color), (uint32_t)scale));
+            LedState_t want = { (uint8_t)(color.r * scale / 255), (uint8_t)(color.g * scale / 255),
+                                (uint8_t)(color.b * scale / 255), (uint8_t)(color.intensity * scale / 255) };
+            TEST_EXPECT(same_color(got, want), "led_swar_scale(%d, %d)", i, scale);
+
+            // Intensity folded into r/g/b; the intensity lane itself is not used
+            color.intensity = (uint8_t)scale;
+            got = led_swar_store(led_swar_apply_intensity(led_swar_load(color)));
+            TEST_EXPECT(got.r == color.r * scale / 255 && got.g == color.g * scale / 255 &&
+                        got.b == color.b * scale / 255, "led_swar_apply_intensity(%d, %d)", i, scale);
+        }
+    }
+}
+
+// Kernels checked against their span bounds: led_span_blend in each mode, then
+// led_span_blend_color in each mode, then led_span_fill
+#define BOUNDS_BLEND_COLOR (BLEND_REPLACE + 1)
+#define BOUNDS_FILL (2 * BOUNDS_BLEND_COLOR)
+#define BOUNDS_KERNELS (BOUNDS_FILL + 1)
+
+static void apply_kernel(int kernel, LedState_t* dst, const LedState_t* src, int count) {
+    if (kernel == BOUNDS_FILL) led_span_fill(dst, count, above_color(count));
+    else if (kernel >= BOUNDS_BLEND_COLOR) {
+        led_span_blend_color(dst, count, above_color(count), (BlendMode)(kernel - BOUNDS_BLEND_COLOR));
+    } else led_span_blend(dst, src, count, (BlendMode)kernel);
+}
+
+// What the kernel should leave in LED i, through the scalar path
+static LedState_t kernel_reference(int kernel, const LedState_t* src, int count, int i) {
+    if (kernel == BOUNDS_FILL) return above_color(count);
+    if (kernel >= BOUNDS_BLEND_COLOR) {
+        return led_color_blend(below_color(i), above_color(count), (BlendMode)(kernel - BOUNDS_BLEND_COLOR));
+    }
+    return led_color_blend(below_color(i), src[i], (BlendMode)kernel);
+}
+
+// Every span length from 0 to SPAN at every LED offset within a 16-byte block,
+// with guard LEDs either side
+static void test_span_bounds(void) {
+    LedState_t guard = { 0xDE, 0xAD, 0xBE, 0xEF };
+    _Alignas(16) LedState_t buffer[SPAN + 8];
+    LedState_t src[SPAN];
+    for (int i = 0; i < SPAN; i++) src[i] = above_color(i);
+
+    for (int offset = 0; offset < 4; offset++) {
+        for (int count = 0; count <= SPAN; count++) {
+            for (int kernel = 0; kernel < BOUNDS_KERNELS; kernel++) {
+                for (int i = 0; i < SPAN + 8; i++) buffer[i] = guard;
+                for (int i = 0; i < count; i++) buffer[offset + i] = below_color(i);
+
+                LedState_t* dst = buffer + offset;
+                apply_kernel(kernel, dst, src, count);
+                for (int i = 0; i < count; i++) {
+                    TEST_EXPECT(same_color(dst[i], kernel_reference(kernel, src, count, i)),
+                                "kernel %d, count %d: LED %d", kernel, count, i);
+                }
+                for (int i = 0; i < offset; i++) {
+                    TEST_EXPECT(same_color(buffer[i], guard), "kernel %d, count %d wrote LED %d before the span",
+                                kernel, count, i);
+                }
+                for (int i = offset + count; i < SPAN + 8; i++) {
+                    TEST_EXPECT(same_color(buffer[i], guard), "kernel %d, count %d wrote LED %d after the span",
+                                kernel, count, i);
+                }
+            }
+        }
+    }
+}
+
+int main(void) {
+    test_blend_modes();
+    test_scale();
+    test_span_bounds();
+    return led_test_result("test_swar");
+}
@@ -0,0 +1,113 @@
+// Known frames through the SPI bitstream encoder and the RMT symbol timings: every
+// pulse must sit in the WS2812 T0H/T0L/T1H/T1L windows, the frame must end in a
+// reset gap, and the bits must decode back to the frame
+#include <string.h>
+#include "ws2812_spi_encoder.h"
+#include "ws2812_timing.h"
+#include "led_test.h"
+
+#define FRAME_BYTES (3 * 300)
+#define FRAME_COUNT 5
+#define RMT_DURATION_MAX 0x7FFF     // 15-bit symbol duration field
+
+static uint8_t frames[FRAME_COUNT][FRAME_BYTES];
+static const char* frame_names[FRAME_COUNT] = { "zeros", "ones", "alternating", "counting", "random" };
+
+static void build_frames(void) {
+    uint32_t seed = 0x2812;
+    for (int i = 0; i < FRAME_BYTES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        frames[0][i] = 0x00;
+        frames[1][i] = 0xFF;
+        frames[2][i] = (i & 1) ? 0xAA : 0x55;
+        frames[3][i] = (uint8_t)i;
+        frames[4][i] = (uint8_t)(seed >> 24);
+    }
+}
+
+// ---- SPI: ws2812_spi_encode checked by ws2812_spi_check_timing ----
+
+static void test_spi(void) {
+    static uint8_t bits[FRAME_BYTES * WS2812_SPI_BYTES_PER_BYTE + WS2812_SPI_RESET_BYTES];
+    static uint8_t decoded[FRAME_BYTES];
+
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        for (size_t length = 1; length <= FRAME_BYTES; length = length * 3 + 2) {
+            size_t size = ws2812_spi_encode(frames[f], length, bits);
+            TEST_EXPECT(size == ws2812_spi_encoded_size(length), "%s/%zu: %zu bytes", frame_names[f], length, size);
+
+            memset(decoded, 0xEE, sizeof(decoded));
+            size_t violations = ws2812_spi_check_timing(bits, size, WS2812_SPI_CLOCK_HZ, decoded, length);
+            TEST_EXPECT(violations == 0, "%s/%zu: %zu timing violations", frame_names[f], length, violations);
+            TEST_EXPECT(memcmp(decoded, frames[f], length) == 0, "%s/%zu: decoded frame differs",
+                        frame_names[f], length);
+        }
+    }
+
+    // The checker itself must notice a stretched pulse and a short reset gap
+    size_t size = ws2812_spi_encode(frames[4], 64, bits);
+    bits[10] = 0xFF;
+    TEST_EXPECT(ws2812_spi_check_timing(bits, size, WS2812_SPI_CLOCK_HZ, NULL, 0) > 0, "stretched pulse passed");
+    size = ws2812_spi_encode(frames[4], 64, bits);
+    TEST_EXPECT(ws2812_spi_check_timing(bits, size - WS2812_SPI_RESET_BYTES + 1, WS2812_SPI_CLOCK_HZ, NULL, 0) > 0,
+                "short reset passed");
+}
+
+// ---- RMT: the bytes encoder's symbols (MSB first) and the reset code ----
+
+static void test_rmt_resolution(uint32_t resolution_hz) {
+    ws2812_rmt_ticks_t ticks = ws2812_rmt_ticks(resolution_hz);
+    double tick_ns = 1e9 / resolution_hz;
+    uint16_t durations[] = { ticks.t0h, ticks.t0l, ticks.t1h, ticks.t1l, ticks.reset_half };
+    for (size_t i = 0; i < sizeof(durations) / sizeof(durations[0]); i++) {
+        TEST_EXPECT(durations[i] > 0 && durations[i] <= RMT_DURATION_MAX, "%u Hz: duration %zu is %u ticks",
+                    resolution_hz, i, durations[i]);
+    }
+
+    static uint8_t decoded[FRAME_BYTES];
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        memset(decoded, 0, sizeof(decoded));
+        for (size_t bit = 0; bit < FRAME_BYTES * 8; bit++) {
+            int value = (frames[f][bit >> 3] >> (7 - (bit & 7))) & 1;
+            double high_ns = (value ? ticks.t1h : ticks.t0h) * tick_ns;
+            double low_ns = (value ? ticks.t1l : ticks.t0l) * tick_ns;
+
+            // What the strip reads back from the pulse
+            int read = -1;
+            if (high_ns >= WS2812_T0H_MIN_NS && high_ns <= WS2812_T0H_MAX_NS) read = 0;
+            if (high_ns >= WS2812_T1H_MIN_NS && high_ns <= WS2812_T1H_MAX_NS) read = 1;
+            TEST_EXPECT(read == value, "%u Hz %s: bit %zu high for %.0f ns", resolution_hz, frame_names[f],
+                        bit, high_ns);
+            if (read == 1) decoded[bit >> 3] |= (uint8_t)(0x80 >> (bit & 7));
+
+            // The last bit's low time runs into the reset code
+            if (bit + 1 == FRAME_BYTES * 8) {
+                low_ns += 2.0 * ticks.reset_half * tick_ns;
+                TEST_EXPECT(low_ns >= WS2812_RESET_MIN_NS, "%u Hz: reset gap %.0f ns", resolution_hz, low_ns);
+            } else if (value) {
+                TEST_EXPECT(low_ns >= WS2812_T1L_MIN_NS && low_ns <= WS2812_T1L_MAX_NS,
+                            "%u Hz: T1L %.0f ns", resolution_hz, low_ns);
+            } else {
+                TEST_EXPECT(low_ns >= WS2812_T0L_MIN_NS && low_ns <= WS2812_T0L_MAX_NS,
+                            "%u Hz: T0L %.0f ns", resolution_hz, low_ns);
+            }
+        }
+        TEST_EXPECT(memcmp(decoded, frames[f], FRAME_BYTES) == 0, "%u Hz %s: decoded frame differs",
+                    resolution_hz, frame_names[f]);
+    }
+}
+
+static void test_rmt(void) {
+    // 10 MHz is what the handler runs the channels at
+    static const uint32_t resolutions[] = { 10000000, 20000000, 40000000, 80000000 };
+    for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+        test_rmt_resolution(resolutions[i]);
+    }
+}
+
+int main(void) {
+    build_frames();
+    test_spi();
+    test_rmt();
+    return led_test_result("test_ws2812_timing");
+}
@@ -15,6 +15,50 @@ TaskHandle_t render_engine_task_handle = NULL;
 // Visual LED controller
 LEDController* led_controller = NULL;
 
+#define RGB(r, g, b, intensity) { (r), (g), (b), (intensity) }
+#define EDGE_SET(at, edge_id, type, ...) \
+    { .at_ms = (at), .op = TIMELINE_SET, .edge = (edge_id), .pattern = (type), __VA_ARGS__ }
+#define EDGE_CLEAR(at, edge_id) { .at_ms = (at), .op = TIMELINE_CLEAR, .edge = (edge_id) }
+
+// Demo show; each scene used to be paced with vTaskDelay from app_main
+static const LedTimelineEvent demo_timeline[] = {
+    // DEMO 1: individual edge control, one edge every 2 s
+    EDGE_SET(0,     0, PATTERN_STATIC,        .color = RGB(255, 0, 0, 200)),
+    EDGE_SET(2000,  1, PATTERN_BLINK,         .color = RGB(0, 255, 0, 200), .period_ms = 1000),
+    EDGE_SET(4000,  2, PATTERN_PULSE,         .color = RGB(0, 0, 255, 200), .arg = 200, .period_ms = 3000),
+    EDGE_SET(6000,  3, PATTERN_PALETTE_CYCLE, .arg = 12, .period_ms = 5000),
+    
+    // DEMO 2: every pattern on edge 2 for 5 s each, other edges off
+    EDGE_CLEAR(18000, 0),
+    EDGE_CLEAR(18000, 1),
+    EDGE_CLEAR(18000, 3),
+    EDGE_SET(18000, 2, PATTERN_STATIC,        .color = RGB(0, 255, 0, 200)),
+    EDGE_SET(23000, 2, PATTERN_BLINK,         .color = RGB(0, 0, 255, 200), .period_ms = 2000),
+    EDGE_SET(28000, 2, PATTERN_PULSE,         .color = RGB(255, 255, 0, 200), .arg = 200, .period_ms = 2000),
+    EDGE_SET(33000, 2, PATTERN_PALETTE_CYCLE, .arg = 12, .period_ms = 2000),
+    EDGE_SET(38000, 2, PATTERN_FADE,          .color2 = RGB(0, 255, 255, 200), .period_ms = 2000),
+    EDGE_SET(43000, 2, PATTERN_FADE,          .color = RGB(255, 255, 255, 200), .period_ms = 2000),
+    EDGE_SET(48000, 2, PATTERN_TWINKLE,       .color = RGB(255, 0, 0, 200), .arg = 200),
+    
+    // DEMO 3: turn edges off one by one
+    EDGE_CLEAR(53000, 0),
+    EDGE_CLEAR(55000, 1),
+    
+    // DEMO 4: all edges at once, landing on the same frame
+    EDGE_SET(57000, 0, PATTERN_STATIC,        .color = RGB(255, 0, 0, 200)),
+    EDGE_SET(57000, 1, PATTERN_BLINK,         .color = RGB(0, 255, 0, 200), .period_ms = 1000),
+    EDGE_SET(57000, 2, PATTERN_PULSE,         .color = RGB(0, 0, 255, 200), .arg = 200, .period_ms = 3000),
+    EDGE_SET(57000, 3, PATTERN_PALETTE_CYCLE, .arg = 12, .period_ms = 5000),
+    
+    // DEMO 5: manual pattern assignment
+    EDGE_SET(67000, 1, PATTERN_TWINKLE,       .color = RGB(255, 255, 0, 255), .arg = 200),
+    EDGE_SET(72000, 2, PATTERN_FADE,          .color2 = RGB(0, 255, 255, 255), .period_ms = 3000),
+    
+    // Dark for 3 s, then start over
+    EDGE_CLEAR(77000, LED_TIMELINE_ALL_EDGES),
+    { .at_ms = 80000, .op = TIMELINE_JUMP, .target = 0 },
+};
+
 void app_main(void) {
     ESP_LOGI(TAG, "Starting Simple LED Handler Demo");
     
@@ -36,58 +80,15 @@ void app_main(void) {
     // Show available patterns
     led_show_all_patterns();
     
-    ESP_LOGI(TAG, "=== DEMO 1: Individual Edge Control ===");
-    
-    // Set different patterns on each edge
-    led_set_edge_pattern(0, LED_PATTERN_STATIC, 255, 0, 0, 200, 1000);     // Edge 0: Red static
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    led_set_edge_pattern(1, LED_PATTERN_BLINK, 0, 255, 0, 200, 1000);      // Edge 1: Green blink
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    led_set_edge_pattern(2, LED_PATTERN_BREATH, 0, 0, 255, 200, 3000);     // Edge 2: Blue breath
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    led_set_edge_pattern(3, LED_PATTERN_RAINBOW, 255, 255, 255, 200, 5000); // Edge 3: Rainbow
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    ESP_LOGI(TAG, "All edges running different patterns");
-    led_get_all_status();
-    vTaskDelay(pdMS_TO_TICKS(10000));
-    
-    ESP_LOGI(TAG, "=== DEMO 2: Single Edge Pattern Demo ===");
-    led_demo_edge_patterns(2);  // Demo all patterns on edge 2
-    
-    ESP_LOGI(TAG, "=== DEMO 3: Turn Off Individual Edges ===");
-    led_turn_off_edge(0);
-    ESP_LOGI(TAG, "Turned off edge 0");
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    led_turn_off_edge(1);
-    ESP_LOGI(TAG, "Turned off edge 1");
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
-    ESP_LOGI(TAG, "=== DEMO 4: Test All Edges ===");
-    led_test_all_edges();
-    vTaskDelay(pdMS_TO_TICKS(10000));
-    
-    ESP_LOGI(TAG, "=== DEMO 5: Manual Pattern Assignment ===");
-    
-    // Example: Set specific pattern on edge 1
-    ESP_LOGI(TAG, "Setting TWINKLE pattern on edge 1");
-    led_set_edge_pattern(1, LED_PATTERN_TWINKLE, 255, 255, 0, 255, 500);
-    vTaskDelay(pdMS_TO_TICKS(5000));
-    
-    // Example: Set FADE_IN pattern on edge 2
-    ESP_LOGI(TAG, "Setting FADE_IN pattern on edge 2");
-    led_set_edge_pattern(2, LED_PATTERN_FADE_IN, 0, 255, 255, 255, 3000);
-    vTaskDelay(pdMS_TO_TICKS(5000));
-    
-    ESP_LOGI(TAG, "=== DEMO Complete ===");
-    led_clear_all();
-    
-    
+    // The whole show runs on the render task's frame clock; app_main can return
+    if (led_timeline_play(led_controller, demo_timeline,
+                          sizeof(demo_timeline) / sizeof(demo_timeline[0])) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start demo timeline");
+        return;
+    }
+    ESP_LOGI(TAG, "Demo timeline playing");
 }
+
 // Get current time in milliseconds
 uint32_t get_current_time_ms(void) {
     return esp_timer_get_time() / 1000;
@@ -15,8 +15,10 @@
 #define LED_RENDER_TASK_CORE            1       // Core 1 for render task
 #define LED_DISPLAY_TASK_CORE           0       // Core 0 for display task
 
-// Timing constants
-#define LED_RENDER_PERIOD_MS            50      // 20 FPS
+// Timing constants: the render task sleeps until the next pattern output change,
+// but never renders more often than LED_MAX_FPS
+#define LED_MAX_FPS                     60
+#define LED_MIN_FRAME_PERIOD_MS         (1000 / LED_MAX_FPS)
 #define LED_DISPLAY_TIMEOUT_MS          100     // Timeout for waiting for render notification
 
 // Task handles - global declarations